@@ -0,0 +1,48 @@
+/* 
+**  (C) by Remo Dentato (rdentato@gmail.com)
+** 
+** This sofwtare is distributed under the terms of the BSD license:
+**   http://creativecommons.org/licenses/BSD/
+**   http://opensource.org/licenses/bsd-license.php 
+*/
+
+/* Converts binary logs (opened with '|logOpen(fname,"wb")|) to text and
+** prints the content of ring logs (opened with '|logOpenRing()|) in order.
+** .v
+**     logdecode [file ...]
+** ..
+**   Reads from stdin if no file is given.
+*/
+
+#define  UTL_LIB
+#include "utl.h"
+
+static int decode(char *fname, FILE *in)
+{
+  if (logDecode(in, stdout) < 0) {
+    fprintf(stderr, "logdecode: %s is not a valid binary or ring log\n", fname);
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  FILE *in;
+  int k;
+  int err = 0;
+  
+  if (argc < 2) return decode("<stdin>", stdin);
+  
+  for (k = 1; k < argc; k++) {
+    in = fopen(argv[k], "rb");
+    if (!in) {
+      fprintf(stderr, "logdecode: unable to open %s\n", argv[k]);
+      err = 1;
+      continue;
+    }
+    err |= decode(argv[k], in);
+    fclose(in);
+  }
+  return err;
+}
@@ -0,0 +1,331 @@
+/*
+**  (C) by Remo Dentato (rdentato@gmail.com)
+**
+** This sofwtare is distributed under the terms of the BSD license:
+**   http://creativecommons.org/licenses/BSD/
+**   http://opensource.org/licenses/bsd-license.php
+*/
+
+/* Analyzes the binary traces written by '|utlMemTrace()|.
+** .v
+**     memtrace [-n num] file
+** ..
+**   Prints:
+**   .- the heap timeline: live bytes and blocks at '|num| (default 20)
+**      evenly spaced points in time;
+**    - the composition of the heap at its peak: live bytes and blocks for
+**      the top '|num| allocation sites;
+**    - the churn of the top '|num| sites (by number of allocations): number
+**      of allocations and frees, bytes allocated and maximum live bytes.
+**   ..
+**   Blocks allocated before the trace was started are not known, so their
+** frees are ignored.
+*/
+
+#define  UTL_LIB
+#include "utl.h"
+
+typedef struct {
+  char    *file;
+  int      line;
+  long     live;
+  long     blocks;
+  long     max_live;
+  long     peak_live;   /* live at the peak of the heap */
+  long     peak_blocks;
+  unsigned long allocs;
+  unsigned long frees;
+  unsigned long bytes;
+} site_t;
+
+static site_t *sites = NULL;
+static size_t  nsites = 0;
+
+/* Known pointers (to ignore the frees of untraced blocks) */
+static uint64_t *ptrs = NULL;
+static size_t    ptrs_max = 0;
+static size_t    ptrs_cnt = 0;
+
+static size_t ptr_hash(uint64_t p, size_t max)
+{
+  p ^= p >> 33;  p *= 0xFF51AFD7ED558CCDULL;  p ^= p >> 33;
+  return (size_t)(p & (max - 1));
+}
+
+static void ptr_add(uint64_t p);
+
+static void ptr_grow(void)
+{
+  uint64_t *old = ptrs;
+  size_t k, n = ptrs_max;
+
+  ptrs_max = n ? n * 2 : 1024;
+  ptrs = calloc(ptrs_max, sizeof(uint64_t));
+  if (!ptrs) { fprintf(stderr, "memtrace: out of memory\n"); exit(1); }
+  ptrs_cnt = 0;
+  for (k = 0; k < n; k++) if (old[k]) ptr_add(old[k]);
+  free(old);
+}
+
+static void ptr_add(uint64_t p)
+{
+  size_t h;
+
+  if (2 * (ptrs_cnt + 1) > ptrs_max) ptr_grow();
+  for (h = ptr_hash(p, ptrs_max); ptrs[h]; h = (h + 1) & (ptrs_max - 1))
+    if (ptrs[h] == p) return;
+  ptrs[h] = p;
+  ptrs_cnt++;
+}
+
+/* Linear probing with backward shift deletion */
+static int ptr_del(uint64_t p)
+{
+  size_t h, j, k;
+
+  if (!ptrs_max) return 0;
+  for (h = ptr_hash(p, ptrs_max); ptrs[h] != p; h = (h + 1) & (ptrs_max - 1))
+    if (!ptrs[h]) return 0;
+  ptrs[h] = 0;
+  ptrs_cnt--;
+  for (j = (h + 1) & (ptrs_max - 1); ptrs[j]; j = (j + 1) & (ptrs_max - 1)) {
+    k = ptr_hash(ptrs[j], ptrs_max);
+    if ((j > h && (k <= h || k > j)) || (j < h && (k <= h && k > j))) {
+      ptrs[h] = ptrs[j];
+      ptrs[j] = 0;
+      h = j;
+    }
+  }
+  return 1;
+}
+
+static void ptr_clear(void)
+{
+  if (ptrs) memset(ptrs, 0, ptrs_max * sizeof(uint64_t));
+  ptrs_cnt = 0;
+}
+
+/* Site ids are indices in the table of the traced program, so a big jump
+** past the known ones means the file is corrupted: returns NULL.
+*/
+#define SITE_STEP 65536
+#define NAME_LEN  4096  /* longest file name of a site */
+
+static site_t *get_site(uint32_t id)
+{
+  size_t n;
+
+  if (id >= nsites) {
+    if (id - nsites >= SITE_STEP) return NULL;
+    n = (size_t)id + 64;
+    sites = realloc(sites, n * sizeof(site_t));
+    if (!sites) { fprintf(stderr, "memtrace: out of memory\n"); exit(1); }
+    memset(sites + nsites, 0, (n - nsites) * sizeof(site_t));
+    nsites = n;
+  }
+  return sites + id;
+}
+
+/* Reads the next alloc/free record, handling the site records. Returns 0
+** at the end of the file and -1 if it's truncated or corrupted.
+*/
+static int next_rec(FILE *in, utl_mem_rec_t *r)
+{
+  site_t *s;
+  size_t n;
+
+  while ((n = fread(r, 1, sizeof(utl_mem_rec_t), in)) == sizeof(utl_mem_rec_t)) {
+    if (!(s = get_site(r->site))) return -1;
+    if (r->op == UTL_MEM_OP_ALLOC || r->op == UTL_MEM_OP_FREE) return 1;
+    if (r->op != UTL_MEM_OP_SITE || r->time > NAME_LEN) return -1;
+    if (!s->file) {
+      s->file = malloc((size_t)r->time + 1);
+      if (!s->file) { fprintf(stderr, "memtrace: out of memory\n"); exit(1); }
+      if (fread(s->file, 1, (size_t)r->time, in) != r->time) return -1;
+      s->file[r->time] = '\0';
+      s->line = (int)r->size;
+    }
+    else if (fseek(in, (long)r->time, SEEK_CUR) != 0) return -1;
+  }
+  return (n == 0 && !ferror(in)) ? 0 : -1;
+}
+
+static int cmp_peak(const void *a, const void *b)
+{
+  long x = (*(site_t **)a)->peak_live, y = (*(site_t **)b)->peak_live;
+  return (x < y) - (x > y);
+}
+
+static int cmp_allocs(const void *a, const void *b)
+{
+  unsigned long x = (*(site_t **)a)->allocs, y = (*(site_t **)b)->allocs;
+  return (x < y) - (x > y);
+}
+
+static char *site_name(site_t *s, char *buf)
+{
+  if (s->file) sprintf(buf, "%.200s:%d", s->file, s->line);
+  else strcpy(buf, "(unknown)");
+  return buf;
+}
+
+/* Records of different threads are written in batches, so the file is not
+** in the order of the events: they are sorted by their sequence number.
+*/
+static int cmp_seq(const void *a, const void *b)
+{
+  const utl_mem_rec_t *x = a, *y = b;
+  return (x->seq > y->seq) - (x->seq < y->seq);
+}
+
+/* Reads all the records in 'recs'. Returns -1 if the file is corrupted */
+static int load(FILE *in, utl_mem_rec_t **recs, unsigned long *cnt)
+{
+  utl_mem_rec_t *t;
+  unsigned long n = 0, max = 0;
+  utl_mem_rec_t r;
+  int ret;
+  
+  *recs = NULL;
+  while ((ret = next_rec(in, &r)) > 0) {
+    if (n >= max) {
+      max = max ? max * 2 : 4096;
+      t = realloc(*recs, max * sizeof(utl_mem_rec_t));
+      if (!t) { fprintf(stderr, "memtrace: out of memory\n"); exit(1); }
+      *recs = t;
+    }
+    (*recs)[n++] = r;
+  }
+  if (n > 0) qsort(*recs, n, sizeof(utl_mem_rec_t), cmp_seq);
+  *cnt = n;
+  return ret;
+}
+
+static int analyze(FILE *in, int num)
+{
+  utl_mem_rec_t *r, *recs;
+  char sig[8];
+  uint32_t hdr[2];
+  long live = 0, blocks = 0, peak = 0, peak_blocks = 0;
+  unsigned long nrec = 0, peak_rec = 0, k;
+  uint64_t t0 = 0, t1 = 0, tpeak = 0, tnext;
+  site_t *s, **top;
+  size_t j, n;
+  char name[256];
+  int i;
+
+  if (fread(sig, 1, 8, in) != 8 || memcmp(sig, UTL_MEM_TRACE_SIG, 8) ||
+      fread(hdr, sizeof(uint32_t), 2, in) != 2 || hdr[0] != 2 || hdr[1] != sizeof(utl_mem_rec_t))
+    return -1;
+  
+  if (load(in, &recs, &nrec) < 0) {
+    free(recs);
+    return -2;
+  }
+  if (nrec > 0) {
+    t0 = recs[0].time;
+    t1 = recs[nrec-1].time;
+  }
+
+  /* First pass: totals, churn and the moment of the peak */
+  for (k = 0; k < nrec; k++) {
+    r = &recs[k];
+    s = get_site(r->site);
+    if (r->op == UTL_MEM_OP_ALLOC) {
+      ptr_add(r->ptr);
+      live += (long)r->size;  blocks++;
+      s->live += (long)r->size;
+      s->allocs++;
+      s->bytes += (unsigned long)r->size;
+      if (s->live > s->max_live) s->max_live = s->live;
+      if (live > peak) { peak = live; peak_blocks = blocks; peak_rec = k+1; tpeak = r->time; }
+    }
+    else if (ptr_del(r->ptr)) {
+      live -= (long)r->size;  blocks--;
+      s->live -= (long)r->size;
+      s->frees++;
+    }
+  }
+
+  /* Second pass: timeline and composition at the peak */
+  ptr_clear();
+  for (j = 0; j < nsites; j++) sites[j].live = sites[j].blocks = 0;
+  live = blocks = 0;
+
+  printf("# Heap timeline (%lu records)\n", nrec);
+  printf("#   time(ms)       live     blocks\n");
+  tnext = t0;
+  for (k = 0; k < nrec; k++) {
+    r = &recs[k];
+    while (r->time >= tnext && tnext <= t1) {
+      printf("%12.3f %10ld %10ld\n", (double)(tnext - t0) / 1000.0, live, blocks);
+      tnext += (t1 - t0) / num + 1;
+    }
+    s = get_site(r->site);
+    if (r->op == UTL_MEM_OP_ALLOC) {
+      ptr_add(r->ptr);
+      live += (long)r->size;  blocks++;
+      s->live += (long)r->size;  s->blocks++;
+    }
+    else if (ptr_del(r->ptr)) {
+      live -= (long)r->size;  blocks--;
+      s->live -= (long)r->size;  s->blocks--;
+    }
+    if (k+1 == peak_rec)
+      for (j = 0; j < nsites; j++) {
+        sites[j].peak_live = sites[j].live;
+        sites[j].peak_blocks = sites[j].blocks;
+      }
+  }
+  printf("%12.3f %10ld %10ld\n", (double)(t1 - t0) / 1000.0, live, blocks);
+  free(recs);
+
+  top = malloc((nsites + 1) * sizeof(site_t *));
+  if (!top) return -1;
+
+  printf("#\n# Peak: %ld bytes in %ld blocks at %.3f ms\n", peak, peak_blocks,
+                                                   (double)(tpeak - t0) / 1000.0);
+  printf("#       live   blocks  site\n");
+  for (n = 0, j = 0; j < nsites; j++) if (sites[j].peak_live > 0) top[n++] = sites + j;
+  qsort(top, n, sizeof(site_t *), cmp_peak);
+  for (i = 0; i < (int)n && i < num; i++)
+    printf("%12ld %8ld  %s\n", top[i]->peak_live, top[i]->peak_blocks, site_name(top[i], name));
+
+  printf("#\n# Churn\n");
+  printf("#     allocs      frees        bytes   max live  site\n");
+  for (n = 0, j = 0; j < nsites; j++) if (sites[j].allocs > 0) top[n++] = sites + j;
+  qsort(top, n, sizeof(site_t *), cmp_allocs);
+  for (i = 0; i < (int)n && i < num; i++)
+    printf("%12lu %10lu %12lu %10ld  %s\n", top[i]->allocs, top[i]->frees, top[i]->bytes,
+                                           top[i]->max_live, site_name(top[i], name));
+  free(top);
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  FILE *in;
+  int num = 20;
+  int k = 1;
+  int ret;
+
+  if (k + 1 < argc && strcmp(argv[k], "-n") == 0) {
+    num = atoi(argv[k+1]);
+    if (num <= 0) num = 20;
+    k += 2;
+  }
+  if (k >= argc) {
+    fprintf(stderr, "Usage: memtrace [-n num] file\n");
+    return 1;
+  }
+  in = fopen(argv[k], "rb");
+  if (!in) {
+    fprintf(stderr, "memtrace: unable to open %s\n", argv[k]);
+    return 1;
+  }
+  ret = analyze(in, num);
+  fclose(in);
+  if (ret == -1) fprintf(stderr, "memtrace: %s is not a memory trace\n", argv[k]);
+  if (ret == -2) fprintf(stderr, "memtrace: %s is truncated or corrupted\n", argv[k]);
+  return ret < 0;
+}
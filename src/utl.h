@@ -1,1464 +1,5516 @@
-/* 
-**  (C) by Remo Dentato (rdentato@gmail.com)
-** 
-** This software is distributed under the terms of the BSD license:
-**   http://creativecommons.org/licenses/BSD/
-**
-*/
-
-#ifndef UTL_H
-#define UTL_H
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <stdint.h>
-
-#include <string.h>
-#include <stdarg.h>
-#include <stddef.h>
-
-#include <setjmp.h>
-#include <assert.h>
-
-
-/* .% Overview
-**
-** =========== 
-** .v
-**                           ___   __
-**                       ___/  (_ /  )
-**                ___  _(__   ___)  /
-**               /  / /  )/  /  /  /
-**              /  /_/  //  (__/  /
-**             (____,__/(_____(__/
-** ..
-**
-**   This file ('|utl.h|) provide the following basic elements:
-**
-**  .[Unit Testing]   A simple framework to create unit tests. Tests output
-**                    is compliant with the TAP '(Test Anything Protocol)
-**                    standard.
-**
-**   [Logging]        To print logging traces during program execution.
-**                    It offers multilevel logging similar to '|log4j|
-**                    but limited to files.
-**
-**   [Finite State Machine]
-**                    Macros to use FSM as if they were a native C control
-**                    structure (similar to switch).
-**
-**   [Exceptions]     A simple implementation of try/catch. Similar to C++.
-**
-**   [Guarded memory allocation]
-**                    Replacement for malloc(), calloc(), realloc() and free()
-**                    that account and report about misuse of memory.
-**
-**   [Dynamic arrays]
-**   [Text buffers}
-**  ..
-**
-*/
-
-/*
-** .% How to use '|utl|
-** ====================
-**
-**  To access '|utl| functions you simply:
-**
-**  .# #include '|utl.h| in each source file
-**   # in one (and only one) of the source files #define the symbol
-**     '|UTL_LIB| before including '|utl.h| (a good place is the
-**     file where  your '|main()| function is defined)
-**  ..
-**
-**    As an alternative to the second step above, you can create a source
-**  file (say '|utl.c|) with only the following lines:
-**  .{{ C
-**       #define  UTL_C
-**       #include "utl.h"
-**  .}}
-**  and link it to your project.
-**
-*/
-
-#ifdef UTL_C
-#ifndef UTL_LIB
-#define UTL_LIB
-#endif
-#endif
-
-/* .%% Enable/disable utl features
-** -------------------------------
-**
-*/
-
-#ifdef NDEBUG
-#ifdef DEBUG
-#undef DEBUG
-#endif
-#endif
-
-#ifdef UTL_NOMEMCHECK
-#ifdef UTL_MEMCHECK
-#undef UTL_MEMCHECK
-#endif
-#endif
-
-#ifdef UTL_MEMCHECK
-#ifdef UTL_NOLOGGING
-#undef UTL_NOLOGGING
-#endif
-#endif
-
-#ifdef UTL_UNITTEST
-#ifndef DEBUG
-#define DEBUG
-#endif
-#endif
-
-
-/* .% Globals
-** ==========
-** 
-**    There are some symbols (costants or variables) that need to be shared by
-**  all the modules that include '|utl.h|.  They are defined with the aid of
-**  the macro '{utl_extern} which takes care of their definition and initialization
-**  in the '/main/ code and of their declaration as '|extern| in the rest of the code.
-*/
-
-#ifdef UTL_LIB
-#define utl_extern(n,v) n v
-#else
-#define utl_extern(n,v) extern n
-#endif
-
-#define utl_initvoid ;
-
-#define UTL_VERSION 0x0003
-
-utl_extern(unsigned short utlVersion, = UTL_VERSION);
-
-/* .%% Constants
-** -------------
-**
-**  A set of constants for generic use. Provided by for convenience.
-**
-**  .[utlEmptyFun]  A pointer to a do-nothing function that can be used
-**                  as a generic placeholder (or NULL indicator) for
-**                  function pointers. This can be useful as the C standard
-**                  doesn't guarantee that one could mix pointers to objects
-**                  with pointers to function (even if in reality this is
-**                  practically always the case).  
-**  ..
-*/
-
-int utlEmptyFun(void); 
-#ifdef UTL_LIB
-int   utlEmptyFun(void) {return 0;}
-#endif
-
-/*  .[utlEmptyString]  A pointer to the empty string "" that provides unique
-**                     representation for the empty string.  
-**  ..
-*/
-
-utl_extern(char *utlEmptyString, = "");
-
-/*   .[utlZero]  Is a constant whose value is 0 and that is to be used in
-**               idioms like '|do { ... } while (utlZero)|.
-**               This is useful to avoid compilers warning about testing
-**               constant values.
-**   ..
-*/
-  
-#ifdef __GNUC__
-#define utlZero 0
-#else
-utl_extern(const int utlZero, = 0);
-#endif
-
-
-/* .% Assumptions (static assertions)
-** ==================================
-**
-** http://www.drdobbs.com/compile-time-assertions/184401873
-*/
-
-#define utl_assum1(e,l) typedef struct {int utl_assumption[(e)?1:-1];} utl_assumption_##l
-#define utl_assum0(e,l) utl_assum1(e,l)
-#define utlAssume(e)    utl_assum0(e,__LINE__)
-
-
-#ifndef UTL_NOTRYCATCH
-
-/* .% Exceptions
-** ============
-**   Exceptions can be very useful when dealing with error conditions is so
-** complicate that the logic of errors handling obscures the logic of the 
-** program itself.
-**   If an error happens in the '|try| section, you can '|throw()| an exception
-** (an error condition) and the control goes back to the '|catch| section
-** where the proper actions can be taken.
-**
-**   Simple implementation of try/catch.
-** .{{ c
-**   tryenv env = NULL;
-**   try(env) {
-**      ... code ...
-**      if (something_failed) throw(env, ERR_OUTOFMEM)  // must be > 0 
-**      some_other_func(env); // you can trhow exceptions from other functions 
-**      ... code ...          // as long as you pass it the try environment.
-**   }  
-**   catch({                  // NOTE the catch part is enclosed in special 
-*       case ERR_OUTOFMEM :   // braces: '|({ ... })| and is the body of a
-**      ... code ...          // '|switch()| statement (including fallthrough!)
-**   });
-** .}}
-**
-**  This comes useful when you throw an exception form a called function.
-**  The example below, handles the "out of mem" condition in the same place
-**  regardless of where the exception was raised.
-**
-** .{{ C
-**
-**   #define ERR_OUTOFMEM 0xF0CA
-**   tryenv env = NULL; // Remember to set to NULL initally!
-**   char *f1(tryenv ee, int x)   { ... throw(ee, ERR_OUTOFMEM} ... }
-**   void *f2(tryenv ee, char *x) { ... throw(ee, ERR_OUTOFMEM} ... }
-**   try(env) {
-**      ... code ...
-**      f1(env,3); 
-**      ... code ...
-**      if ... throw(env,ERR_OUTFOMEM) 
-**      ... code ...
-**      f2(env,"Hello"); 
-**      ... code ...
-**   }  
-**   catch({                    // Note the use of '|({| and '|})| !!
-**      case  ERR_OUTOFMEM : 
-**                 ... code ... // Handle all your cleanup here!
-**                 break;
-**   });
-**
-** .}}
-*/ 
-
-
-typedef struct utl_env_s { 
-  jmp_buf jb;
-  struct utl_env_s volatile *prev;
-  struct utl_env_s volatile **orig;
-} *tryenv; 
-
-#define try(utl_env) \
-            do { struct utl_env_s utl_cur_env; volatile int utl_err; \
-                 utl_cur_env.prev = (void *)utl_env; \
-                 utl_cur_env.orig = (void *)(&utl_env); \
-                 utl_env = &utl_cur_env; \
-                 if ((utl_err = setjmp(utl_cur_env.jb))==0)
-                 
-#define catch(y) if (utl_err) switch (utl_err) { \
-                      y \
-                   } \
-                   utl_err = 0;\
-                  *utl_cur_env.orig = utl_cur_env.prev; \
-                } while(0)
-
-#define throw(env,err) (env? longjmp(((tryenv)env)->jb, err): exit(err))
-#define rethrow        (*utl_cur_env.orig = utl_cur_env.prev,throw(*utl_cur_env.orig,utl_err))
-
-#endif
-
-#ifndef UTL_NOFSM
-/*  .% Finite state machine
-**  =======================
-**
-**    A Finite State Machine (FSM) is very common paradigm for software that respond to 
-**  external events.  There are many ways to code a FSM, this one has the advantage to 
-**  closely mimic the graphical representation of a FSM.
-**
-** .v
-**      fsm ({            // Note the use of '|({| and '|})| !!
-**
-**        case fsmSTART: { ...
-**                   if (c == 0) fsmGoto(z);
-**                   fsmGoto(y);
-**        }
-**
-**        case z : { ...
-**                   break;  // exit from the FSM
-**        }
-**
-**        case y : { ...
-**                   if (c == 1) fsmGoto(x);
-**                   fsmGoto(z);
-**        }
-**      });
-** ..
-**
-**   It's a good practice to include a drawing of the FSM in the technical
-** documentation (e.g including the GraphViz description in comments).
-*/
-
-#define fsmSTART -1
-#define fsmEND   -2
-
-#define fsm(x)  do { int utl_fsm_next , utl_fsm_state; \
-                      for (utl_fsm_next=fsmSTART; utl_fsm_next>fsmEND;) \
-                        switch((utl_fsm_state=utl_fsm_next, utl_fsm_next=fsmEND, utl_fsm_state)) { \
-                        x \
-                }} while (utlZero)
-                         
-#define fsmGoto(x)  utl_fsm_next = (x); break
-#define fsmRestart  utl_fsm_next = fsmSTART; break
-#define fsmExit     utl_fsm_next = fsmEND; break
-
-#endif
-
-#ifdef UTL_UNITTEST
-
-/* .% UnitTest
-** ===========
-**
-**   These macros will help you writing unit tests.  The log produced
-** is '<TAP 1.3=http://testanything.org> compatible and also contains
-** all the information about passing/failing.
-**
-**   They are available only if the symbol '|UTL_UNITTEST| is defined before
-** including the '|utl.h| header.
-** 
-**   '{UTL_UNITTEST} implies '{DEBUG}
-*/
-
-utl_extern(FILE *TST_FILE, = NULL);
-#define TSTFILE (TST_FILE?TST_FILE:stderr)
-
-/* Output is flushed every time to avoid we lose a message in case of
-** abnormal exit. 
-*/
-#define TSTWRITE(...) (fprintf(TSTFILE,__VA_ARGS__),fflush(TSTFILE))
-
-#define TSTTITLE(s) TSTWRITE("TAP version 13\n#\n# ** %s - (%s)\n",s,__FILE__)
-
-#define TST_INIT0 (TSTRES=TSTNUM=TSTGRP=TSTSEC=TSTTOT= \
-                               TSTGTT=TSTGPAS=TSTPASS=TSTNSK=TSTNTD=0)
-                                 
-#define TSTPLAN(s) for (TSTPASSED = TST_INIT0 + 1, TSTTITLE(s); \
-                                             TSTPASSED; TSTDONE(),TSTPASSED=0)
-                       
-/* Tests are divided in sections introduced by '{=TSTSECTION(title)} macro.
-** The macro reset the appropriate counters and prints the section header 
-*/
-#define TSTSECTION(s)  if ((TSTSTAT(), TSTGRP = 0, TSTSEC++, \
-                             TSTWRITE("#\n# * %d. %s (%s:%d)\n", \
-                             TSTSEC, s, __FILE__, __LINE__), TSTPASS=0)) ((void)0); \
-                       else                                               
-
-/* to disable an entire test section, just prepend '|_| or '|X|*/
- 
-#define XTSTSECTION(s) if (!utlZero) ((void)0); else 
-#define _TSTSECTION(s) XTSTSECTION(s)
-
-/* In each section, tests can be logically grouped so that different aspects
-** of related functions can be tested.
-*/
-#define TSTGROUP(s) \
-    if ((TSTWRITE("#\n# *   %d.%d %s\n",TSTSEC,++TSTGRP,s),TSTNUM=0)) ((void)0); else
-                     
-/* to disable a n entire test group , just prepend '|_| or '|X| */
-#define XTSTGROUP(s) if (!utlZero) ((void)0); else  
-#define _TSTGROUP(s) XTSTGROUP(s)
-
-/* Test code will be skipped if needed */
-#define TSTCODE   if (TSTSKP && *TSTSKP)   ((void)0); else  
-#define XTSTCODE  if (!utlZero) ((void)0); else
-#define _TSTCODE  XTSTCODE
-                     
-/* The single test is defined  with the '|TST(s,x)| macro.
-**   .['|s|] is a short string that identifies the test
-**    ['|x|] an assertion that has to be true for the test to succeed.
-**   ..
-*/
-#define XTST(s,x)
-
-#define TST(s,x) (TST_DO(s,((TSTSKP && *TSTSKP)?1:(x))),TST_WRDIR, TSTWRITE("\n"), TSTRES)
-
-#define TST_DO(s,x) (TSTRES = (x), TSTGTT++, TSTTOT++, TSTNUM++, \
-                     TSTPASSED = (TSTPASSED && (TSTRES || TSTTD)), \
-                     TSTWRITE("%s %4d - %s (:%d)", \
-                              (TSTRES? (TSTGPAS++,TSTPASS++,TSTOK) : TSTKO), \
-                               TSTGTT, s, __LINE__))
-
-#define TST_WRDIR \
-           ((TSTSKP && *TSTSKP)? (TSTNSK++, TSTWRITE(" # SKIP %s",TSTSKP)) \
-                   : (TSTTD ? (TSTNTD++, (TSTWRITE(" # TODO %s%s",TSTTD, \
-                                        (TSTRES?TSTWRN:utlEmptyString)))) : 0))
-
-#define TSTFAILED  (!TSTRES)
-
-/* You can skip a set of tests giving a reason.
-** Nested skips are not supported!
-*/
-#define TSTSKIP(x,r) for (TSTSKP=(x)?r:utlEmptyString; TSTSKP; TSTSKP=NULL)
-
-#define TSTTODO(r)   for (TSTTD=r; TSTTD; TSTTD=NULL)
-
-#define TSTNOTE(...) \
-                 (TSTWRITE("#      "),TSTWRITE(__VA_ARGS__), TSTWRITE("\n"))
-                                            
-#define TSTFAILNOTE(...) (TSTRES? 0 : (TSTNOTE(__VA_ARGS__)))
-
-#define TSTEXPECTED(f1,v1,f2,v2) \
-                             (TSTRES? 0 : (TSTNOTE("Expected "f1" got "f2,v1,v2)))
-
-#define TST_INT(s,e,r,o) do { int utl_exp = (e); int utl_ret = (r);\
-                             TST(s,utl_exp o utl_ret);\
-                             TSTEXPECTED("(int) "#o" %d",utl_exp,"%d",utl_ret); \
-                           } while (utlZero)
-
-                             
-#define TSTEQINT(s,e,r)  TST_INT(s,e,r, == )
-#define TSTNEQINT(s,e,r) TST_INT(s,e,r, != )
-#define TSTLTINT(s,e,r)  TST_INT(s,e,r, < )
-#define TSTLEINT(s,e,r)  TST_INT(s,e,r, <= )
-#define TSTGTINT(s,e,r)  TST_INT(s,e,r, > )
-#define TSTGEINT(s,e,r)  TST_INT(s,e,r, >= )
-
-#define TST_PTR(s,e,r,o)  do { void *utl_exp = (e); void *utl_ret = (r); \
-                              TST(s,utl_exp o utl_ret) ; \
-                              TSTEXPECTED("(ptr) "#o" 0x%p",utl_exp,"0x%p",utl_ret); \
-                            }  while (utlZero)
-
-                           
-#define TSTEQPTR(s,e,r)  TST_PTR(s,e,r, == )
-#define TSTNEQPTR(s,e,r) TST_PTR(s,e,r, != )
-#define TSTNULL(s,r)     TSTEQPTR(s,NULL,r)
-#define TSTNNULL(s,r)    TSTNEQPTR(s,NULL,r)
-
-              
-#define TSTBAILOUT(r) \
-          if (!(r)) ((void)0); else {TSTWRITE("Bail out! %s\n",r); TSTDONE(); exit(0);}
-
-/* At the end of a section, the accumulated stats can be printed out */
-#define TSTSTAT() \
-          (TSTTOT == 0 ? 0 : ( \
-           TSTWRITE("#\n# SECTION %d OK: %d/%d\n",TSTSEC,TSTPASS,TSTTOT), \
-           TSTTOT = 0))
-
-/* At the end of all the tests, the accumulated stats can be printed out */
-#define TSTDONE() \
-  (TSTGTT <= 0 ? 0 : ( TSTSTAT(),  \
-  TSTWRITE("#\n# TOTAL OK: %d/%d SKIP: %d TODO: %d\n",TSTGPAS,TSTGTT, \
-                                                              TSTNSK,TSTNTD), \
-  TSTWRITE("#\n# TEST PLAN: %s \n",TSTPASSED ? "PASSED" : "FAILED"), \
-  TSTWRITE("#\n1..%d\n",TSTGTT),fflush(TSTFILE)) )
-
-/* Execute a statement if a test succeeded */
-#define TSTIF_OK  if (TSTRES)
-
-/* Execute a statement if a test failed */
-#define TSTIF_NOTOK if (!TSTRES)
-
-static int    TSTRES    = 0;  /* Result of the last performed '|TST()| */
-static int    TSTNUM    = 0;  /* Last test number */
-static int    TSTGRP    = 0;  /* Current test group */
-static int    TSTSEC    = 0;  /* Current test SECTION*/
-static int    TSTTOT    = 0;  /* Number of tests executed */
-static int    TSTGTT    = 0;  /* Number of tests executed (Grand Total) */
-static int    TSTGPAS   = 0;  /* Number of tests passed (Grand Total) */
-static int    TSTPASS   = 0;  
-static int    TSTPASSED = 1;  
-static int    TSTNSK    = 0;  
-static int    TSTNTD    = 0;  
-static char  *TSTSKP    = NULL;
-static char  *TSTTD     = NULL;
-
-static const char *TSTOK  = "ok    ";
-static const char *TSTKO  = "not ok";
-static const char *TSTWRN = " (passed unexpectedly!)";
-
-
-#endif /* UTL_UNITTEST */
-
-/* .% Logging
-** ==========
-**
-*/
-
-#define log_D 7
-#define log_I 6
-#define log_M 5
-#define log_W 4
-#define log_E 3
-#define log_C 2
-#define log_A 1
-#define log_F 0
-
-
-#define log_X (log_D + 1)
-#define log_L (log_D + 2)
-
-
-/* Logging functions are available unless the symbol '{=UTL_NOLOGGING}
-** has been defined before including '|utl.h|.
-*/
-
-#ifndef UTL_NOLOGGING
-
-#define UTL_LOG_NEW 0x00    
-#define UTL_LOG_ADD 0x01    /* append to existing file */
-#define UTL_LOG_ERR 0x02    /* use stderr */
-#define UTL_LOG_OUT 0x04    /* use stdout */
-
-typedef struct {
-  FILE          *file;
-  unsigned char  level;
-  unsigned char  flags;
-  unsigned short rot;
-  char          *pre;
-} utl_log_s, *utlLogger;
-
-#define utl_log_stdout_init {NULL, log_W, UTL_LOG_OUT,0,NULL}
-utl_extern(utl_log_s utl_log_stdout , = utl_log_stdout_init);
-#define logStdout (&utl_log_stdout)
-
-#define utl_log_stderr_init {NULL, log_W, UTL_LOG_ERR,0,NULL}
-utl_extern(utl_log_s utl_log_stderr , = utl_log_stderr_init);
-#define logStderr (&utl_log_stderr)
-
-#define logNull NULL
-
-utl_extern(utlLogger utl_logger , = logNull);
-
-#include <time.h>
-#include <ctype.h>
-
-/* .%% Logging levels
-** ~~~~~~~~~~~~~~~~~~
-**
-**   Logging levels are hierarchical and structured. Default log level is WARN.
-**
-**   Use '{=logLevel()}    to set the desired level of logging.
-**   Use '{=logLevelEnv()} to set the desired level of logging based on an
-**                         enviroment variable.
-*/
-
-                                    /* 0   1   2   3   4   5   6   7   8   9    */
-                                    /* 0   4   8   12  16  20  24  28  32  36   */
-utl_extern(char const utl_log_abbrev[], = "FTL ALT CRT ERR WRN MSG INF DBG OFF LOG ");
-
-int   utl_log_level(utlLogger lg);
-int   utl_log_chrlevel(char *l);
-int   logLevel(utlLogger lg, char *lv); 
-int   logLevelEnv(utlLogger lg, char *var, char *level);
-
-/*
-** The table below shows whether a message of a certain level will be
-** printed (Y) or not (N) given the current level of logging.
-** .v
-**                          message level 
-**                    DBG INF MSG WRN ERR CRT ALT FTL
-**               DBG   Y   Y   Y   Y   Y   Y   Y   Y
-**               INF   N   Y   Y   Y   Y   Y   Y   Y
-**               MSG   N   N   Y   Y   Y   Y   Y   Y
-**      current  WRN   N   N   N   Y   Y   Y   Y   Y
-**      logging  ERR   N   N   N   N   Y   Y   Y   Y
-**       level   CRT   N   N   N   N   N   Y   Y   Y
-**               ALT   N   N   N   N   N   N   Y   Y
-**               FTL   N   N   N   N   N   N   N   Y
-**               OFF   N   N   N   N   N   N   N   N
-** ..
-*/
-
-/* .%% Logging file rotate
-** ~~~~~~~~~~~~~~~~~~~~~~~
-**
-** For long running programs (servers, daemons, ...) it is important to rotate 
-** the log files from time to time so that they won't become too big.
-** The function logRotateOn() will check the current size of the log file and 
-** if it's bigger than the threshold specified, will close it and open a new
-** one with the same name and numbering it.
-** Then new file will be renamed _1, _2, etc.
-**
-**   logRotate(lg,n)
-**
-*/
-
-
-/* .%% Logging format
-** ~~~~~~~~~~~~~~~~~~
-** 
-** Log files have the following format:
-** .v
-**     <date> <time> <level> <message>
-** ..
-**
-**  For example:
-** .v
-**     2009-01-29 13:46:02 ERR An error!
-**     2009-01-29 13:46:02 FTL An unrecoverable error
-** ..
-**
-*/
-
-/* .%% Loggers
-** ~~~~~~~~~~~
-/*    Log files can be opened in "write" or "append" mode as any normal file 
-** using the '{=logOpen()} function.
-** For example:
-** .v  
-**   utlLogger lgr = NULL;
-**   logOpen(lgr,"file1.log","w") // Delete old log file and create a new one
-**   ...
-**   logOpen(lgr,"file1.log","a") // Append to previous log file
-** .. 
-**
-**   There are three predefined loggers:
-**   .[{logNull}]    A null logger that won't output any message
-**    [{logStdout}]  A logger that will output on stdout
-**    [{logStderr}]  A logger that will output on stderr
-**   ..
-** They are '{logClose()} safe, i.e. you can pass them to logClose() and nothing
-** bad will happen.
-*/
-
-#define logOpen(f,m)   utl_logOpen(f,m)
-#define logClose(l)    utl_log_close(l)
-
-#define logPre(l,s)      ((l)->pre = s)
-
-utlLogger utl_logOpen(char *fname, char *mode);
-utlLogger utl_logClose(utlLogger lg);
-void utl_log_write(utlLogger lg,int lv, int tstamp, char *format, ...);
-
-#define logFile(l) utl_logFile(l)
-#define logLevel(lg,lv)      utl_logLevel(lg,lv)
-#define logLevelEnv(lg,v,l)  utl_logLevelEnv(lg,v,l)
-
-#define logIf(lg,lc) utl_log_if(lg,utl_log_chrlevel(lc))
-
-#define utl_log_if(lg,lv) if ((lv) > utl_log_level(lg)) ((void)0) ; else
-          
-#define logDebug(lg, ...)      utl_log_write(lg, log_D, 1, __VA_ARGS__)
-#define logInfo(lg, ...)       utl_log_write(lg, log_I, 1, __VA_ARGS__)
-#define logMessage(lg, ...)    utl_log_write(lg, log_M, 1, __VA_ARGS__)
-#define logWarn(lg, ...)       utl_log_write(lg, log_W, 1, __VA_ARGS__)
-#define logError(lg, ...)      utl_log_write(lg, log_E, 1, __VA_ARGS__)
-#define logCritical(lg, ...)   utl_log_write(lg, log_C, 1, __VA_ARGS__)
-#define logAlarm(lg, ...)      utl_log_write(lg, log_A, 1, __VA_ARGS__)
-#define logFatal(lg, ...)      utl_log_write(lg, log_F, 1, __VA_ARGS__)
-
-#define logDContinue(lg, ...)  utl_log_write(lg, log_D, 0, __VA_ARGS__)
-#define logIContinue(lg, ...)  utl_log_write(lg, log_I, 0, __VA_ARGS__)
-#define logMContinue(lg, ...)  utl_log_write(lg, log_M, 0, __VA_ARGS__)
-#define logWContinue(lg, ...)  utl_log_write(lg, log_W, 0, __VA_ARGS__)
-#define logEContinue(lg, ...)  utl_log_write(lg, log_E, 0, __VA_ARGS__)
-#define logCContinue(lg, ...)  utl_log_write(lg, log_C, 0, __VA_ARGS__)
-#define logAContinue(lg, ...)  utl_log_write(lg, log_A, 0, __VA_ARGS__)
-#define logFContinue(lg, ...)  utl_log_write(lg, log_F, 0, __VA_ARGS__)
-
-#define logAssert(lg,e)        utl_log_assert(lg, e, #e, __FILE__, __LINE__)
-
-/*
-** .v
-**   logError("Too many items at counter %d (%d)",numcounter,numitems);
-**   logContinue("Occured %d times",times++);
-** ..
-** will produce:
-** .v
-**     2009-01-29 13:46:02 ERR Too many items at counter 9 (5)
-**                             Occured 3 times
-** ..
-*/
-
-#ifdef UTL_LIB
-int   utl_log_level(utlLogger lg) { return (int)(lg ? lg->level : log_X) ; }
-
-FILE *utl_logFile(utlLogger lg)
-{
-  if (!lg) return NULL;
-  if (lg->flags & UTL_LOG_ERR) return stderr;
-  if (lg->flags & UTL_LOG_OUT) return stdout;
-  return lg->file;
-}
-
-int   utl_log_chrlevel(char *l) {
-  int i=0;
-  char c = l ? toupper(l[0]) : 'W';
-  
-  while (utl_log_abbrev[i] != ' ' && utl_log_abbrev[i] != c) i+=4;
-  i = (i <= 4*7) ? (i>> 2) : log_W;
-  return i;
-}
-
-
-int utl_logLevel(utlLogger lg, char *lv) 
-{
-  if (!lg) return log_X;
-  
-  if (lv && lv[0] && lv[0] != '?')
-      lg->level = utl_log_chrlevel(lv);
-  return utl_log_level(lg);  
-}
-
-int utl_logLevelEnv(utlLogger lg, char *var, char *level)
-{
-  char *lvl_str;
-  
-  lvl_str=getenv(var);
-  if (!lvl_str) lvl_str = level;
-  return utl_logLevel(lg,lvl_str);
-}
-
-utlLogger utl_logOpen(char *fname, char *mode)
-{
-  char md[4];
-  utlLogger lg = logStderr;
-  FILE *f = NULL;
-  
-  if (fname) {
-    md[0] = mode[0]; md[1] = '+'; md[2] = '\0';
-    if (md[0] != 'a' && md[0] != 'w') md[0] = 'a'; 
-    f = fopen(fname,md);
-  }
-  
-  if (f) {
-    lg = malloc(sizeof(utl_log_s));
-    if (lg) { 
-      lg->flags = 0;
-      lg->rot = 0;
-    lg->pre = NULL;
-      lg->file = f;
-    /* Assume that log_L is the last level in utl_log_abbrev */
-    utlAssume( (log_L +1) == ((sizeof(utl_log_abbrev)-1)>>2));
-      lg->level = log_L;
-      utl_log_write(lg,log_L, 1, "%s \"%s\"", (md[0] == 'a') ? "ADDEDTO" : "CREATED",fname); 
-      
-      lg->level = log_W;
-    }
-  }
-  if (f && !lg) fclose(f);
-  return lg;
-}
-
-utlLogger utl_log_close(utlLogger lg)
-{
-  if (lg && lg != logStdout && lg != logStderr) {
-    if (lg->file) fclose(lg->file);
-    lg->file = NULL;
-    free(lg);
-  }
-  return NULL;
-}
-
-/* 
-** if limit reached, close the log and open a new one incrementing
-** the name.
-**      mylog.log
-**      mylog_001.log
-**      mylog_002.log
-**       etc...
-*/
-static void utl_log_rotate(utlLogger lg)
-{
-  // TODO:
-}
-
-void utl_log_write(utlLogger lg, int lv, int tstamp, char *format, ...)
-{
-  va_list args;
-  char tstr[32];
-  time_t t;
-  FILE *f = stderr;
-  int lg_lv = log_W;
-  
-  if (!lg) return; 
-  
-  if (lg->flags & UTL_LOG_OUT) f = stdout;
-  else if (lg->flags & UTL_LOG_ERR) f = stderr;
-  else f = lg->file;
-  
-  lg_lv = lg->level;
-  lv = lv & 0x0F;
-  if( lv <= lg_lv) {
-    if (tstamp) {
-      time(&t);
-      strftime(tstr,32,"%Y-%m-%d %X",localtime(&t));
-    } else {
-      strcpy(tstr,"                   ");          
-    }
-    if (lg->pre) fprintf(f, "%s ",lg->pre);
-    fprintf(f, "%s %.4s", tstr, utl_log_abbrev+(lv<<2));
-    va_start(args, format);  vfprintf(f,format, args);  va_end(args);
-    fputc('\n',f);
-    fflush(f);
-    if (lg->rot >0) utl_log_rotate(lg);
-  }    
-}
-
-void utl_log_assert(utlLogger lg,int e,char *estr, char *file,int line)
-{ 
-  if (!e) {
-    logFatal(lg,"Assertion failed:  %s, file %s, line %d", estr, file, line);
-#ifndef NDEBUG
-  abort();
-#endif
-  }
-}
-                 
-#endif  /*- UTL_LIB */
-
-#else   /*- UTL_NOLOGGING */
-
-#define logLevel(lg,lv)       log_W
-#define logLevelEnv(lg,v,l)   log_W     
-#define logDebug(lg, ...)     ((void)0)
-#define logInfo(lg, ...)      ((void)0)
-#define logMessage(lg, ...)   ((void)0)
-#define logWarn(lg, ...)      ((void)0)
-#define logError(lg, ...)     ((void)0)
-#define logCritical(lg, ...)  ((void)0)
-#define logAlarm(lg, ...)     ((void)0)
-#define logFatal(lg, ...)     ((void)0)
-
-#define logDContinue(lg, ...) ((void)0)
-#define logIContinue(lg, ...) ((void)0)
-#define logMContinue(lg, ...) ((void)0)
-#define logWContinue(lg, ...) ((void)0)
-#define logEContinue(lg, ...) ((void)0)
-#define logCContinue(lg, ...) ((void)0)
-#define logAContinue(lg, ...) ((void)0)
-#define logFContinue(lg, ...) ((void)0)
-
-#define logAssert(lg,e)       ((void)0)
-
-#define logIf(lg,lv) if (!utlZero) (void)0 ; else
-
-#define logOpen(f,m)    NULL
-#define logClose(lg)    NULL
-
-typedef void *utlLogger;
-
-#define logFile(x) NULL
-#define logStdout  NULL
-#define logStderr  NULL
-
-#endif /*- UTL_NOLOGGING */
-
-#ifdef NDEBUG
-#undef logDebug
-#define logDebug(lg,...) ((void)0)
-#endif  /*- NDEBUG */
-
-#define logNDebug(lg,...) ((void)0)
-
-/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
-
-/*  .% Traced memory
-**  ================
-*/
-#define utlMemInvalid    -2
-#define utlMemOverflow   -1
-#define utlMemValid       0
-#define utlMemNull        1
-
-#ifdef UTL_MEMCHECK
-void *utl_malloc  (size_t size, char *file, int line );
-void *utl_calloc  (size_t num, size_t size, char *file, int line);
-void *utl_realloc (void *ptr, size_t size, char *file, int line);
-void  utl_free    (void *ptr, char *file, int line );
-void *utl_strdup  (void *ptr, char *file, int line);
-
-int utl_check(void *ptr,char *file, int line);
-
-utl_extern(utlLogger utlMemLog , = &utl_log_stderr);
-
-#ifdef UTL_LIB
-/*************************************/
-
-static char *BEG_CHK = "\xBE\xEF\xF0\x0D";
-static char *END_CHK = "\xDE\xAD\xC0\xDA";
-static char *CLR_CHK = "\xDE\xFA\xCE\xD0";
-
-static size_t utl_mem_allocated = 0;
-
-typedef struct {
-   size_t size;
-   char   chk[4];
-   char   data[4];
-} utl_mem_t;
-
-#define utl_mem(x) ((utl_mem_t *)((char *)(x) -  offsetof(utl_mem_t, data)))
-
-int utl_check(void *ptr,char *file, int line)
-{
-  utl_mem_t *p;
-  
-  if (ptr == NULL) return utlMemNull;
-  p = utl_mem(ptr);
-  if (memcmp(p->chk,BEG_CHK,4)) { 
-    logError(utlMemLog,"Invalid or double freed %p (%u %s %d)",p->data, \
-                                               utl_mem_allocated, file, line);     
-    return utlMemInvalid; 
-  }
-  if (memcmp(p->data+p->size,END_CHK,4)) {
-    logError(utlMemLog,"Boundary overflow detected %p [%d] (%u %s %d)", \
-                              p->data, p->size, utl_mem_allocated, file, line); 
-    return utlMemOverflow;
-  }
-  logInfo(utlMemLog,"Valid pointer %p (%u %s %d)",ptr, utl_mem_allocated, file, line); 
-  return utlMemValid; 
-}
-
-void *utl_malloc(size_t size, char *file, int line )
-{
-  utl_mem_t *p;
-  
-  if (size == 0) logWarn(utlMemLog,"Shouldn't allocate 0 bytes (%u %s %d)", \
-                                                utl_mem_allocated, file, line);
-  p = malloc(sizeof(utl_mem_t) +size);
-  if (p == NULL) {
-    logCritical(utlMemLog,"Out of Memory (%u %s %d)",utl_mem_allocated, file, line);
-    return NULL;
-  }
-  p->size = size;
-  memcpy(p->chk,BEG_CHK,4);
-  memcpy(p->data+p->size,END_CHK,4);
-  utl_mem_allocated += size;
-  logInfo(utlMemLog,"alloc %p [%d] (%u %s %d)",p->data,size,utl_mem_allocated,file,line);
-  return p->data;
-};
-
-void *utl_calloc(size_t num, size_t size, char *file, int line)
-{
-  void *ptr;
-  
-  size = num * size;
-  ptr = utl_malloc(size,file,line);
-  if (ptr)  memset(ptr,0x00,size);
-  return ptr;
-};
-
-void utl_free(void *ptr, char *file, int line)
-{
-  utl_mem_t *p=NULL;
-  
-  switch (utl_check(ptr,file,line)) {
-    case utlMemNull  :    logWarn(utlMemLog,"free NULL (%u %s %d)", 
-                                                utl_mem_allocated, file, line);
-                          break;
-                          
-    case utlMemOverflow : logWarn(utlMemLog, "Freeing an overflown block  (%u %s %d)", 
-                                                           utl_mem_allocated, file, line);
-    case utlMemValid :    p = utl_mem(ptr); 
-                          memcpy(p->chk,CLR_CHK,4);
-                          utl_mem_allocated -= p->size;
-                          if (p->size == 0)
-                            logWarn(utlMemLog,"Freeing a block of 0 bytes (%u %s %d)", 
-                                                utl_mem_allocated, file, line);
-
-                          logInfo(utlMemLog,"free %p [%d] (%u %s %d)", ptr, 
-                                    p?p->size:0,utl_mem_allocated, file, line);
-                          free(p);
-                          break;
-                          
-    case utlMemInvalid :  logError(utlMemLog,"free an invalid pointer! (%u %s %d)", \
-                                                utl_mem_allocated, file, line);
-                          break;
-  }
-}
-
-void *utl_realloc(void *ptr, size_t size, char *file, int line)
-{
-  utl_mem_t *p;
-  
-  if (size == 0) {
-    logWarn(utlMemLog,"realloc() used as free() %p -> [0] (%u %s %d)",ptr,utl_mem_allocated, file, line);
-    utl_free(ptr,file,line); 
-  } 
-  else {
-    switch (utl_check(ptr,file,line)) {
-      case utlMemNull   : logWarn(utlMemLog,"realloc() used as malloc() (%u %s %d)", \
-                                             utl_mem_allocated, file, line);
-                          return utl_malloc(size,file,line);
-                        
-      case utlMemValid  : p = utl_mem(ptr); 
-                          p = realloc(p,sizeof(utl_mem_t) + size); 
-                          if (p == NULL) {
-                            logCritical(utlMemLog,"Out of Memory (%u %s %d)", \
-                                             utl_mem_allocated, file, line);
-                            return NULL;
-                          }
-                          utl_mem_allocated -= p->size;
-                          utl_mem_allocated += size; 
-                          logInfo(utlMemLog,"realloc %p [%d] -> %p [%d] (%u %s %d)", \
-                                          ptr, p->size, p->data, size, \
-                                          utl_mem_allocated, file, line);
-                          p->size = size;
-                          memcpy(p->chk,BEG_CHK,4);
-                          memcpy(p->data+p->size,END_CHK,4);
-                          ptr = p->data;
-                          break;
-    }
-  }
-  return ptr;
-}
-
-void *utl_strdup(void *ptr, char *file, int line)
-{
-  char *dest;
-  size_t size;
-  
-  if (ptr == NULL) {
-    logWarn(utlMemLog,"strdup NULL (%u %s %d)", utl_mem_allocated, file, line);
-    return NULL;
-  }
-  size = strlen(ptr)+1;
-
-  dest = utl_malloc(size,file,line);
-  if (dest) memcpy(dest,ptr,size);
-  logInfo(utlMemLog,"strdup %p [%d] -> %p (%u %s %d)", ptr, size, dest, \
-                                                utl_mem_allocated, file, line);
-  return dest;
-}
-#undef utl_mem
-
-/*************************************/
-#endif
-
-#define malloc(n)     utl_malloc(n,__FILE__,__LINE__)
-#define calloc(n,s)   utl_calloc(n,s,__FILE__,__LINE__)
-#define realloc(p,n)  utl_realloc(p,n,__FILE__,__LINE__)
-#define free(p)       utl_free(p,__FILE__,__LINE__)
-#define strdup(p)     utl_strdup(p,__FILE__,__LINE__)
-
-#define utlMemCheck(p)    utl_check(p,__FILE__, __LINE__)
-#define utlMemAllocated   utl_mem_allocated
-#define utlMemValidate(p) utl_mem_validate(p)
-
-#define utlMalloc(n)     utl_malloc(n,__FILE__,__LINE__)
-#define utlCalloc(n,s)   utl_calloc(n,s,__FILE__,__LINE__)
-#define utlRealloc(p,n)  utl_realloc(p,n,__FILE__,__LINE__)
-#define utlFree(p)       utl_free(p,__FILE__,__LINE__)
-#define utlStrdup(p)     utl_strdup(p,__FILE__,__LINE__)
-
-#else /* UTL_MEMCHECK */
-
-#define utlMemCheck(p) utlMemValid
-#define utlMemAllocated 0
-#define utlMemValidate(p) (p)
-
-#endif /* UTL_MEMCHECK */
-
-#ifndef UTL_NOADT
-
-typedef struct vec_s {
-  size_t  max;
-  size_t  cnt;
-  size_t  esz;
-  void   *vec;
-} *vec_t;
-
-vec_t utl_vecNew(size_t esz);
-#define vecNew(ty) utl_vecNew(sizeof(ty))
-
-vec_t utl_vecFree(vec_t v);
-#define vecFree utl_vecFree
-
-int utl_vecSet(vec_t v, size_t i, void *e);
-#define vecSet utl_vecSet
-
-int utl_vecAdd(vec_t v, void *e);
-#define vecAdd  utl_vecAdd
-
-void *utl_vecGet(vec_t v, size_t  i);
-#define vecGet utl_vecGet
-
-int utl_vecResize(vec_t v, size_t n);
-#define vecResize utl_vecResize
-
-size_t utl_vecCount(vec_t v);
-#define vecCount     utl_vecCount
-
-size_t utl_vecMax(vec_t v);
-#define vecMax     utl_vecMax
-
-void  *utl_vecVec(vec_t v);
-#define vec(v,ty)   ((ty *)utl_vecVec(v))
-
-#define buf_t vec_t
-int utl_bufSet(buf_t bf, size_t i, char c);
-
-#define bufNew() utl_vecNew(1)
-#define bufFree  utl_vecFree
-
-char utl_bufGet(buf_t bf, size_t i);
-#define bufGet   utl_bufGet
-
-int utl_bufSet(buf_t bf, size_t i, char c);
-#define bufSet   utl_bufSet
-
-int utl_bufAdd(buf_t bf, char c);
-#define bufAdd   utl_bufAdd
-
-int utl_bufAddStr(buf_t bf, char *s);
-#define bufAddStr  utl_bufAddStr
-
-#define bufResize utl_vecResize
-
-#define bufClr(bf) utl_bufSet(bf,0,'\0');
-
-int utl_bufFormat(buf_t bf, char *format, ...);
-#define bufFormat utl_bufFormat
-
-#define bufLen vecCount
-#define bufMax vecMax
-#define bufStr(b) vec(b,char)
-
-int utl_bufAddLine(buf_t bf, FILE *f);
-#define bufAddLine utl_bufAddLine
-
-int utl_bufAddFile(buf_t bf, FILE *f);
-#define bufAddFile utl_bufAddFile
-
-#if !defined(UTL_HAS_SNPRINTF) && defined(_MSC_VER) && (_MSC_VER < 1800)
-#define UTL_ADD_SNPRINTF
-#define snprintf  c99_snprintf
-#define vsnprintf c99_vsnprintf
-#endif
-
-#ifdef UTL_LIB
-
-vec_t utl_vecNew(size_t esz)
-{
-  vec_t v;
-  v = malloc(sizeof(struct vec_s));
-  if (v) {
-    v->max = 0;    v->cnt = 0;
-    v->esz = esz;  v->vec = NULL;
-  }
-  return v;
-}
-
-vec_t utl_vecFree(vec_t v)
-{
-  if (v) {
-    if (v->vec) free(v->vec);
-    v->max = 0;  v->cnt = 0;
-    v->esz = 0;  v->vec = NULL;
-    free(v);
-  }
-  return NULL;
-}
-
-size_t utl_vecCount(vec_t v) { return v? v->cnt : 0; }
-size_t utl_vecMax(vec_t v)   { return v? v->max : 0; }
-void  *utl_vecVec(vec_t v)   { return v? v->vec : NULL; } 
-
-static int utl_vec_expand(vec_t v, size_t i)
-{
-  unsigned long new_max;
-  char *new_vec = NULL;
-   
-  if (!v) return 0;
-   
-  new_max = v->max;
-  
-  if (new_max < 8) new_max = 8;
-
-  while (new_max <= i) new_max *= 2; /* double */
-   
-  if (new_max > v->max) {
-    new_vec = realloc(v->vec,new_max * v->esz);
-    if (!new_vec) return 0;
-    v->vec = new_vec;
-    v->max = new_max;
-  }
-  return 1;
-}
-
-int utl_vecSet(vec_t v, size_t  i, void *e)
-{
-  if (!utl_vec_expand(v,i)) return 0;
-  
-  memcpy(((char *)(v->vec)) + (i * v->esz),e,v->esz);
-  if (i >= v->cnt) v->cnt = i+1;
-  return 1;
-}
-
-void *utl_vecGet(vec_t v, size_t i)
-{
-  if (!v) return '\0';
-  if (i >= v->cnt) return NULL;
-  return ((char *)(v->vec)) + (i*v->esz);
-}
-
-int utl_vecAdd(vec_t v, void *e)
-{
-  return utl_vecSet(v,v->cnt,e);
-}
-
-int utl_vecResize(vec_t v, size_t n)
-{
-  size_t new_max = 1;
-  char *new_vec = NULL;
-  if (!v) return 0;
-
-  while (new_max <= n) new_max *= 2;
-  
-  if (new_max != v->max) {
-    new_vec = realloc(v->vec,new_max * v->esz);
-    if (!new_vec) return 0;
-    v->vec = new_vec;
-    v->max = new_max;
-    if (v->cnt > v->max) v->cnt = v->max;
-  }
-  
-  return 1;
-}
-
-int utl_bufSet(buf_t bf, size_t i, char c)
-{
-  char *s;
-
-  if (!utl_vec_expand(bf,i+1)) return 0;
-  s = bf->vec;
-  s[i] = c;
-  if (c == '\0') {
-    bf->cnt = i;
-  }
-  else if (i >= bf->cnt) {
-    s[i+1] = '\0';
-    bf->cnt = i+1;
-  }
-  return 1;
-}
-
-char utl_bufGet(buf_t bf, size_t i)
-{
-  if (!bf) return '\0';
-  if (i >= bf->cnt) return '\0';
-  return ((char*)(bf->vec))[i];
-}
-
-int utl_bufAdd(buf_t bf, char c)
-{  return utl_bufSet(bf,bf->cnt,c); }
-
-int utl_bufAddStr(buf_t bf, char *s)
-{
-  if (!bf) return 0;
-  if (!s || !*s) return 1;
-  
-  while (*s) if (!utl_bufSet(bf,bf->cnt,*s++)) return 0;
-  
-  return utl_bufAdd(bf,'\0');
-}
-
-/* A line in the file can be ended by '\r\n', '\n' or '\r'.
-** The NEWLINE characters are discarded.
-** The string in the buffer is terminated with '\n\0'. 
-*/
-int utl_bufAddLine(buf_t bf, FILE *f)
-{
-  int c = 0;
-  int n = 0;
-  do {
-    switch ((c = fgetc(f))) {
-      case '\r' : if ((c = fgetc(f)) != '\n') ungetc(c,f);
-      case '\n' :
-      case EOF  : c = EOF; utl_bufAdd(bf,'\n'); break;
-      default   : utl_bufAdd(bf,(char)c); n++; break;
-    }
-  } while (c != EOF);
-  return n;
-}
-
-int utl_bufAddFile(buf_t bf, FILE *f)
-{
-  int c = 0;
-  int n = 0;
-  do {
-    switch ((c = fgetc(f))) {
-      case EOF  : c = EOF; break;
-      default   : utl_bufAdd(bf,(char)c); n++; break;
-    }
-  } while (c != EOF);
-  return n;
-}
-
-
-/* {{ code from http://stackoverflow.com/questions/2915672 */
-#ifdef UTL_ADD_SNPRINTF
-
-inline int c99_snprintf(char* str, size_t size, const char* format, ...)
-{
-  int count;
-  va_list ap;
-  va_start(ap, format);
-  count = c99_vsnprintf(str, size, format, ap);
-  va_end(ap);
-  return count;
-}
-
-inline int c99_vsnprintf(char* str, size_t size, const char* format, va_list ap)
-{
-  int count = -1;
-  if (size != 0)   count = _vsnprintf_s(str, size, _TRUNCATE, format, ap);
-  if (count == -1) count = _vscprintf(format, ap);
-  return count;
-}
-#endif // UTL_ADD_SNPRINTF
-/* }} */
-
-int utl_bufFormat(buf_t bf, char *format, ...)
-{
-  int count;
-  va_list ap;
-
-  if (!bf) return -1;
-  
-  va_start(ap, format);
-  count = vsnprintf(NULL,0,format, ap);
-  utl_bufSet(bf,count,'\0'); /* ensure there's enough room */
-  count = vsprintf(bufStr(bf),format, ap);
-  va_end(ap);
-  
-  return count;
-}
-
-#endif
-#endif /* UTL_NOADT */
-
-/*#define UTL_NOMATCH*/
-#ifndef UTL_NOMATCH
-
-/*
-  pmx = term
-  term = atom ('|' atom)*
-  atom = op? (class | char | '(' term ')' | '{' term '}')
-  class = '%' classid | '[' '^'? range+ ']' 
-  range = char | char '-' char
-  op = '*' | '?' | '+' | '!'
-  
-  %a alpha-numeric
-  %x hex digit
-  %d digit
-  %s space
-  %n newline
-  %w white space (no nl)
-  %l letter 
-  
-  %f floating point
-  %i integer
-  %b balanced
-  %e escape
-*/
-
-typedef struct {
-  char *orig_str;
-  char *orig_pat;
-  char *cur_str;
-  char *cur_pat;
-  int   cur_lvl;
-  int   nmatches;
-  char *matches[10][2];
-} pmx_t;
-
-#define cur_pat(p)   (p)->cur_pat
-#define adv_pat(p)   ((p)->cur_pat += 1)
-
-#define cur_str(p)   ((p)->cur_str)
-#define adv_str(p)   ((p)->cur_str += 1)
-
-#define cur_start(p) (p)->matches[(p)->cur_lvl][0]
-#define cur_end(p)   (p)->matches[(p)->cur_lvl][0]
-#define cur_level(p) (p)->cur_lvl
-
-int utl_pmxMatch(char *pat, char *str, pmx_t *p);
-#define pmxMatch utl_pmxMatch
-
-#ifdef UTL_LIB
-
-static utl_skipatom(pmx_t *p)
-{
-  char *pat = cur_pat(p);
-  int cnt = 0;
-  
-  if (!*pat) return;
-  if (strchr("*?+!",*pat)) pat++;
-  if (*pat == '%') { if (*++pat) pat++;}
-  else if (*pat == '[' ) {
-    if (*++pat == ']') *pat++;
-    while (*pat && *pat++ != ']') ;
-  } 
-  else if (*pat == '(') {
-    pat++;
-    while (*pat) {
-      if (*pat == '(') cnt++;
-      else if (*pat == ')') if (--cnt == 0) {pat++; break;}
-      pat++;
-    }
-  }
-  else pat++;
-  cur_pat(p) = pat;
-}
-
-static int utl_atom(pmx_t *p)
-{
-  int r = 0;
-  char *str = cur_str(p);
-  char *pat = cur_pat(p);
-  if (*pat == '\0') {r = 1; }
-  else if (*pat == '%') {
-    switch (*++pat) {
-      case 'd' : if (isdigit(*str)) {r = 1; str++;}  break;
-      case 'a' : if (isalpha(*str)) {r = 1; str++;}  break;
-    }
-  }
-  else {
-    if (*pat == *str) {r = 1;  str++;}
-    pat++;
-  }
-  if (r) {
-    if (cur_start(p) == NULL) cur_start(p) = cur_str(p);
-    cur_end(p) = str;
-    cur_str(p) = str;
-  }
-  p->cur_pat = pat;
-  return r;
-}
-
-static int utl_term(pmx_t *p)
-{
-  int r = 0;
-  char *old_pat = p->cur_pat;
-  do {
-    if (cur_pat(p)[0] == '|') p->cur_pat += 1;
-    r = utl_atom(p);
-  } while (r == 0 && cur_pat(p)[0] == '|');
-  while (cur_pat(p)[0] == '|') {
-    p->cur_pat += 1;
-    utl_skipatom(p);
-  }
-  return r;
-}
-
-int utl_pmxMatch(char *pat, char *str, pmx_t *p)
-{
-  int r;
-  p->nmatches = 0;
-  p->orig_str = str; p->cur_str = str;
-  p->orig_pat = pat; p->cur_pat = pat; 
-  cur_level(p) = 0;
-  cur_start(p) = NULL;
-  cur_end(p) = NULL;
-  r =utl_term(p);
-  return r;
-}
-#endif
-#endif /* UTL_NOMATCH */
-
-#endif /* UTL_H */
-
-/**************************************************************************/
-
+/* 
+**  (C) by Remo Dentato (rdentato@gmail.com)
+** 
+** This software is distributed under the terms of the BSD license:
+**   http://creativecommons.org/licenses/BSD/
+**
+*/
+
+#ifndef UTL_H
+#define UTL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+
+#include <setjmp.h>
+#include <assert.h>
+
+
+/* .% Overview
+**
+** =========== 
+** .v
+**                           ___   __
+**                       ___/  (_ /  )
+**                ___  _(__   ___)  /
+**               /  / /  )/  /  /  /
+**              /  /_/  //  (__/  /
+**             (____,__/(_____(__/
+** ..
+**
+**   This file ('|utl.h|) provide the following basic elements:
+**
+**  .[Unit Testing]   A simple framework to create unit tests. Tests output
+**                    is compliant with the TAP '(Test Anything Protocol)
+**                    standard.
+**
+**   [Logging]        To print logging traces during program execution.
+**                    It offers multilevel logging similar to '|log4j|
+**                    but limited to files.
+**
+**   [Finite State Machine]
+**                    Macros to use FSM as if they were a native C control
+**                    structure (similar to switch).
+**
+**   [Exceptions]     A simple implementation of try/catch. Similar to C++.
+**
+**   [Guarded memory allocation]
+**                    Replacement for malloc(), calloc(), realloc() and free()
+**                    that account and report about misuse of memory.
+**
+**   [Dynamic arrays]
+**   [Text buffers}
+**  ..
+**
+*/
+
+/*
+** .% How to use '|utl|
+** ====================
+**
+**  To access '|utl| functions you simply:
+**
+**  .# #include '|utl.h| in each source file
+**   # in one (and only one) of the source files #define the symbol
+**     '|UTL_LIB| before including '|utl.h| (a good place is the
+**     file where  your '|main()| function is defined)
+**  ..
+**
+**    As an alternative to the second step above, you can create a source
+**  file (say '|utl.c|) with only the following lines:
+**  .{{ C
+**       #define  UTL_C
+**       #include "utl.h"
+**  .}}
+**  and link it to your project.
+**
+*/
+
+#ifdef UTL_C
+#ifndef UTL_LIB
+#define UTL_LIB
+#endif
+#endif
+
+/* .%% Enable/disable utl features
+** -------------------------------
+**
+*/
+
+#ifdef NDEBUG
+#ifdef DEBUG
+#undef DEBUG
+#endif
+#endif
+
+#ifdef UTL_NOMEMCHECK
+#ifdef UTL_MEMCHECK
+#undef UTL_MEMCHECK
+#endif
+#endif
+
+#ifdef UTL_MEMCHECK
+#ifdef UTL_NOLOGGING
+#undef UTL_NOLOGGING
+#endif
+#endif
+
+#ifdef UTL_UNITTEST
+#ifndef DEBUG
+#define DEBUG
+#endif
+#endif
+
+/*   Some features (e.g. the asynchronous logger) need a background thread.
+** They are only available if the symbol '{=UTL_THREADS} is defined before
+** including '|utl.h|. POSIX threads are used, so remember to link your
+** program with '|-pthread|.
+*/
+
+#ifdef UTL_THREADS
+#include <pthread.h>
+#ifdef _MSC_VER
+#define utl_thread_local __declspec(thread)
+#else
+#define utl_thread_local __thread
+#endif
+#else
+#define utl_thread_local
+#endif
+
+#if !defined(UTL_UNIX) && (defined(__unix__) || defined(__APPLE__))
+#define UTL_UNIX
+#endif
+
+#ifdef UTL_THREADS
+#define utl_atomic_add(p,n)  __atomic_add_fetch(p, n, __ATOMIC_RELAXED)
+#define utl_atomic_get(p)    __atomic_load_n(p, __ATOMIC_RELAXED)
+#define utl_atomic_set(p,v)  __atomic_store_n(p, v, __ATOMIC_RELAXED)
+#define utl_atomic_cas(p,o,v) __atomic_compare_exchange_n(p, &(o), v, 0, \
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+#define utl_atomic_acquire(p)   __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define utl_atomic_release(p,v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define utl_atomic_fence()      __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#else
+#define utl_atomic_add(p,n)  (*(p) += (n))
+#define utl_atomic_get(p)    (*(p))
+#define utl_atomic_set(p,v)  (*(p) = (v))
+#define utl_atomic_cas(p,o,v) (*(p) == (o) ? (*(p) = (v), 1) : ((o) = *(p), 0))
+#define utl_atomic_acquire(p)   (*(p))
+#define utl_atomic_release(p,v) (*(p) = (v))
+#define utl_atomic_fence()
+#endif
+
+/* Data written by different threads is kept this far apart */
+#ifndef UTL_CACHE_LINE
+#define UTL_CACHE_LINE 64
+#endif
+
+
+/* .% Globals
+** ==========
+** 
+**    There are some symbols (costants or variables) that need to be shared by
+**  all the modules that include '|utl.h|.  They are defined with the aid of
+**  the macro '{utl_extern} which takes care of their definition and initialization
+**  in the '/main/ code and of their declaration as '|extern| in the rest of the code.
+*/
+
+#ifdef UTL_LIB
+#define utl_extern(n,v) n v
+#else
+#define utl_extern(n,v) extern n
+#endif
+
+#define utl_initvoid ;
+
+#define UTL_VERSION 0x0003
+
+utl_extern(unsigned short utlVersion, = UTL_VERSION);
+
+/* .%% Constants
+** -------------
+**
+**  A set of constants for generic use. Provided by for convenience.
+**
+**  .[utlEmptyFun]  A pointer to a do-nothing function that can be used
+**                  as a generic placeholder (or NULL indicator) for
+**                  function pointers. This can be useful as the C standard
+**                  doesn't guarantee that one could mix pointers to objects
+**                  with pointers to function (even if in reality this is
+**                  practically always the case).  
+**  ..
+*/
+
+int utlEmptyFun(void); 
+#ifdef UTL_LIB
+int   utlEmptyFun(void) {return 0;}
+#endif
+
+/*  .[utlEmptyString]  A pointer to the empty string "" that provides unique
+**                     representation for the empty string.  
+**  ..
+*/
+
+utl_extern(char *utlEmptyString, = "");
+
+/*   .[utlZero]  Is a constant whose value is 0 and that is to be used in
+**               idioms like '|do { ... } while (utlZero)|.
+**               This is useful to avoid compilers warning about testing
+**               constant values.
+**   ..
+*/
+  
+#ifdef __GNUC__
+#define utlZero 0
+#else
+utl_extern(const int utlZero, = 0);
+#endif
+
+
+/* .% Assumptions (static assertions)
+** ==================================
+**
+** http://www.drdobbs.com/compile-time-assertions/184401873
+*/
+
+#define utl_assum1(e,l) typedef struct {int utl_assumption[(e)?1:-1];} utl_assumption_##l
+#define utl_assum0(e,l) utl_assum1(e,l)
+#define utlAssume(e)    utl_assum0(e,__LINE__)
+
+
+#ifndef UTL_NOTRYCATCH
+
+/* .% Exceptions
+** ============
+**   Exceptions can be very useful when dealing with error conditions is so
+** complicate that the logic of errors handling obscures the logic of the 
+** program itself.
+**   If an error happens in the '|try| section, you can '|throw()| an exception
+** (an error condition) and the control goes back to the '|catch| section
+** where the proper actions can be taken.
+**
+**   Simple implementation of try/catch.
+** .{{ c
+**   tryenv env = NULL;
+**   try(env) {
+**      ... code ...
+**      if (something_failed) throw(env, ERR_OUTOFMEM)  // must be > 0 
+**      some_other_func(env); // you can trhow exceptions from other functions 
+**      ... code ...          // as long as you pass it the try environment.
+**   }  
+**   catch({                  // NOTE the catch part is enclosed in special 
+*       case ERR_OUTOFMEM :   // braces: '|({ ... })| and is the body of a
+**      ... code ...          // '|switch()| statement (including fallthrough!)
+**   });
+** .}}
+**
+**  This comes useful when you throw an exception form a called function.
+**  The example below, handles the "out of mem" condition in the same place
+**  regardless of where the exception was raised.
+**
+** .{{ C
+**
+**   #define ERR_OUTOFMEM 0xF0CA
+**   tryenv env = NULL; // Remember to set to NULL initally!
+**   char *f1(tryenv ee, int x)   { ... throw(ee, ERR_OUTOFMEM} ... }
+**   void *f2(tryenv ee, char *x) { ... throw(ee, ERR_OUTOFMEM} ... }
+**   try(env) {
+**      ... code ...
+**      f1(env,3); 
+**      ... code ...
+**      if ... throw(env,ERR_OUTFOMEM) 
+**      ... code ...
+**      f2(env,"Hello"); 
+**      ... code ...
+**   }  
+**   catch({                    // Note the use of '|({| and '|})| !!
+**      case  ERR_OUTOFMEM : 
+**                 ... code ... // Handle all your cleanup here!
+**                 break;
+**   });
+**
+** .}}
+*/ 
+
+
+typedef struct utl_env_s { 
+  jmp_buf jb;
+  struct utl_env_s volatile *prev;
+  struct utl_env_s volatile **orig;
+} *tryenv; 
+
+#define try(utl_env) \
+            do { struct utl_env_s utl_cur_env; volatile int utl_err; \
+                 utl_cur_env.prev = (void *)utl_env; \
+                 utl_cur_env.orig = (void *)(&utl_env); \
+                 utl_env = &utl_cur_env; \
+                 if ((utl_err = setjmp(utl_cur_env.jb))==0)
+                 
+#define catch(y) if (utl_err) switch (utl_err) { \
+                      y \
+                   } \
+                   utl_err = 0;\
+                  *utl_cur_env.orig = utl_cur_env.prev; \
+                } while(0)
+
+#define throw(env,err) (env? longjmp(((tryenv)env)->jb, err): exit(err))
+#define rethrow        (*utl_cur_env.orig = utl_cur_env.prev,throw(*utl_cur_env.orig,utl_err))
+
+#endif
+
+#ifndef UTL_NOFSM
+/*  .% Finite state machine
+**  =======================
+**
+**    A Finite State Machine (FSM) is very common paradigm for software that respond to 
+**  external events.  There are many ways to code a FSM, this one has the advantage to 
+**  closely mimic the graphical representation of a FSM.
+**
+** .v
+**      fsm ({            // Note the use of '|({| and '|})| !!
+**
+**        case fsmSTART: { ...
+**                   if (c == 0) fsmGoto(z);
+**                   fsmGoto(y);
+**        }
+**
+**        case z : { ...
+**                   break;  // exit from the FSM
+**        }
+**
+**        case y : { ...
+**                   if (c == 1) fsmGoto(x);
+**                   fsmGoto(z);
+**        }
+**      });
+** ..
+**
+**   It's a good practice to include a drawing of the FSM in the technical
+** documentation (e.g including the GraphViz description in comments).
+*/
+
+#define fsmSTART -1
+#define fsmEND   -2
+
+#define fsm(x)  do { int utl_fsm_next , utl_fsm_state; \
+                      for (utl_fsm_next=fsmSTART; utl_fsm_next>fsmEND;) \
+                        switch((utl_fsm_state=utl_fsm_next, utl_fsm_next=fsmEND, utl_fsm_state)) { \
+                        x \
+                }} while (utlZero)
+                         
+#define fsmGoto(x)  utl_fsm_next = (x); break
+#define fsmRestart  utl_fsm_next = fsmSTART; break
+#define fsmExit     utl_fsm_next = fsmEND; break
+
+#endif
+
+/* .% Clock
+** ========
+**
+**   Reading the time is something that logging, tests and profiling code
+** do very often, so it must be fast.
+**
+**   .[{=utlClock()}]    The current time in microseconds since the Epoch.
+**                       Where available, a coarse (but very fast) clock is
+**                       used, its resolution is in the order of milliseconds.
+**    [{=utlClockUs()}]  As above, with full resolution.
+**    [{=utlElapsed()}]  Microseconds elapsed from an unspecified starting
+**                       point. It's monotonic, use it to measure intervals.
+**   ..
+**
+**   The function '{=utlTimestamp(buf,us,mode)} writes in '|buf| the time
+** '|us| (as returned by '|utlClock()|) in the format used for logs:
+** .v
+**     2009-01-29 13:46:02
+** ..
+** If '|mode| contains '{=UTL_TS_USEC}, microseconds are added, if it contains
+** '{=UTL_TS_UTC}, the time is in UTC and in the ISO-8601 format:
+** .v
+**     2009-01-29T13:46:02.302751Z
+** ..
+** The buffer must be at least '{=UTL_TS_MAX} characters long. The date part
+** is only computed once per second (per thread).
+*/
+
+#include <time.h>
+
+#define UTL_TS_USEC  0x20
+#define UTL_TS_UTC   0x40
+#define UTL_TS_MAX   32
+
+int64_t utl_clock(int precise);
+int64_t utl_elapsed(void);
+int     utl_tstamp(char *buf, int64_t us, int mode);
+
+#define utlClock()    utl_clock(0)
+#define utlClockUs()  utl_clock(1)
+#define utlElapsed()  utl_elapsed()
+#define utlTimestamp(b,u,m) utl_tstamp(b,u,m)
+
+#ifdef UTL_LIB
+
+int64_t utl_clock(int precise)
+{
+#ifdef CLOCK_REALTIME
+  struct timespec ts;
+#ifdef CLOCK_REALTIME_COARSE
+  clock_gettime(precise ? CLOCK_REALTIME : CLOCK_REALTIME_COARSE, &ts);
+#else
+  clock_gettime(CLOCK_REALTIME, &ts);
+#endif
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+  return (int64_t)time(NULL) * 1000000;
+#endif
+}
+
+int64_t utl_elapsed(void)
+{
+#ifdef CLOCK_MONOTONIC
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+  return (int64_t)clock() * 1000000 / CLOCKS_PER_SEC;
+#endif
+}
+
+typedef struct {
+  int64_t sec;
+  int     len;
+  char    str[UTL_TS_MAX];
+} utl_tscache_t;
+
+static utl_thread_local utl_tscache_t utl_tscache[2] = {{-1,0,""},{-1,0,""}};
+
+int utl_tstamp(char *buf, int64_t us, int mode)
+{
+  utl_tscache_t *c = utl_tscache + ((mode & UTL_TS_UTC) ? 1 : 0);
+  int64_t sec = us / 1000000;
+  long usec = (long)(us % 1000000);
+  time_t t;
+  struct tm tm;
+  int n, k;
+  
+  if (c->sec != sec) {
+    t = (time_t)sec;
+#ifdef _WIN32
+    if (mode & UTL_TS_UTC) gmtime_s(&tm,&t);    else localtime_s(&tm,&t);
+#else
+    if (mode & UTL_TS_UTC) gmtime_r(&t,&tm);    else localtime_r(&t,&tm);
+#endif
+    c->len = (int)strftime(c->str, UTL_TS_MAX, (mode & UTL_TS_UTC) ? "%Y-%m-%dT%H:%M:%S"
+                                                                   : "%Y-%m-%d %X", &tm);
+    c->sec = sec;
+  }
+  memcpy(buf, c->str, c->len);
+  n = c->len;
+  if (mode & UTL_TS_USEC) {
+    buf[n++] = '.';
+    for (k = 6; k > 0; k--) { buf[n+k-1] = (char)('0' + usec % 10); usec /= 10; }
+    n += 6;
+  }
+  if (mode & UTL_TS_UTC) buf[n++] = 'Z';
+  buf[n] = '\0';
+  return n;
+}
+
+#endif /* UTL_LIB */
+
+
+#ifdef UTL_UNITTEST
+
+/* .% UnitTest
+** ===========
+**
+**   These macros will help you writing unit tests.  The log produced
+** is '<TAP 1.3=http://testanything.org> compatible and also contains
+** all the information about passing/failing.
+**
+**   They are available only if the symbol '|UTL_UNITTEST| is defined before
+** including the '|utl.h| header.
+** 
+**   '{UTL_UNITTEST} implies '{DEBUG}
+*/
+
+utl_extern(FILE *TST_FILE, = NULL);
+#define TSTFILE (TST_FILE?TST_FILE:stderr)
+
+/* Output is flushed every time to avoid we lose a message in case of
+** abnormal exit. 
+*/
+#define TSTWRITE(...) (fprintf(TSTFILE,__VA_ARGS__),fflush(TSTFILE))
+
+#define TSTTITLE(s) TSTWRITE("TAP version 13\n#\n# ** %s - (%s)\n",s,__FILE__)
+
+#define TST_INIT0 (TSTRES=TSTNUM=TSTGRP=TSTSEC=TSTTOT= \
+                               TSTGTT=TSTGPAS=TSTPASS=TSTNSK=TSTNTD=0)
+                                 
+#define TSTPLAN(s) for (TSTPASSED = TST_INIT0 + 1, TSTTITLE(s); \
+                                             TSTPASSED; TSTDONE(),TSTPASSED=0)
+                       
+/* Tests are divided in sections introduced by '{=TSTSECTION(title)} macro.
+** The macro reset the appropriate counters and prints the section header 
+*/
+#define TSTSECTION(s)  if ((TSTSTAT(), TSTGRP = 0, TSTSEC++, \
+                             TSTWRITE("#\n# * %d. %s (%s:%d)\n", \
+                             TSTSEC, s, __FILE__, __LINE__), TSTPASS=0)) ((void)0); \
+                       else                                               
+
+/* to disable an entire test section, just prepend '|_| or '|X|*/
+ 
+#define XTSTSECTION(s) if (!utlZero) ((void)0); else 
+#define _TSTSECTION(s) XTSTSECTION(s)
+
+/* In each section, tests can be logically grouped so that different aspects
+** of related functions can be tested.
+*/
+#define TSTGROUP(s) \
+    if ((TSTWRITE("#\n# *   %d.%d %s\n",TSTSEC,++TSTGRP,s),TSTNUM=0)) ((void)0); else
+                     
+/* to disable a n entire test group , just prepend '|_| or '|X| */
+#define XTSTGROUP(s) if (!utlZero) ((void)0); else  
+#define _TSTGROUP(s) XTSTGROUP(s)
+
+/* Test code will be skipped if needed */
+#define TSTCODE   if (TSTSKP && *TSTSKP)   ((void)0); else  
+#define XTSTCODE  if (!utlZero) ((void)0); else
+#define _TSTCODE  XTSTCODE
+                     
+/* The single test is defined  with the '|TST(s,x)| macro.
+**   .['|s|] is a short string that identifies the test
+**    ['|x|] an assertion that has to be true for the test to succeed.
+**   ..
+*/
+#define XTST(s,x)
+
+#define TST(s,x) (TST_DO(s,((TSTSKP && *TSTSKP)?1:(x))),TST_WRDIR, TSTWRITE("\n"), TSTRES)
+
+#define TST_DO(s,x) (TSTRES = (x), TSTGTT++, TSTTOT++, TSTNUM++, \
+                     TSTPASSED = (TSTPASSED && (TSTRES || TSTTD)), \
+                     TSTWRITE("%s %4d - %s (:%d)", \
+                              (TSTRES? (TSTGPAS++,TSTPASS++,TSTOK) : TSTKO), \
+                               TSTGTT, s, __LINE__))
+
+#define TST_WRDIR \
+           ((TSTSKP && *TSTSKP)? (TSTNSK++, TSTWRITE(" # SKIP %s",TSTSKP)) \
+                   : (TSTTD ? (TSTNTD++, (TSTWRITE(" # TODO %s%s",TSTTD, \
+                                        (TSTRES?TSTWRN:utlEmptyString)))) : 0))
+
+#define TSTFAILED  (!TSTRES)
+
+/* You can skip a set of tests giving a reason.
+** Nested skips are not supported!
+*/
+#define TSTSKIP(x,r) for (TSTSKP=(x)?r:utlEmptyString; TSTSKP; TSTSKP=NULL)
+
+#define TSTTODO(r)   for (TSTTD=r; TSTTD; TSTTD=NULL)
+
+#define TSTNOTE(...) \
+                 (TSTWRITE("#      "),TSTWRITE(__VA_ARGS__), TSTWRITE("\n"))
+                                            
+#define TSTFAILNOTE(...) (TSTRES? 0 : (TSTNOTE(__VA_ARGS__)))
+
+#define TSTEXPECTED(f1,v1,f2,v2) \
+                             (TSTRES? 0 : (TSTNOTE("Expected "f1" got "f2,v1,v2)))
+
+#define TST_INT(s,e,r,o) do { int utl_exp = (e); int utl_ret = (r);\
+                             TST(s,utl_exp o utl_ret);\
+                             TSTEXPECTED("(int) "#o" %d",utl_exp,"%d",utl_ret); \
+                           } while (utlZero)
+
+                             
+#define TSTEQINT(s,e,r)  TST_INT(s,e,r, == )
+#define TSTNEQINT(s,e,r) TST_INT(s,e,r, != )
+#define TSTLTINT(s,e,r)  TST_INT(s,e,r, < )
+#define TSTLEINT(s,e,r)  TST_INT(s,e,r, <= )
+#define TSTGTINT(s,e,r)  TST_INT(s,e,r, > )
+#define TSTGEINT(s,e,r)  TST_INT(s,e,r, >= )
+
+#define TST_PTR(s,e,r,o)  do { void *utl_exp = (e); void *utl_ret = (r); \
+                              TST(s,utl_exp o utl_ret) ; \
+                              TSTEXPECTED("(ptr) "#o" 0x%p",utl_exp,"0x%p",utl_ret); \
+                            }  while (utlZero)
+
+                           
+#define TSTEQPTR(s,e,r)  TST_PTR(s,e,r, == )
+#define TSTNEQPTR(s,e,r) TST_PTR(s,e,r, != )
+#define TSTNULL(s,r)     TSTEQPTR(s,NULL,r)
+#define TSTNNULL(s,r)    TSTNEQPTR(s,NULL,r)
+
+              
+#define TSTBAILOUT(r) \
+          if (!(r)) ((void)0); else {TSTWRITE("Bail out! %s\n",r); TSTDONE(); exit(0);}
+
+/* At the end of a section, the accumulated stats can be printed out */
+#define TSTSTAT() \
+          (TSTTOT == 0 ? 0 : ( \
+           TSTWRITE("#\n# SECTION %d OK: %d/%d\n",TSTSEC,TSTPASS,TSTTOT), \
+           TSTTOT = 0))
+
+/* At the end of all the tests, the accumulated stats can be printed out */
+#define TSTDONE() \
+  (TSTGTT <= 0 ? 0 : ( TSTSTAT(),  \
+  TSTWRITE("#\n# TOTAL OK: %d/%d SKIP: %d TODO: %d\n",TSTGPAS,TSTGTT, \
+                                                              TSTNSK,TSTNTD), \
+  TSTWRITE("#\n# TEST PLAN: %s \n",TSTPASSED ? "PASSED" : "FAILED"), \
+  TSTWRITE("#\n1..%d\n",TSTGTT),fflush(TSTFILE)) )
+
+/* Execute a statement if a test succeeded */
+#define TSTIF_OK  if (TSTRES)
+
+/* Execute a statement if a test failed */
+#define TSTIF_NOTOK if (!TSTRES)
+
+static int    TSTRES    = 0;  /* Result of the last performed '|TST()| */
+static int    TSTNUM    = 0;  /* Last test number */
+static int    TSTGRP    = 0;  /* Current test group */
+static int    TSTSEC    = 0;  /* Current test SECTION*/
+static int    TSTTOT    = 0;  /* Number of tests executed */
+static int    TSTGTT    = 0;  /* Number of tests executed (Grand Total) */
+static int    TSTGPAS   = 0;  /* Number of tests passed (Grand Total) */
+static int    TSTPASS   = 0;  
+static int    TSTPASSED = 1;  
+static int    TSTNSK    = 0;  
+static int    TSTNTD    = 0;  
+static char  *TSTSKP    = NULL;
+static char  *TSTTD     = NULL;
+
+static const char *TSTOK  = "ok    ";
+static const char *TSTKO  = "not ok";
+static const char *TSTWRN = " (passed unexpectedly!)";
+
+
+#endif /* UTL_UNITTEST */
+
+/* .% Logging
+** ==========
+**
+*/
+
+#define log_D 7
+#define log_I 6
+#define log_M 5
+#define log_W 4
+#define log_E 3
+#define log_C 2
+#define log_A 1
+#define log_F 0
+
+
+#define log_X (log_D + 1)
+#define log_L (log_D + 2)
+
+/* What to do when the ring of an asynchronous logger is full */
+#define UTL_LOG_BLOCK  0
+#define UTL_LOG_DROP   1
+#define UTL_LOG_COUNT  2
+
+
+/* Logging functions are available unless the symbol '{=UTL_NOLOGGING}
+** has been defined before including '|utl.h|.
+*/
+
+#ifndef UTL_NOLOGGING
+
+#define UTL_LOG_NEW 0x00    
+#define UTL_LOG_ADD 0x01    /* append to existing file */
+#define UTL_LOG_ERR 0x02    /* use stderr */
+#define UTL_LOG_OUT 0x04    /* use stdout */
+#define UTL_LOG_ASYNC 0x08  /* write through a background thread */
+#define UTL_LOG_BIN   0x10  /* write binary records (see logdecode) */
+#define UTL_LOG_RING  0x80  /* write into a memory mapped circular file */
+#define UTL_LOG_JSON  0x100 /* write key/value pairs as JSON (see logKV) */
+#define UTL_LOG_USEC  UTL_TS_USEC  /* timestamps with microseconds */
+#define UTL_LOG_UTC   UTL_TS_UTC   /* timestamps in UTC (ISO-8601) */
+
+typedef struct {
+  FILE          *file;
+  unsigned char  level;
+  unsigned short flags;
+  unsigned short rot;
+  char          *pre;
+  struct utl_log_async_s *async;
+  struct utl_log_bin_s   *bin;
+  struct utl_log_rot_s   *rotate;
+  struct utl_log_lock_s  *lock;
+  char          *fname;
+  struct utl_log_ring_s  *ring;
+  struct utl_log_node_s  *node;
+} utl_log_s, *utlLogger;
+
+#define utl_log_stdout_init {NULL, log_W, UTL_LOG_OUT,0,NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL}
+utl_extern(utl_log_s utl_log_stdout , = utl_log_stdout_init);
+#define logStdout (&utl_log_stdout)
+
+#define utl_log_stderr_init {NULL, log_W, UTL_LOG_ERR,0,NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL}
+utl_extern(utl_log_s utl_log_stderr , = utl_log_stderr_init);
+#define logStderr (&utl_log_stderr)
+
+#define logNull NULL
+
+utl_extern(utlLogger utl_logger , = logNull);
+
+#include <ctype.h>
+#include <wchar.h>
+
+/* .%% Logging levels
+** ~~~~~~~~~~~~~~~~~~
+**
+**   Logging levels are hierarchical and structured. Default log level is WARN.
+**
+**   Use '{=logLevel()}    to set the desired level of logging.
+**   Use '{=logLevelEnv()} to set the desired level of logging based on an
+**                         enviroment variable.
+*/
+
+                                    /* 0   1   2   3   4   5   6   7   8   9    */
+                                    /* 0   4   8   12  16  20  24  28  32  36   */
+utl_extern(char const utl_log_abbrev[], = "FTL ALT CRT ERR WRN MSG INF DBG OFF LOG ");
+
+int   utl_log_level(utlLogger lg);
+int   utl_log_chrlevel(char *l);
+int   logLevel(utlLogger lg, char *lv); 
+int   logLevelEnv(utlLogger lg, char *var, char *level);
+
+/*
+** The table below shows whether a message of a certain level will be
+** printed (Y) or not (N) given the current level of logging.
+** .v
+**                          message level 
+**                    DBG INF MSG WRN ERR CRT ALT FTL
+**               DBG   Y   Y   Y   Y   Y   Y   Y   Y
+**               INF   N   Y   Y   Y   Y   Y   Y   Y
+**               MSG   N   N   Y   Y   Y   Y   Y   Y
+**      current  WRN   N   N   N   Y   Y   Y   Y   Y
+**      logging  ERR   N   N   N   N   Y   Y   Y   Y
+**       level   CRT   N   N   N   N   N   Y   Y   Y
+**               ALT   N   N   N   N   N   N   Y   Y
+**               FTL   N   N   N   N   N   N   N   Y
+**               OFF   N   N   N   N   N   N   N   N
+** ..
+*/
+
+/* .%% Logging file rotate
+** ~~~~~~~~~~~~~~~~~~~~~~~
+**
+** For long running programs (servers, daemons, ...) it is important to rotate 
+** the log files from time to time so that they won't become too big.
+**
+**   logRotate(lg, size, secs, n)
+**
+**   After '{=logRotate()} is called, the log file will be closed and a new
+** one opened with the same name as soon as it grows bigger than '|size| bytes
+** or '|secs| seconds have passed since it was opened (a 0 disables the 
+** corresponding check). The old file is renamed '|_001|, the one that was
+** '|_001| is renamed '|_002| and so on, up to '|n| files. Older files are
+** deleted.
+** .v
+**      mylog.log        <- current log
+**      mylog_001.log    <- most recent rotated log
+**      mylog_002.log
+**       etc...
+** ..
+**   The size is tracked in memory (the file size is only read on opening)
+** and rotating the files only requires renaming them. For asynchronous logs
+** the rotation is done by the writer thread.
+**   Only logs opened with '{logOpen()} can be rotated.
+**   If the new file can't be opened (nor the old one reopened), the log
+** goes on on '|stderr| and is no longer rotated.
+*/
+
+/* .%% Asynchronous logging
+** ~~~~~~~~~~~~~~~~~~~~~~~~
+**
+**   Writing to a file (and flushing it) on every message can make logging
+** the slowest part of a program. The function '{=logAsync()} switches a
+** logger to asynchronous mode: messages are formatted by the caller into a
+** preallocated ring of records and a background thread writes them to the
+** file in batches.
+** .v
+**   lg = logOpen("server.log","a");
+**   logAsync(lg, 1024, UTL_LOG_COUNT);
+** ..
+**
+**   The ring holds the specified number of records (rounded up to a power
+** of two), each up to '{=UTL_LOG_LINEMAX} characters long (longer messages
+** are truncated). What happens when the ring is full depends on the policy:
+**   .[{UTL_LOG_BLOCK}]  The caller waits until there's room in the ring.
+**    [{UTL_LOG_DROP}]   The message is silently discarded.
+**    [{UTL_LOG_COUNT}]  The message is discarded and the number of lost
+**                       messages is written to the log as soon as possible.
+**   ..
+**   '{logClose()} writes all the pending messages before closing the log.
+**
+**   Asynchronous logging is only available if '{UTL_THREADS} is defined,
+** otherwise '|logAsync()| returns 0 and the logger is left unchanged.
+*/
+
+#ifndef UTL_LOG_LINEMAX
+#define UTL_LOG_LINEMAX 256
+#endif
+
+
+/* .%% Logging format
+** ~~~~~~~~~~~~~~~~~~
+** 
+** Log files have the following format:
+** .v
+**     <date> <time> <level> <message>
+** ..
+**
+**  For example:
+** .v
+**     2009-01-29 13:46:02 ERR An error!
+**     2009-01-29 13:46:02 FTL An unrecoverable error
+** ..
+**
+**  Use '{=logTimestamp(lg,mode)} to add microseconds ('{UTL_LOG_USEC}) or to
+** have UTC timestamps in ISO-8601 format ('{UTL_LOG_UTC}):
+** .v
+**     logTimestamp(lg, UTL_LOG_USEC | UTL_LOG_UTC);
+**     ...
+**     2009-01-29T13:46:02.302751Z ERR An error!
+** ..
+*/
+
+/* .%% Binary logs
+** ~~~~~~~~~~~~~~~
+**
+**   Opening a log with a '|b| in the mode (e.g. '|logOpen("trace.bin","wb")|)
+** creates a binary log. Messages are not formatted at all: only the level,
+** the timestamp, a reference to the format string and the raw value of the
+** arguments are stored in a per-logger buffer that is written to the file
+** when full or when the log is closed.
+**   Format strings (and prefixes) are written to the file only the first
+** time they are used, so that the cost of a log message is roughly the cost
+** of copying its arguments.
+**
+**   The '|logdecode| program turns a binary log into the usual text format:
+** .v
+**     logdecode trace.bin > trace.log
+** ..
+**
+**   Notes:
+**   .- Records are stored in the byte order of the machine that wrote them.
+**    - Strings are copied (up to '{UTL_LOG_LINEMAX} characters), '|long double|
+**      values are stored as '|double| and '|%n| is ignored.
+**    - Wide strings and characters ('|%ls|, '|%lc|) are converted to
+**      multibyte strings, according to the current locale, when logged.
+**    - Format strings are looked up by their address and checked against
+**      the text seen the first time. A format built in a buffer that is
+**      later reused for a different text is written again with a new id,
+**      at the cost of a string comparison for each message.
+**    - A binary log can't be switched to asynchronous mode.
+**   ..
+*/
+
+#ifndef UTL_LOG_BINBUF
+#define UTL_LOG_BINBUF 65536
+#endif
+
+/* .%% Flight recorder
+** ~~~~~~~~~~~~~~~~~~~
+**
+**   '{=logOpenRing(fname,size)} opens a log that is kept in a circular file
+** of fixed size mapped in memory. Writing a message only means formatting it
+** and copying it into the mapped memory: there are no system calls and the
+** last '|size| bytes of the log survive a crash of the program (even a
+** '|kill -9|) since the pages belong to the operating system.
+**   This makes it feasible to leave debug messages always on and look at
+** them only when something went wrong:
+** .v
+**     lg = logOpenRing("server.ring", 16 * 1024 * 1024);
+**     logLevel(lg, "Debug");
+** ..
+**
+**   If the file already exists and has the same size, new messages are
+** added after the old ones. The '|logdecode| program prints the content of
+** the file in order, from the oldest message still present to the newest:
+** .v
+**     logdecode server.ring > server.log
+** ..
+**
+**   Ring logs can't be rotated, made asynchronous or binary. Long messages
+** are truncated to '{UTL_LOG_LINEMAX} characters. Multiple threads can
+** write to a ring log at the same time if '{UTL_THREADS} is defined.
+**   If memory mapped files are not supported, '|logOpenRing()| behaves as
+** '|logOpen()| does when the file can't be opened and returns '{logStderr}.
+*/
+
+/* .%% Loggers
+** ~~~~~~~~~~~
+/*    Log files can be opened in "write" or "append" mode as any normal file 
+** using the '{=logOpen()} function.
+** For example:
+** .v  
+**   utlLogger lgr = NULL;
+**   logOpen(lgr,"file1.log","w") // Delete old log file and create a new one
+**   ...
+**   logOpen(lgr,"file1.log","a") // Append to previous log file
+** .. 
+**
+**   There are three predefined loggers:
+**   .[{logNull}]    A null logger that won't output any message
+**    [{logStdout}]  A logger that will output on stdout
+**    [{logStderr}]  A logger that will output on stderr
+**   ..
+** They are '{logClose()} safe, i.e. you can pass them to logClose() and nothing
+** bad will happen.
+**
+**   Each line is written to the file with a single '|fwrite()| so lines from
+** different threads never get mixed. If '{UTL_THREADS} is defined, loggers
+** can also be safely used by multiple threads while they rotate their
+** files. Opening, configuring and closing a logger are not thread safe.
+*/
+
+/* .%% Named loggers
+** ~~~~~~~~~~~~~~~~~
+**
+**   Large programs can use a logger for each module, with names that form
+** a hierarchy separated by dots ('|net|, '|net.http|, '|net.http.parser|).
+** '{=logGet(name)} returns the logger with the given name, creating it (and
+** its parents) if needed. The same name always returns the same logger.
+** .v
+**   static utlLogger lg;
+**   ...
+**   lg = logGet("net.http.parser");
+**   logDebug(lg, "Header: %s", hdr);
+** ..
+**
+**   Unless it has been set with '{=logConfig(name, level)}, the level of a
+** logger is the one of its parent. The root of the hierarchy ('|logGet("")|)
+** is at level WARN. '{=logConfigEnv(var, dflt)} reads a configuration from
+** an environment variable (or the string '|dflt| if the variable is not
+** set) as a comma separated list of '|name=level| (a level alone is for
+** the root):
+** .v
+**   LOGCFG="error,net=info,net.http=debug" myserver
+**   ...
+**   logConfigEnv("LOGCFG", "warn");
+** ..
+**   Passing '|NULL| as level to '|logConfig()| makes the logger inherit the
+** level again. Levels can be changed at any time: a global generation
+** counter is incremented and each logger recomputes its level (and sink)
+** the first time it's used afterwards, so checking the level of a named
+** logger costs two comparisons and requires no lock.
+**
+**   Named loggers have no file of their own: their messages (prefixed with
+** their name) are written to the logger set for them, or for their closest
+** parent, with '{=logSink(name, lg)}. The default is '{logStderr}. The
+** sink's options (timestamps, rotation, ...) apply, its level doesn't.
+** Named loggers are never freed: '{logClose()} does nothing on them.
+** Remember to change the sink before closing it.
+*/
+
+#define logOpen(f,m)   utl_logOpen(f,m)
+#define logOpenRing(f,s) utl_logOpenRing(f,s)
+#define logGet(n)        utl_logGet(n)
+#define logConfig(n,l)   utl_logConfig(n,l)
+#define logConfigEnv(v,d) utl_logConfigEnv(v,d)
+#define logSink(n,l)     utl_logSink(n,l)
+#define logClose(l)    utl_log_close(l)
+
+#define logPre(l,s)      ((l)->pre = s)
+
+#define logTimestamp(l,m) ((l)->flags = ((l)->flags & ~(UTL_LOG_USEC | UTL_LOG_UTC)) \
+                                        | ((m) & (UTL_LOG_USEC | UTL_LOG_UTC)))
+
+utlLogger utl_logOpen(char *fname, char *mode);
+utlLogger utl_logOpenRing(char *fname, size_t size);
+utlLogger utl_logGet(char *name);
+int utl_logConfig(char *name, char *level);
+int utl_logConfigEnv(char *var, char *dflt);
+int utl_logSink(char *name, utlLogger sink);
+utlLogger utl_logClose(utlLogger lg);
+utlLogger utl_log_close(utlLogger lg);
+void utl_log_write(utlLogger lg,int lv, int tstamp, char *format, ...);
+
+int utl_logAsync(utlLogger lg, size_t nrecs, int policy);
+#define logAsync(lg,n,p) utl_logAsync(lg,n,p)
+
+int utl_log_decode(FILE *in, FILE *out);
+#define logDecode(i,o) utl_log_decode(i,o)
+
+int utl_logRotate(utlLogger lg, size_t size, long secs, int n);
+#define logRotate(lg,s,t,n) utl_logRotate(lg,s,t,n)
+
+#define logFile(l) utl_logFile(l)
+#define logLevel(lg,lv)      utl_logLevel(lg,lv)
+#define logLevelEnv(lg,v,l)  utl_logLevelEnv(lg,v,l)
+
+#define logIf(lg,lc) utl_log_if(lg,utl_log_chrlevel(lc))
+
+#define utl_log_if(lg,lv) if ((lv) > utl_log_level(lg)) ((void)0) ; else
+          
+#define logDebug(lg, ...)      utl_log_write(lg, log_D, 1, __VA_ARGS__)
+#define logInfo(lg, ...)       utl_log_write(lg, log_I, 1, __VA_ARGS__)
+#define logMessage(lg, ...)    utl_log_write(lg, log_M, 1, __VA_ARGS__)
+#define logWarn(lg, ...)       utl_log_write(lg, log_W, 1, __VA_ARGS__)
+#define logError(lg, ...)      utl_log_write(lg, log_E, 1, __VA_ARGS__)
+#define logCritical(lg, ...)   utl_log_write(lg, log_C, 1, __VA_ARGS__)
+#define logAlarm(lg, ...)      utl_log_write(lg, log_A, 1, __VA_ARGS__)
+#define logFatal(lg, ...)      utl_log_write(lg, log_F, 1, __VA_ARGS__)
+
+#define logDContinue(lg, ...)  utl_log_write(lg, log_D, 0, __VA_ARGS__)
+#define logIContinue(lg, ...)  utl_log_write(lg, log_I, 0, __VA_ARGS__)
+#define logMContinue(lg, ...)  utl_log_write(lg, log_M, 0, __VA_ARGS__)
+#define logWContinue(lg, ...)  utl_log_write(lg, log_W, 0, __VA_ARGS__)
+#define logEContinue(lg, ...)  utl_log_write(lg, log_E, 0, __VA_ARGS__)
+#define logCContinue(lg, ...)  utl_log_write(lg, log_C, 0, __VA_ARGS__)
+#define logAContinue(lg, ...)  utl_log_write(lg, log_A, 0, __VA_ARGS__)
+#define logFContinue(lg, ...)  utl_log_write(lg, log_F, 0, __VA_ARGS__)
+
+#define logAssert(lg,e)        utl_log_assert(lg, e, #e, __FILE__, __LINE__)
+
+/*
+** .v
+**   logError("Too many items at counter %d (%d)",numcounter,numitems);
+**   logContinue("Occured %d times",times++);
+** ..
+** will produce:
+** .v
+**     2009-01-29 13:46:02 ERR Too many items at counter 9 (5)
+**                             Occured 3 times
+** ..
+*/
+
+/* .%% Rate limiting
+** ~~~~~~~~~~~~~~~~~
+**
+**   A message that is logged inside a loop or on every request can easily
+** flood the log (and slow down the program) when something goes wrong.
+** The following macros only write a message once in a while:
+**
+**   .[{=logEvery(lg,n,lv,...)}]      Once every '|n| times it is reached
+**                                    (never if '|n| is 0).
+**    [{=logEveryMs(lg,ms,lv,...)}]   At most once every '|ms| milliseconds.
+**    [{=logSample(lg,p,lv,...)}]     With probability '|p| (0.0 to 1.0).
+**   ..
+**
+**   The level '|lv| is one of the '|log_X| constants (e.g. '|log_E|):
+** .v
+**   logEveryMs(lg, 1000, log_E, "Can't connect to %s", host);
+** ..
+**
+**   Each macro keeps its state in a '|static| variable so the limit applies
+** to each call site separately. When the message is discarded nothing is
+** formatted: it only costs an atomic increment of the counter plus,
+** respectively, a division, a function call that reads the clock or one
+** that draws a random number. When it's written, a continuation line
+** reports how many messages have been suppressed since the previous one:
+** .v
+**     2009-01-29 13:46:02 ERR Can't connect to db01
+**                             (suppressed 2315 similar messages)
+** ..
+**   The counters are updated atomically if '{UTL_THREADS} is defined.
+*/
+
+typedef struct {
+  unsigned long cnt;
+  int64_t       next;
+} utl_log_rate_s;
+
+int  utl_log_every_ms(utl_log_rate_s *r, long ms);
+int  utl_log_sample(double p);
+void utl_log_suppressed(utlLogger lg, int lv, unsigned long *cnt);
+
+#define logEvery(lg,n,lv,...) \
+  do { static unsigned long utl_ev_ = 0; \
+       unsigned long utl_k_ = utl_atomic_add(&utl_ev_, 1) - 1; \
+       if ((n) > 0 && utl_k_ % (n) == 0) { \
+         utl_log_write(lg, lv, 1, __VA_ARGS__); \
+         if (utl_k_ > 0 && (n) > 1) utl_log_write(lg, lv, 0, \
+                    "(suppressed %lu similar messages)", (unsigned long)(n)-1); \
+       } \
+  } while (utlZero)
+
+#define logEveryMs(lg,ms,lv,...) \
+  do { static utl_log_rate_s utl_rt_ = {0,0}; \
+       if (!utl_log_every_ms(&utl_rt_, ms)) utl_atomic_add(&utl_rt_.cnt, 1); \
+       else { utl_log_write(lg, lv, 1, __VA_ARGS__); \
+              utl_log_suppressed(lg, lv, &utl_rt_.cnt); } \
+  } while (utlZero)
+
+#define logSample(lg,p,lv,...) \
+  do { static utl_log_rate_s utl_rt_ = {0,0}; \
+       if (!utl_log_sample(p)) utl_atomic_add(&utl_rt_.cnt, 1); \
+       else { utl_log_write(lg, lv, 1, __VA_ARGS__); \
+              utl_log_suppressed(lg, lv, &utl_rt_.cnt); } \
+  } while (utlZero)
+
+/* .%% Structured logging
+** ~~~~~~~~~~~~~~~~~~~~~~
+**
+**   Messages meant to be read by programs rather than by people can be
+** written as a list of key/value pairs with '{=logKV()}:
+** .v
+**   logKV(lg, log_I, "login", "user", "%s", name, "ms", "%d", elapsed);
+** ..
+** Each pair is a key, a format with a single conversion and its value.
+** The line is written (with the usual timestamp, level and prefix) in the
+** '|logfmt| format:
+** .v
+**     2009-01-29 13:46:02 INF event=login user="John Doe" ms=12
+** ..
+** or, after '|logKVFormat(lg, UTL_LOG_JSON)|, as a JSON object:
+** .v
+**     2009-01-29 13:46:02 INF {"event":"login","user":"John Doe","ms":12}
+** ..
+**
+**   Values are quoted and escaped as needed. Numeric values are written as
+** JSON numbers, everything else as strings. The line is built in a buffer
+** on the stack: if a pair doesn't fit in '{UTL_LOG_LINEMAX} characters,
+** it is dropped together with all the pairs that follow it.
+**   As for '{logIf()}, the arguments are not even evaluated if the level is
+** not enabled.
+*/
+
+#define UTL_LOG_LOGFMT 0
+
+void utl_log_kv(utlLogger lg, int lv, char *event, ...);
+
+#define logKV(lg,lv,...) utl_log_if(lg,lv) utl_log_kv(lg, lv, __VA_ARGS__, NULL)
+
+#define logKVFormat(l,f) ((l)->flags = ((l)->flags & ~UTL_LOG_JSON) | ((f) & UTL_LOG_JSON))
+
+#ifdef UTL_LIB
+typedef struct utl_log_node_s {
+  char          *name;
+  utlLogger      parent;
+  utlLogger      out;     /* set with logSink() (NULL: as the parent) */
+  utlLogger      sink;    /* where messages are actually written */
+  signed char    conf;    /* set with logConfig() (-1: as the parent) */
+  unsigned long  gen;     /* generation of the cached level and sink */
+  utlLogger      next;
+} utl_log_node_s;
+
+static utlLogger     utl_log_named = NULL;
+static unsigned long utl_log_gen = 1;
+
+/* Recomputes the level and the sink of a named logger after a change */
+static void utl_log_refresh(utlLogger lg)
+{
+  unsigned long gen = utl_atomic_get(&utl_log_gen);
+  utlLogger sink = NULL;
+  utlLogger p;
+  int lv = -1;
+  
+  for (p = lg; p; p = p->node->parent) {
+    if (lv < 0) lv = utl_atomic_get(&p->node->conf);
+    if (!sink)  sink = utl_atomic_get(&p->node->out);
+  }
+  utl_atomic_set(&lg->level, (unsigned char)(lv >= 0 ? lv : log_W));
+  utl_atomic_set(&lg->node->sink, sink ? sink : logStderr);
+  utl_atomic_set(&lg->node->gen, gen);
+}
+
+int utl_log_level(utlLogger lg)
+{
+  if (!lg) return log_X;
+  if (lg->node && utl_atomic_get(&lg->node->gen) != utl_atomic_get(&utl_log_gen))
+    utl_log_refresh(lg);
+  return (int)utl_atomic_get(&lg->level);
+}
+
+FILE *utl_logFile(utlLogger lg)
+{
+  if (!lg) return NULL;
+  if (lg->flags & UTL_LOG_ERR) return stderr;
+  if (lg->flags & UTL_LOG_OUT) return stdout;
+  return lg->file;
+}
+
+/* Writes the timestamp (or blanks if tstamp is 0) of a log line */
+static int utl_log_tstamp(utlLogger lg, int tstamp, char *tstr)
+{
+  int n = utl_tstamp(tstr, utl_clock(lg->flags & UTL_LOG_USEC), lg->flags);
+  if (!tstamp) memset(tstr, ' ', n);
+  return n;
+}
+
+int   utl_log_chrlevel(char *l) {
+  int i=0;
+  char c = l ? toupper(l[0]) : 'W';
+  
+  while (utl_log_abbrev[i] != ' ' && utl_log_abbrev[i] != c) i+=4;
+  i = (i <= 4*7) ? (i>> 2) : log_W;
+  return i;
+}
+
+
+int utl_logLevel(utlLogger lg, char *lv) 
+{
+  if (!lg) return log_X;
+  
+  if (lg->node && lv && lv[0] && lv[0] != '?') return utl_logConfig(lg->node->name, lv);
+  if (lv && lv[0] && lv[0] != '?')
+      lg->level = utl_log_chrlevel(lv);
+  return utl_log_level(lg);  
+}
+
+int utl_logLevelEnv(utlLogger lg, char *var, char *level)
+{
+  char *lvl_str;
+  
+  lvl_str=getenv(var);
+  if (!lvl_str) lvl_str = level;
+  return utl_logLevel(lg,lvl_str);
+}
+
+#ifdef UTL_THREADS
+static pthread_mutex_t utl_log_named_mtx = PTHREAD_MUTEX_INITIALIZER;
+#define utl_log_named_lock()   pthread_mutex_lock(&utl_log_named_mtx)
+#define utl_log_named_unlock() pthread_mutex_unlock(&utl_log_named_mtx)
+#else
+#define utl_log_named_lock()   ((void)0)
+#define utl_log_named_unlock() ((void)0)
+#endif
+
+/* Finds (or creates) the named logger for the first len chars of name.
+** Must be called while holding the lock.
+*/
+static utlLogger utl_log_node(char *name, size_t len)
+{
+  utlLogger lg, parent = NULL;
+  size_t k;
+  
+  for (lg = utl_log_named; lg; lg = lg->node->next)
+    if (strncmp(lg->node->name, name, len) == 0 && lg->node->name[len] == '\0')
+      return lg;
+  
+  if (len > 0) {
+    for (k = len; k > 0 && name[k-1] != '.'; k--) ;
+    parent = utl_log_node(name, k > 0 ? k-1 : 0);
+    if (!parent) return NULL;
+  }
+  
+  lg = malloc(sizeof(utl_log_s) + sizeof(utl_log_node_s) + len + 1);
+  if (!lg) return NULL;
+  memset(lg, 0, sizeof(utl_log_s) + sizeof(utl_log_node_s));
+  lg->node = (utl_log_node_s *)(lg + 1);
+  lg->node->name = (char *)(lg->node + 1);
+  memcpy(lg->node->name, name, len);
+  lg->node->name[len] = '\0';
+  lg->node->parent = parent;
+  lg->node->conf = (len > 0) ? -1 : log_W;
+  lg->pre = (len > 0) ? lg->node->name : NULL;
+  lg->level = log_W;
+  lg->node->next = utl_log_named;
+  utl_log_named = lg;
+  return lg;
+}
+
+utlLogger utl_logGet(char *name)
+{
+  utlLogger lg;
+  
+  if (!name) name = "";
+  utl_log_named_lock();
+  lg = utl_log_node(name, strlen(name));
+  utl_log_named_unlock();
+  return lg;
+}
+
+int utl_logConfig(char *name, char *level)
+{
+  utlLogger lg = utl_logGet(name);
+  int lv;
+  
+  if (!lg) return log_X;
+  lv = (level && level[0]) ? utl_log_chrlevel(level) : -1;
+  if (lv < 0 && !lg->node->parent) lv = log_W;
+  utl_atomic_set(&lg->node->conf, (signed char)lv);
+  utl_atomic_add(&utl_log_gen, 1);
+  return utl_log_level(lg);
+}
+
+int utl_logConfigEnv(char *var, char *dflt)
+{
+  char buf[256];
+  char *cfg, *item, *eq;
+  int n = 0;
+  
+  cfg = var ? getenv(var) : NULL;
+  if (!cfg) cfg = dflt;
+  if (!cfg) return 0;
+  
+  strncpy(buf, cfg, sizeof(buf)-1);
+  buf[sizeof(buf)-1] = '\0';
+  for (item = buf; *item; ) {
+    cfg = item + strcspn(item, ", ");
+    if (*cfg) *cfg++ = '\0';
+    if (*item) {
+      eq = strchr(item, '=');
+      if (eq) { *eq = '\0'; utl_logConfig(item, eq+1); }
+      else utl_logConfig("", item);
+      n++;
+    }
+    item = cfg;
+  }
+  return n;
+}
+
+int utl_logSink(char *name, utlLogger sink)
+{
+  utlLogger lg = utl_logGet(name);
+  
+  if (!lg || (sink && sink->node)) return 0;
+  utl_atomic_set(&lg->node->out, sink);
+  utl_atomic_add(&utl_log_gen, 1);
+  return 1;
+}
+
+/* .%% Binary logs internals
+** ~~~~~~~~~~~~~~~~~~~~~~~~~
+**
+**   A binary log starts with an 8 bytes signature followed by a 32 bit
+** integer to check the byte order. Then there are two type of records:
+** .v
+**   'F' id(u32) len(u16) text[len]           format string (or prefix)
+**   'M' lvl(u8) fmt(u32) pre(u32) usec(i64)  message
+**       len(u16) args[len]
+** ..
+**   The bit 0x80 of '|lvl| is set if the message has a timestamp, the bits
+** '|UTL_LOG_USEC| and '|UTL_LOG_UTC| tell how to format it. Arguments
+** are stored as 64 bit integers or doubles, strings as len(u16) text[len].
+*/
+
+/* Formats a full log line (including the trailing '\n') in buf. Like
+** snprintf(), returns the length the line would have had if buf was big
+** enough.
+*/
+static int utl_log_format(utlLogger lg, char *pre, int lv, int tstamp, char *buf, int sz,
+                                                     char *format, va_list args)
+{
+  char tstr[UTL_TS_MAX];
+  int n, k;
+  
+  utl_log_tstamp(lg, tstamp, tstr);
+  n = snprintf(buf, sz, "%s%s%s %.4s", pre ? pre : "", pre ? " " : "",
+                                                   tstr, utl_log_abbrev+(lv<<2));
+  if (n < 0) n = 0;
+  k = vsnprintf(n < sz ? buf+n : NULL, n < sz ? sz-n : 0, format, args);
+  if (k > 0) n += k;
+  k = (n < sz-1) ? n : sz-2;
+  buf[k++] = '\n';
+  buf[k] = '\0';
+  return n+1;
+}
+
+#ifdef UTL_THREADS  /* only used by the writer thread of async logs */
+static int utl_log_sformat(utlLogger lg, int lv, char *buf, int sz, char *format, ...)
+{
+  va_list args;
+  int n;
+  
+  va_start(args, format);  n = utl_log_format(lg, lg->pre, lv, 1, buf, sz, format, args);  va_end(args);
+  return (n < sz) ? n : sz-1;
+}
+#endif
+
+/*   With '|UTL_THREADS| each logger opened with '|logOpen()| has a read/write
+** lock. Writing a line only needs the read lock (the line is written with
+** a single '|fwrite()|), the write lock is needed to rotate the file or to
+** use the (shared) buffer of binary logs.
+*/
+
+#ifdef UTL_THREADS
+typedef struct utl_log_lock_s {
+  pthread_rwlock_t rw;
+} utl_log_lock_s;
+
+#define utl_log_rdlock(lg) ((lg)->lock ? pthread_rwlock_rdlock(&(lg)->lock->rw) : 0)
+#define utl_log_wrlock(lg) ((lg)->lock ? pthread_rwlock_wrlock(&(lg)->lock->rw) : 0)
+#define utl_log_unlock(lg) ((lg)->lock ? pthread_rwlock_unlock(&(lg)->lock->rw) : 0)
+#else
+#define utl_log_rdlock(lg) ((void)0)
+#define utl_log_wrlock(lg) ((void)0)
+#define utl_log_unlock(lg) ((void)0)
+#endif
+
+typedef struct utl_log_rot_s {
+  size_t   size;     /* bytes written to the current file */
+  size_t   maxsize;
+  int64_t  period;
+  int64_t  next;     /* when the current file expires */
+} utl_log_rot_s;
+
+static char utl_log_binsig[8] = "\x7Futlbin\x01";
+
+/* A ring log is a header followed by the circular buffer. The header
+** takes UTL_LOG_RINGHDR bytes so that the buffer is well aligned.
+*/
+typedef struct utl_log_ring_s {
+  char     sig[8];
+  uint64_t size;     /* size of the buffer */
+  uint64_t head;     /* bytes written since the file has been created */
+} utl_log_ring_s;
+
+#define UTL_LOG_RINGHDR 64
+
+static char utl_log_ringsig[8] = "\x7Futlring";
+
+/* Writes the content of a ring log starting from the oldest complete line */
+static int utl_log_unring(FILE *in, FILE *out)
+{
+  utl_log_ring_s r;
+  char *buf, *p, *end;
+  uint64_t start;
+  int lines = 0;
+  
+  if (fread(&r.size, 8, 1, in) != 1 || fread(&r.head, 8, 1, in) != 1 ||
+      r.size == 0) return -1;
+  for (start = 24; start < UTL_LOG_RINGHDR; start++) 
+    if (fgetc(in) == EOF) return -1;
+  
+  buf = malloc(r.size);
+  if (!buf) return -1;
+  if (fread(buf, 1, r.size, in) != r.size) { free(buf); return -1; }
+  
+  start = (r.head > r.size) ? r.head % r.size : 0;
+  p = buf + start;
+  end = buf + r.size;
+  if (r.head > r.size) {  /* skip the line that has been partially overwritten */
+    while (p < end && *p != '\n') p++;
+    if (p < end) p++;
+  }
+  else end = buf + r.head;
+  
+  /* Skip the unwritten (zeroed) parts that a crash might have left */
+  for (;;) {
+    while (p < end) {
+      if (*p) fputc(*p, out);
+      if (*p++ == '\n') lines++;
+    }
+    if (end == buf + start || start == 0) break;
+    p = buf; end = buf + start;
+  }
+  free(buf);
+  return lines;
+}
+
+#define UTL_ARG_NONE   0
+#define UTL_ARG_INT    1
+#define UTL_ARG_LONG   2
+#define UTL_ARG_LLONG  3
+#define UTL_ARG_SIZE   4
+#define UTL_ARG_IMAX   5
+#define UTL_ARG_PDIFF  6
+#define UTL_ARG_DBL    7
+#define UTL_ARG_LDBL   8
+#define UTL_ARG_STR    9
+#define UTL_ARG_PTR   10
+#define UTL_ARG_CNT   11  /* %n */
+#define UTL_ARG_WSTR  12  /* %ls */
+#define UTL_ARG_WCHR  13  /* %lc */
+
+/* Scans the conversion that starts at '|fmt| (that points to a '|%|).
+** Returns a pointer past the end of the conversion, sets the argument
+** class and the number of '|*| in width and precision.
+*/
+static char *utl_fmt_next(char *fmt, int *cls, int *stars)
+{
+  int l = 0;
+  
+  *stars = 0;
+  *cls = UTL_ARG_NONE;
+  fmt++;
+  while (*fmt && strchr("-+ #0'",*fmt)) fmt++;
+  if (*fmt == '*') { (*stars)++; fmt++; }
+  else while (isdigit((int)*fmt)) fmt++;
+  if (*fmt == '.') {
+    fmt++;
+    if (*fmt == '*') { (*stars)++; fmt++; }
+    else while (isdigit((int)*fmt)) fmt++;
+  }
+  switch (*fmt) {
+    case 'h' : fmt++; if (*fmt == 'h') fmt++; break;
+    case 'l' : fmt++; l = 'l'; if (*fmt == 'l') {fmt++; l = 'q';} break;
+    case 'q' : 
+    case 'L' :
+    case 'z' :
+    case 'j' :
+    case 't' : l = *fmt++; break;
+  }
+  switch (*fmt) {
+    case 'c' :
+      if (l == 'l') { *cls = UTL_ARG_WCHR; break; }
+      /* fall through */
+    case 'd' : case 'i' : case 'o' : case 'u' :
+    case 'x' : case 'X' :
+      switch (l) {
+        case 'l' : *cls = UTL_ARG_LONG;  break;
+        case 'q' :
+        case 'L' : *cls = UTL_ARG_LLONG; break;
+        case 'z' : *cls = UTL_ARG_SIZE;  break;
+        case 'j' : *cls = UTL_ARG_IMAX;  break;
+        case 't' : *cls = UTL_ARG_PDIFF; break;
+        default  : *cls = UTL_ARG_INT;   break;
+      }
+      break;
+    
+    case 'e' : case 'E' : case 'f' : case 'F' :
+    case 'g' : case 'G' : case 'a' : case 'A' :
+      *cls = (l == 'L') ? UTL_ARG_LDBL : UTL_ARG_DBL;
+      break;
+    
+    case 's' : *cls = (l == 'l') ? UTL_ARG_WSTR : UTL_ARG_STR; break;
+    case 'p' : *cls = UTL_ARG_PTR; break;
+    case 'n' : *cls = UTL_ARG_CNT; break;
+    case '\0': return fmt;
+  }
+  return fmt+1;
+}
+
+typedef struct utl_log_bin_s {
+  char      *buf;
+  size_t     len;
+  void     **keys;   /* Interned strings (open addressing) */
+  char     **strs;   /* their text when they were interned */
+  uint32_t  *ids;
+  uint32_t   nkeys;
+  size_t     mask;
+} utl_log_bin_s;
+
+static void utl_log_bin_flush(utlLogger lg)
+{
+  utl_log_bin_s *b = lg->bin;
+  
+  if (b->len > 0) fwrite(b->buf, 1, b->len, utl_logFile(lg));
+  b->len = 0;
+  fflush(utl_logFile(lg));
+}
+
+static void utl_log_bin_put(utlLogger lg, void *data, size_t len)
+{
+  utl_log_bin_s *b = lg->bin;
+  
+  if (lg->rotate) lg->rotate->size += len;
+  if (b->len + len > UTL_LOG_BINBUF) utl_log_bin_flush(lg);
+  if (len > UTL_LOG_BINBUF) fwrite(data, 1, len, utl_logFile(lg));
+  else {
+    memcpy(b->buf + b->len, data, len);
+    b->len += len;
+  }
+}
+
+static size_t utl_log_bin_slot(utl_log_bin_s *b, void *key)
+{
+  size_t h = (((uintptr_t)key) >> 3) * 2654435761u;
+  
+  for (h &= b->mask; b->keys[h] && b->keys[h] != key; h = (h+1) & b->mask) ;
+  return h;
+}
+
+/* Returns the id of a format string or a prefix. The first time a string
+** is seen, its text is written to the log. Strings are looked up by their
+** address: if the text at that address has changed, it gets a new id.
+*/
+static uint32_t utl_log_bin_id(utlLogger lg, char *str)
+{
+  utl_log_bin_s *b = lg->bin;
+  void    **keys;
+  char    **strs;
+  uint32_t *ids;
+  size_t h, k;
+  uint16_t n;
+  char rec[7];
+  char *txt;
+  
+  if (!str) return 0;
+  h = utl_log_bin_slot(b, str);
+  if (b->keys[h] && strcmp(b->strs[h], str) == 0) return b->ids[h];
+  
+  k = strlen(str);
+  n = (k > 0xFFFF) ? 0xFFFF : (uint16_t)k;
+  txt = malloc(n+1);
+  if (!txt) return 0;
+  memcpy(txt, str, n);  txt[n] = '\0';
+  
+  if (b->keys[h]) free(b->strs[h]);  /* Same address, different text */
+  else if (2 * (b->nkeys+1) > b->mask) {  /* Keep the table half empty */
+    size_t m = 2 * (b->mask+1);
+    keys = calloc(m, sizeof(void *));
+    strs = malloc(m * sizeof(char *));
+    ids  = malloc(m * sizeof(uint32_t));
+    if (!keys || !strs || !ids) { free(keys); free(strs); free(ids); free(txt); return 0; }
+    for (k = 0; k <= b->mask; k++) {
+      if (b->keys[k]) {
+        for (h = (((uintptr_t)b->keys[k]) >> 3) * 2654435761u & (m-1); keys[h]; h = (h+1) & (m-1)) ;
+        keys[h] = b->keys[k];  strs[h] = b->strs[k];  ids[h] = b->ids[k];
+      }
+    }
+    free(b->keys);  free(b->strs);  free(b->ids);
+    b->keys = keys;  b->strs = strs;  b->ids = ids;  b->mask = m-1;
+    h = utl_log_bin_slot(b, str);
+  }
+  
+  b->keys[h] = str;
+  b->strs[h] = txt;
+  b->ids[h]  = ++b->nkeys;
+  
+  rec[0] = 'F';
+  memcpy(rec+1, &b->ids[h], 4);
+  memcpy(rec+5, &n, 2);
+  utl_log_bin_put(lg, rec, 7);
+  utl_log_bin_put(lg, str, n);
+  
+  return b->ids[h];
+}
+
+static void utl_log_bin_header(utlLogger lg)
+{
+  uint32_t bom = 0x01020304;
+  
+  utl_log_bin_put(lg, utl_log_binsig, 8);
+  utl_log_bin_put(lg, &bom, 4);
+}
+
+static int utl_log_bin_open(utlLogger lg)
+{
+  utl_log_bin_s *b;
+  
+  b = malloc(sizeof(utl_log_bin_s));
+  if (!b) return 0;
+  b->buf  = malloc(UTL_LOG_BINBUF);
+  b->keys = calloc(64, sizeof(void *));
+  b->strs = malloc(64 * sizeof(char *));
+  b->ids  = malloc(64 * sizeof(uint32_t));
+  if (!b->buf || !b->keys || !b->strs || !b->ids) {
+    free(b->buf); free(b->keys); free(b->strs); free(b->ids); free(b);
+    return 0;
+  }
+  b->len = 0;  b->nkeys = 0;  b->mask = 63;
+  
+  lg->bin = b;
+  lg->flags |= UTL_LOG_BIN;
+  fseek(lg->file, 0, SEEK_END);
+  if (ftell(lg->file) == 0) utl_log_bin_header(lg);
+  return 1;
+}
+
+static void utl_log_bin_close(utlLogger lg)
+{
+  utl_log_bin_s *b = lg->bin;
+  
+  size_t k;
+  
+  if (!b) return;
+  utl_log_bin_flush(lg);
+  for (k = 0; k <= b->mask; k++) if (b->keys[k]) free(b->strs[k]);
+  free(b->buf);  free(b->keys);  free(b->strs);  free(b->ids);  free(b);
+  lg->bin = NULL;
+  lg->flags &= ~UTL_LOG_BIN;
+}
+
+#define utl_log_bin_arg(r,n,v,ty) do { ty x_ = (ty)(v); \
+                                       if (n + 8 > sizeof(r)) goto full; \
+                                       memcpy(r+n, &x_, 8); n += 8; \
+                                     } while (utlZero)
+
+static void utl_log_bin_write(utlLogger lg, char *pre, int lv, int tstamp, char *format, va_list args)
+{
+  char rec[20 + 2 * UTL_LOG_LINEMAX];
+  size_t n = 20;
+  uint16_t len;
+  uint32_t id;
+  int64_t  usec = 0;
+  char *fmt = format;
+  char *s;
+  char mb[UTL_LOG_LINEMAX+1];
+  wchar_t *ws;
+  mbstate_t st;
+  size_t m;
+  int cls, stars;
+  
+  id = utl_log_bin_id(lg, pre);      memcpy(rec+6, &id, 4);
+  id = utl_log_bin_id(lg, format);       memcpy(rec+2, &id, 4);
+  if (tstamp) usec = utl_clock(lg->flags & UTL_LOG_USEC);
+  memcpy(rec+10, &usec, 8);
+  rec[0] = 'M';
+  rec[1] = (char)(lv | (tstamp ? 0x80 : 0) | (lg->flags & (UTL_LOG_USEC | UTL_LOG_UTC)));
+  
+  while ((fmt = strchr(fmt, '%'))) {
+    fmt = utl_fmt_next(fmt, &cls, &stars);
+    while (stars-- > 0) utl_log_bin_arg(rec, n, va_arg(args, int), int64_t);
+    switch (cls) {
+      case UTL_ARG_INT   : utl_log_bin_arg(rec, n, va_arg(args, int),         int64_t); break;
+      case UTL_ARG_LONG  : utl_log_bin_arg(rec, n, va_arg(args, long),        int64_t); break;
+      case UTL_ARG_LLONG : utl_log_bin_arg(rec, n, va_arg(args, long long),   int64_t); break;
+      case UTL_ARG_SIZE  : utl_log_bin_arg(rec, n, va_arg(args, size_t),      int64_t); break;
+      case UTL_ARG_IMAX  : utl_log_bin_arg(rec, n, va_arg(args, intmax_t),    int64_t); break;
+      case UTL_ARG_PDIFF : utl_log_bin_arg(rec, n, va_arg(args, ptrdiff_t),   int64_t); break;
+      case UTL_ARG_DBL   : utl_log_bin_arg(rec, n, va_arg(args, double),      double);  break;
+      case UTL_ARG_LDBL  : utl_log_bin_arg(rec, n, va_arg(args, long double), double);  break;
+      case UTL_ARG_PTR   : utl_log_bin_arg(rec, n, (uintptr_t)va_arg(args, void *), int64_t); break;
+      case UTL_ARG_CNT   : (void)va_arg(args, void *); break;
+      case UTL_ARG_WSTR  : ws = va_arg(args, wchar_t *);
+                           m = ws ? wcstombs(mb, ws, UTL_LOG_LINEMAX) : 0;
+                           if (m == (size_t)-1) m = 0;
+                           mb[m] = '\0';
+                           s = ws ? mb : "(null)";
+                           goto str;
+      case UTL_ARG_WCHR  : memset(&st, 0, sizeof(st));
+                           m = wcrtomb(mb, (wchar_t)va_arg(args, wint_t), &st);
+                           if (m == (size_t)-1) m = 0;
+                           mb[m] = '\0';
+                           s = mb;
+                           goto str;
+      case UTL_ARG_STR   : s = va_arg(args, char *);
+                           if (!s) s = "(null)";
+                      str: len = (uint16_t)strnlen(s, UTL_LOG_LINEMAX);
+                           if (n + 2 + len > sizeof(rec)) goto full;
+                           memcpy(rec+n, &len, 2);  n += 2;
+                           memcpy(rec+n, s, len);   n += len;
+                           break;
+    }
+  }
+ full:
+  len = (uint16_t)(n-20);
+  memcpy(rec+18, &len, 2);
+  utl_log_bin_put(lg, rec, n);
+}
+
+#undef utl_log_bin_arg
+
+/* Decodes a binary (or ring) log writing the messages as text. Returns the
+** number of messages decoded or -1 if the input is not a binary log or is
+** corrupted (a format id far beyond the ones seen so far).
+*/
+#define UTL_LOG_IDSTEP 65536  /* ids are consecutive: a bigger jump is corruption */
+
+int utl_log_decode(FILE *in, FILE *out)
+{
+  char     **strs = NULL;
+  uint32_t   nstrs = 0;
+  uint32_t   id, pre, bom;
+  uint16_t   len, slen;
+  int64_t    usec, iv;
+  double     dv;
+  char       hdr[8];
+  char       spec[64];
+  char       args[2 * UTL_LOG_LINEMAX];
+  char       str[UTL_LOG_LINEMAX+1];
+  char       tstr[UTL_TS_MAX];
+  char      *fmt, *end, *s, *a;
+  int        c, lv, cls, stars, k, w;
+  int        msgs = 0;
+  
+  if (fread(hdr, 1, 8, in) != 8) return -1;
+  if (memcmp(hdr, utl_log_ringsig, 8) == 0) return utl_log_unring(in, out);
+  if (memcmp(hdr, utl_log_binsig, 8) ||
+      fread(&bom, 4, 1, in) != 1 || bom != 0x01020304) return -1;
+  
+  while ((c = fgetc(in)) != EOF) {
+    if (c == 'F') {
+      if (fread(&id, 4, 1, in) != 1 || fread(&len, 2, 1, in) != 1) break;
+      if (id >= nstrs + UTL_LOG_IDSTEP) { msgs = -1; break; }
+      if (id >= nstrs) {
+        char **tmp = realloc(strs, (id+16) * sizeof(char *));
+        if (!tmp) break;
+        strs = tmp;
+        while (nstrs < id+16) strs[nstrs++] = NULL;
+      }
+      free(strs[id]);
+      strs[id] = malloc(len+1);
+      if (!strs[id] || fread(strs[id], 1, len, in) != len) break;
+      strs[id][len] = '\0';
+    }
+    else if (c == 'M') {
+      if ((lv = fgetc(in)) == EOF || fread(&id, 4, 1, in) != 1 ||
+          fread(&pre, 4, 1, in) != 1 || fread(&usec, 8, 1, in) != 1 ||
+          fread(&len, 2, 1, in) != 1 || len > sizeof(args) ||
+          fread(args, 1, len, in) != len) break;
+      
+      k = utl_tstamp(tstr, usec, lv);
+      if (!(lv & 0x80)) memset(tstr, ' ', k);
+      if (pre < nstrs && strs[pre]) fprintf(out, "%s ", strs[pre]);
+      fprintf(out, "%s %.4s", tstr, utl_log_abbrev + ((lv & 0x0F) << 2));
+      
+      fmt = (id < nstrs && strs[id]) ? strs[id] : "";
+      a = args;
+      while (*fmt) {
+        if (*fmt != '%') { fputc(*fmt++, out); continue; }
+        end = utl_fmt_next(fmt, &cls, &stars);
+        
+        /* Rewrite the conversion replacing '*' with the stored values */
+        for (k = 0, s = fmt; s < end && k < 40; s++) {
+          if (*s == '*' && a + 8 <= args + len) {
+            memcpy(&iv, a, 8);  a += 8;
+            w = snprintf(spec+k, 16, "%d", (int)iv);
+            if (w > 0) k += w;
+          }
+          else spec[k++] = *s;
+        }
+        spec[k] = '\0';
+        fmt = end;
+        
+        if (cls == UTL_ARG_NONE) { if (end[-1] == '%') fputc('%', out); continue; }
+        if (cls == UTL_ARG_CNT) continue;
+        if (cls == UTL_ARG_WSTR || cls == UTL_ARG_WCHR) {  /* stored as multibyte */
+          if (k >= 2 && spec[k-2] == 'l') k--;
+          spec[k-1] = 's';  spec[k] = '\0';
+          cls = UTL_ARG_STR;
+        }
+        if (cls == UTL_ARG_STR) {
+          if (a + 2 > args + len) { fputs("<?>", out); continue; }
+          memcpy(&slen, a, 2);  a += 2;
+          if (slen > UTL_LOG_LINEMAX || a + slen > args + len) { fputs("<?>", out); continue; }
+          memcpy(str, a, slen);  str[slen] = '\0';  a += slen;
+          fprintf(out, spec, str);
+          continue;
+        }
+        if (a + 8 > args + len) { fputs("<?>", out); continue; }
+        memcpy(&iv, a, 8);  memcpy(&dv, a, 8);  a += 8;
+        switch (cls) {
+          case UTL_ARG_INT   : fprintf(out, spec, (int)iv);               break;
+          case UTL_ARG_LONG  : fprintf(out, spec, (long)iv);              break;
+          case UTL_ARG_LLONG : fprintf(out, spec, (long long)iv);         break;
+          case UTL_ARG_SIZE  : fprintf(out, spec, (size_t)iv);            break;
+          case UTL_ARG_IMAX  : fprintf(out, spec, (intmax_t)iv);          break;
+          case UTL_ARG_PDIFF : fprintf(out, spec, (ptrdiff_t)iv);         break;
+          case UTL_ARG_DBL   : fprintf(out, spec, dv);                    break;
+          case UTL_ARG_LDBL  : fprintf(out, spec, (long double)dv);       break;
+          case UTL_ARG_PTR   : fprintf(out, spec, (void *)(uintptr_t)iv); break;
+        }
+      }
+      fputc('\n', out);
+      msgs++;
+    }
+    else break;
+  }
+  
+  while (nstrs > 0) free(strs[--nstrs]);
+  free(strs);
+  return msgs;
+}
+
+/* Name of the n-th rotated file: "mylog.log" -> "mylog_001.log" */
+static void utl_log_rotname(char *buf, char *fname, int n)
+{
+  char *ext = strrchr(fname, '.');
+  
+  if (!ext || strpbrk(ext, "/\\")) ext = fname + strlen(fname);
+  sprintf(buf, "%.*s_%03d%s", (int)(ext-fname), fname, n, ext);
+}
+
+static void utl_log_rotate_now(utlLogger lg)
+{
+  utl_log_rot_s *r = lg->rotate;
+  char *oldname, *newname;
+  int k;
+  
+  oldname = malloc(2 * (strlen(lg->fname) + 16));
+  if (!oldname) return;
+  newname = oldname + strlen(lg->fname) + 16;
+  
+  utl_log_rotname(oldname, lg->fname, lg->rot);
+  remove(oldname);
+  for (k = lg->rot-1; k > 0; k--) {
+    utl_log_rotname(newname, lg->fname, k+1);
+    utl_log_rotname(oldname, lg->fname, k);
+    rename(oldname, newname);
+  }
+  
+  if (lg->bin) utl_log_bin_flush(lg);
+  fclose(lg->file);
+  utl_log_rotname(newname, lg->fname, 1);
+  rename(lg->fname, newname);
+  lg->file = fopen(lg->fname, lg->bin ? "wb" : "w");
+  if (!lg->file) lg->file = fopen(newname, lg->bin ? "ab" : "a");
+  free(oldname);
+  
+  if (!lg->file) {  /* Can't write anywhere: go on with stderr, no more rotations */
+    lg->flags |= UTL_LOG_ERR;
+    lg->rot = 0;
+    return;
+  }
+  r->size = 0;
+  if (r->period > 0) utl_atomic_set(&r->next, utlClock() + r->period);
+  if (lg->bin) {
+    for (k = 0; k <= (int)lg->bin->mask; k++)
+      if (lg->bin->keys[k]) free(lg->bin->strs[k]);
+    memset(lg->bin->keys, 0, (lg->bin->mask+1) * sizeof(void *));
+    lg->bin->nkeys = 0;
+    utl_log_bin_header(lg);
+  }
+}
+
+#define utl_log_expired(r,sz) (((r)->maxsize > 0 && (sz) >= (r)->maxsize) || \
+                    ((r)->period > 0 && utlClock() >= utl_atomic_get(&(r)->next)))
+
+/* Rotates the log if needed given its current size. The size is updated
+** by the writers while holding the lock.
+*/
+static void utl_log_rotate(utlLogger lg, size_t sz)
+{
+  utl_log_rot_s *r = lg->rotate;
+  
+  if (!r) return;
+  if (utl_log_expired(r, sz)) {
+    utl_log_wrlock(lg);
+    if (lg->file && utl_log_expired(r, r->size))  /* Others may have done it */
+      utl_log_rotate_now(lg);
+    utl_log_unlock(lg);
+  }
+}
+
+int utl_logRotate(utlLogger lg, size_t size, long secs, int n)
+{
+  utl_log_rot_s *r;
+  
+  if (!lg || !lg->fname || !lg->file) return 0;
+  
+  r = lg->rotate;
+  if (!r) {
+    r = malloc(sizeof(utl_log_rot_s));
+    if (!r) return 0;
+    fflush(lg->file);
+    fseek(lg->file, 0, SEEK_END);
+    r->size = (size_t)ftell(lg->file);
+    if (lg->bin) r->size += lg->bin->len;
+  }
+  r->maxsize = size;
+  r->period  = (int64_t)secs * 1000000;
+  r->next    = utlClock() + r->period;
+  lg->rot = (unsigned short)(n > 0 ? n : 1);
+  lg->rotate = r;
+  return 1;
+}
+
+utlLogger utl_logOpen(char *fname, char *mode)
+{
+  char md[4];
+  utlLogger lg = logStderr;
+  FILE *f = NULL;
+  
+  if (fname) {
+    md[0] = mode[0]; md[1] = '+'; md[2] = '\0';
+    if (md[0] != 'a' && md[0] != 'w') md[0] = 'a'; 
+    if (strchr(mode,'b')) md[1] = 'b';
+    f = fopen(fname,md);
+  }
+  
+  if (f) {
+    lg = malloc(sizeof(utl_log_s));
+    if (lg) { 
+      lg->flags = 0;
+      lg->rot = 0;
+    lg->pre = NULL;
+      lg->async = NULL;
+      lg->bin = NULL;
+      lg->rotate = NULL;
+      lg->lock = NULL;
+      lg->ring = NULL;
+      lg->node = NULL;
+#ifdef UTL_THREADS
+      lg->lock = malloc(sizeof(utl_log_lock_s));
+      if (lg->lock) pthread_rwlock_init(&lg->lock->rw, NULL);
+#endif
+      lg->fname = malloc(strlen(fname)+1);
+      if (lg->fname) strcpy(lg->fname, fname);
+      lg->file = f;
+    /* Assume that log_L is the last level in utl_log_abbrev */
+    utlAssume( (log_L +1) == ((sizeof(utl_log_abbrev)-1)>>2));
+      if (md[1] == 'b' && !utl_log_bin_open(lg)) {
+        lg->file = NULL;  fclose(f);
+        return utl_log_close(lg);
+      }
+      lg->level = log_L;
+      utl_log_write(lg,log_L, 1, "%s \"%s\"", (md[0] == 'a') ? "ADDEDTO" : "CREATED",fname); 
+      
+      lg->level = log_W;
+    }
+  }
+  if (f && !lg) fclose(f);
+  return lg;
+}
+
+#ifdef UTL_THREADS
+
+/* In asynchronous mode, the ring is a bounded queue of fixed size records
+** (D. Vyukov's algorithm). Each record has a sequence number that tells if
+** it is free to be claimed by a caller (seq == pos) or ready to be written
+** by the background thread (seq == pos+1).
+*/
+
+typedef struct {
+  size_t seq;
+  size_t len;
+  char   txt[UTL_LOG_LINEMAX];
+} utl_log_rec_t;
+
+typedef struct utl_log_async_s {
+  utl_log_rec_t   *ring;
+  size_t           mask;
+  size_t           head;     /* next record to be claimed by a caller   */
+  size_t           tail;     /* next record to be written by the thread */
+  size_t           dropped;
+  int              policy;
+  int              stop;
+  int              sleeping;
+  int              waiting;
+  pthread_t        thread;
+  pthread_mutex_t  mtx;
+  pthread_cond_t   wake;     /* there are records to write */
+  pthread_cond_t   room;     /* there are free records     */
+} utl_log_async_s;
+
+static void utl_log_timedwait(pthread_cond_t *c, pthread_mutex_t *m, long ms)
+{
+  struct timespec ts;
+  
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_nsec += ms * 1000000L;
+  ts.tv_sec  += ts.tv_nsec / 1000000000L;
+  ts.tv_nsec %= 1000000000L;
+  pthread_cond_timedwait(c, m, &ts);
+}
+
+static int utl_log_pending(utl_log_async_s *a)
+{
+  return __atomic_load_n(&a->ring[a->tail & a->mask].seq, __ATOMIC_SEQ_CST) == a->tail+1;
+}
+
+/* Writes (at most a ring full of) records. Only called by the writer thread */
+static size_t utl_log_drain(utlLogger lg)
+{
+  utl_log_async_s *a = lg->async;
+  FILE *f = utl_logFile(lg);
+  utl_log_rec_t *r;
+  size_t n = 0;
+  size_t sz = 0;
+  size_t d;
+  char line[UTL_LOG_LINEMAX];
+  
+  while (n <= a->mask) {
+    r = a->ring + (a->tail & a->mask);
+    if (__atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) != a->tail+1) break;
+    sz += fwrite(r->txt, 1, r->len, f);
+    __atomic_store_n(&r->seq, a->tail + a->mask + 1, __ATOMIC_RELEASE);
+    a->tail++;  n++;
+  }
+  
+  d = __atomic_exchange_n(&a->dropped, 0, __ATOMIC_RELAXED);
+  if (d > 0) sz += fwrite(line, 1, utl_log_sformat(lg, log_L, line, UTL_LOG_LINEMAX,
+                                           "DROPPED %lu messages", (unsigned long)d), f);
+  if (n > 0 || d > 0) fflush(f);
+  if (lg->rot > 0) utl_log_rotate(lg, utl_atomic_add(&lg->rotate->size, sz));
+  
+  if (n > 0 && __atomic_load_n(&a->waiting, __ATOMIC_RELAXED)) {
+    pthread_mutex_lock(&a->mtx);
+    pthread_cond_broadcast(&a->room);
+    pthread_mutex_unlock(&a->mtx);
+  }
+  return n;
+}
+
+static void *utl_log_writer(void *arg)
+{
+  utlLogger lg = arg;
+  utl_log_async_s *a = lg->async;
+  
+  for (;;) {
+    if (utl_log_drain(lg) > 0) continue;
+    if (__atomic_load_n(&a->stop, __ATOMIC_ACQUIRE)) break;
+    pthread_mutex_lock(&a->mtx);
+    __atomic_store_n(&a->sleeping, 1, __ATOMIC_SEQ_CST);
+    if (!utl_log_pending(a) && !a->stop) utl_log_timedwait(&a->wake, &a->mtx, 100);
+    __atomic_store_n(&a->sleeping, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&a->mtx);
+  }
+  utl_log_drain(lg);
+  return NULL;
+}
+
+static void utl_log_async_write(utlLogger lg, char *pre, int lv, int tstamp, char *format, va_list args)
+{
+  utl_log_async_s *a = lg->async;
+  utl_log_rec_t *r;
+  size_t pos, seq;
+  
+  pos = __atomic_load_n(&a->head, __ATOMIC_RELAXED);
+  for (;;) {
+    r = a->ring + (pos & a->mask);
+    seq = __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE);
+    if (seq == pos) {
+      if (__atomic_compare_exchange_n(&a->head, &pos, pos+1, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+    }
+    else if ((ptrdiff_t)(seq - pos) < 0) {  /* the ring is full */
+      if (a->policy == UTL_LOG_COUNT) __atomic_add_fetch(&a->dropped, 1, __ATOMIC_RELAXED);
+      if (a->policy != UTL_LOG_BLOCK) return;
+      pthread_mutex_lock(&a->mtx);
+      __atomic_add_fetch(&a->waiting, 1, __ATOMIC_SEQ_CST);
+      pthread_cond_signal(&a->wake);
+      utl_log_timedwait(&a->room, &a->mtx, 10);
+      __atomic_sub_fetch(&a->waiting, 1, __ATOMIC_SEQ_CST);
+      pthread_mutex_unlock(&a->mtx);
+      pos = __atomic_load_n(&a->head, __ATOMIC_RELAXED);
+    }
+    else pos = __atomic_load_n(&a->head, __ATOMIC_RELAXED);
+  }
+  
+  r->len = utl_log_format(lg, pre, lv, tstamp, r->txt, UTL_LOG_LINEMAX, format, args);
+  if (r->len >= UTL_LOG_LINEMAX) r->len = UTL_LOG_LINEMAX-1;
+  __atomic_store_n(&r->seq, pos+1, __ATOMIC_SEQ_CST);
+  
+  if (__atomic_load_n(&a->sleeping, __ATOMIC_SEQ_CST)) {
+    pthread_mutex_lock(&a->mtx);
+    pthread_cond_signal(&a->wake);
+    pthread_mutex_unlock(&a->mtx);
+  }
+}
+
+int utl_logAsync(utlLogger lg, size_t nrecs, int policy)
+{
+  utl_log_async_s *a;
+  size_t k;
+  
+  if (!lg || lg->async || lg->node || (lg->flags & (UTL_LOG_BIN | UTL_LOG_RING))) return 0;
+  
+  a = malloc(sizeof(utl_log_async_s));
+  if (!a) return 0;
+  
+  for (k = 2; k < nrecs; k <<= 1) ;
+  a->ring = malloc(k * sizeof(utl_log_rec_t));
+  if (!a->ring) { free(a); return 0; }
+  
+  a->mask = k-1;
+  for (k = 0; k <= a->mask; k++) a->ring[k].seq = k;
+  a->head = 0;     a->tail = 0;
+  a->dropped = 0;  a->policy = policy;
+  a->stop = 0;     a->sleeping = 0;  a->waiting = 0;
+  pthread_mutex_init(&a->mtx, NULL);
+  pthread_cond_init(&a->wake, NULL);
+  pthread_cond_init(&a->room, NULL);
+  
+  lg->async = a;
+  lg->flags |= UTL_LOG_ASYNC;
+  if (pthread_create(&a->thread, NULL, utl_log_writer, lg) != 0) {
+    lg->flags &= ~UTL_LOG_ASYNC;
+    lg->async = NULL;
+    pthread_cond_destroy(&a->room);
+    pthread_cond_destroy(&a->wake);
+    pthread_mutex_destroy(&a->mtx);
+    free(a->ring);  free(a);
+    return 0;
+  }
+  return 1;
+}
+
+/* Stops the writer thread once all pending records have been written */
+static void utl_log_async_stop(utlLogger lg)
+{
+  utl_log_async_s *a = lg->async;
+  
+  if (!a) return;
+  pthread_mutex_lock(&a->mtx);
+  __atomic_store_n(&a->stop, 1, __ATOMIC_RELEASE);
+  pthread_cond_signal(&a->wake);
+  pthread_mutex_unlock(&a->mtx);
+  pthread_join(a->thread, NULL);
+  
+  lg->flags &= ~UTL_LOG_ASYNC;
+  lg->async = NULL;
+  pthread_cond_destroy(&a->room);
+  pthread_cond_destroy(&a->wake);
+  pthread_mutex_destroy(&a->mtx);
+  free(a->ring);  free(a);
+}
+
+#else  /*- UTL_THREADS */
+
+int utl_logAsync(utlLogger lg, size_t nrecs, int policy) { return 0; }
+#define utl_log_async_stop(lg) ((void)0)
+
+#endif /*- UTL_THREADS */
+
+/* Lines are formatted in a per-thread buffer (or on the heap, if they are
+** too long and the caller allows it) and written with a single fwrite()
+** (or memcpy() for ring logs) so that lines written by different threads
+** are never mixed.
+*/
+static utl_thread_local char utl_log_stage[UTL_LOG_LINEMAX];
+
+static char *utl_log_stage_line(utlLogger lg, char *pre, int lv, int tstamp, int *len, int heap,
+                                char *format, va_list args)
+{
+  va_list cp;
+  char *line = utl_log_stage;
+  int n;
+  
+  va_copy(cp, args);
+  n = utl_log_format(lg, pre, lv, tstamp, line, UTL_LOG_LINEMAX, format, args);
+  if (n >= UTL_LOG_LINEMAX) {
+    line = heap ? malloc(n+1) : NULL;
+    if (line) utl_log_format(lg, pre, lv, tstamp, line, n+1, format, cp);
+    else { line = utl_log_stage; n = UTL_LOG_LINEMAX-1; }
+  }
+  va_end(cp);
+  *len = n;
+  return line;
+}
+
+#ifdef UTL_UNIX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+utlLogger utl_logOpenRing(char *fname, size_t size)
+{
+  utlLogger lg;
+  utl_log_ring_s *r;
+  struct stat st;
+  size_t len;
+  int fd, fresh;
+  
+  if (!fname) return logStderr;
+  if (size < 4096) size = 4096;
+  len = UTL_LOG_RINGHDR + size;
+  
+  fd = open(fname, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) return logStderr;
+  
+  fresh = (fstat(fd, &st) != 0 || (size_t)st.st_size != len);
+  if (fresh && (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)len) != 0)) fresh = -1;
+  
+  r = (fresh < 0) ? MAP_FAILED : mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (r == MAP_FAILED) return logStderr;
+  
+  if (!fresh && (memcmp(r->sig, utl_log_ringsig, 8) || r->size != size)) fresh = 1;
+  if (fresh) {
+    memset(r, 0, UTL_LOG_RINGHDR);
+    r->size = size;
+    memcpy(r->sig, utl_log_ringsig, 8);
+  }
+  
+  lg = malloc(sizeof(utl_log_s));
+  if (!lg) { munmap(r, len); return logStderr; }
+  
+  memset(lg, 0, sizeof(utl_log_s));
+  lg->flags = UTL_LOG_RING;
+  lg->ring = r;
+  lg->level = log_L;
+  utl_log_write(lg, log_L, 1, "%s \"%s\"", fresh ? "CREATED" : "ADDEDTO", fname);
+  lg->level = log_W;
+  return lg;
+}
+
+/* Reserves room in the ring and copies the line, wrapping if needed */
+static void utl_log_ring_write(utlLogger lg, char *pre, int lv, int tstamp, char *format, va_list args)
+{
+  utl_log_ring_s *r = lg->ring;
+  char *data = (char *)r + UTL_LOG_RINGHDR;
+  char *line;
+  uint64_t pos;
+  size_t k;
+  int n;
+  
+  line = utl_log_stage_line(lg, pre, lv, tstamp, &n, 0, format, args);
+  
+  pos = utl_atomic_add(&r->head, (uint64_t)n) - n;
+  k = (size_t)(pos % r->size);
+  if (k + n <= r->size) memcpy(data + k, line, n);
+  else {
+    memcpy(data + k, line, r->size - k);
+    memcpy(data, line + (r->size - k), n - (r->size - k));
+  }
+}
+
+static void utl_log_ring_close(utlLogger lg)
+{
+  if (lg->ring) munmap(lg->ring, UTL_LOG_RINGHDR + lg->ring->size);
+  lg->ring = NULL;
+}
+#else
+utlLogger utl_logOpenRing(char *fname, size_t size) { return logStderr; }
+#define utl_log_ring_write(lg,p,lv,t,f,a) ((void)0)
+#define utl_log_ring_close(lg)          ((void)0)
+#endif
+
+utlLogger utl_log_close(utlLogger lg)
+{
+  if (lg && lg->node) return NULL;  /* Named loggers are never freed */
+  if (lg) utl_log_async_stop(lg);
+  if (lg) utl_log_bin_close(lg);
+  if (lg && lg != logStdout && lg != logStderr) utl_log_ring_close(lg);
+  if (lg && lg != logStdout && lg != logStderr) {
+    if (lg->file) fclose(lg->file);
+    lg->file = NULL;
+    free(lg->rotate);
+    free(lg->fname);
+#ifdef UTL_THREADS
+    if (lg->lock) pthread_rwlock_destroy(&lg->lock->rw);
+#endif
+    free(lg->lock);
+    free(lg);
+  }
+  return NULL;
+}
+
+static void utl_log_text_write(utlLogger lg, char *pre, int lv, int tstamp, char *format, va_list args)
+{
+  char *line;
+  FILE *f;
+  size_t sz = 0;
+  int n;
+  
+  line = utl_log_stage_line(lg, pre, lv, tstamp, &n, 1, format, args);
+  
+  utl_log_rdlock(lg);
+  f = utl_logFile(lg);
+  fwrite(line, 1, n, f);
+  fflush(f);
+  if (lg->rotate) sz = utl_atomic_add(&lg->rotate->size, n);
+  utl_log_unlock(lg);
+  
+  if (line != utl_log_stage) free(line);
+  if (lg->rot > 0) utl_log_rotate(lg, sz);
+}
+
+void utl_log_write(utlLogger lg, int lv, int tstamp, char *format, ...)
+{
+  va_list args;
+  int lg_lv = log_W;
+  char *pre;
+  size_t sz;
+  
+  if (!lg) return; 
+  
+  lg_lv = utl_log_level(lg);
+  pre = lg->pre;
+  if (lg->node) lg = utl_atomic_get(&lg->node->sink);  /* Named loggers use their sink */
+  lv = lv & 0x0F;
+  if( lv <= lg_lv) {
+    va_start(args, format);
+    if (lg->flags & UTL_LOG_RING)
+      utl_log_ring_write(lg, pre, lv, tstamp, format, args);
+    else if (lg->flags & UTL_LOG_BIN) {
+      utl_log_wrlock(lg);
+      utl_log_bin_write(lg, pre, lv, tstamp, format, args);
+      sz = lg->rotate ? lg->rotate->size : 0;
+      utl_log_unlock(lg);
+      if (lg->rot > 0) utl_log_rotate(lg, sz);
+    }
+#ifdef UTL_THREADS
+    else if (lg->flags & UTL_LOG_ASYNC)
+      utl_log_async_write(lg, pre, lv, tstamp, format, args);
+#endif
+    else utl_log_text_write(lg, pre, lv, tstamp, format, args);
+    va_end(args);
+  }    
+}
+
+void utl_log_assert(utlLogger lg,int e,char *estr, char *file,int line)
+{ 
+  if (!e) {
+    logFatal(lg,"Assertion failed:  %s, file %s, line %d", estr, file, line);
+#ifndef NDEBUG
+  abort();
+#endif
+  }
+}
+
+/* Returns 1 if at least ms milliseconds have passed since the last time
+** it returned 1. Only one of the threads racing for the same slot wins.
+*/
+int utl_log_every_ms(utl_log_rate_s *r, long ms)
+{
+  int64_t now = utlClock();
+  int64_t next = utl_atomic_get(&r->next);
+  
+  if (now < next) return 0;
+  return utl_atomic_cas(&r->next, next, now + (int64_t)ms * 1000);
+}
+
+/* A xorshift64* generator per thread is more than enough for sampling */
+static utl_thread_local uint64_t utl_log_rnd = 0;
+
+int utl_log_sample(double p)
+{
+  uint64_t x = utl_log_rnd;
+  
+  if (p >= 1.0) return 1;
+  if (p <= 0.0) return 0;
+  if (x == 0) x = (uint64_t)utl_clock(1) ^ (uint64_t)(uintptr_t)&utl_log_rnd;
+  x ^= x >> 12; x ^= x << 25; x ^= x >> 27;
+  if (x == 0) x = 1;
+  utl_log_rnd = x;
+  x *= 0x2545F4914F6CDD1DULL;
+  return (double)(x >> 11) * (1.0 / 9007199254740992.0) < p;
+}
+
+void utl_log_suppressed(utlLogger lg, int lv, unsigned long *cnt)
+{
+  unsigned long n = utl_atomic_get(cnt);
+  
+  while (n > 0 && !utl_atomic_cas(cnt, n, 0)) ;
+  if (n > 0) utl_log_write(lg, lv, 0, "(suppressed %lu similar messages)", n);
+}
+
+/* Key/value lines are built in a stack buffer, one pair at a time. A pair
+** is formatted in a scratch buffer and added to the line only if it fits
+** as a whole; room for the closing brace is always left.
+**   utl_log_kv_put() returns -1 once the buffer is full and keeps returning
+** it for the rest of the pair.
+*/
+#define UTL_LOG_KVMAX (UTL_LOG_LINEMAX - 4)
+
+static int utl_log_kv_put(char *b, int n, char *s, int len)
+{
+  if (n < 0 || n + len > UTL_LOG_KVMAX) return -1;
+  memcpy(b+n, s, len);
+  return n + len;
+}
+
+static int utl_log_kv_esc(char *b, int n, char *s, int quote)
+{
+  char esc[8];
+  
+  if (quote) n = utl_log_kv_put(b, n, "\"", 1);
+  for (; *s; s++) {
+    switch (*s) {
+      case '"' : n = utl_log_kv_put(b, n, "\\\"", 2); break;
+      case '\\': n = utl_log_kv_put(b, n, "\\\\", 2); break;
+      case '\n': n = utl_log_kv_put(b, n, "\\n", 2);  break;
+      case '\r': n = utl_log_kv_put(b, n, "\\r", 2);  break;
+      case '\t': n = utl_log_kv_put(b, n, "\\t", 2);  break;
+      default  : if ((unsigned char)*s < 0x20) {
+                   sprintf(esc, "\\u%04x", (unsigned char)*s);
+                   n = utl_log_kv_put(b, n, esc, 6);
+                 }
+                 else n = utl_log_kv_put(b, n, s, 1);
+                 break;
+    }
+  }
+  if (quote) n = utl_log_kv_put(b, n, "\"", 1);
+  return n;
+}
+
+/* A logfmt value needs quotes if it's empty or contains blanks, quotes,
+** equal signs or control characters.
+*/
+static int utl_log_kv_quote(char *s)
+{
+  if (!*s) return 1;
+  for (; *s; s++)
+    if ((unsigned char)*s <= ' ' || *s == '"' || *s == '=' || *s == '\\') return 1;
+  return 0;
+}
+
+/* A JSON value can be left unquoted if it's a finite decimal number */
+static int utl_log_kv_number(char *s, int conv)
+{
+  if (!conv || !strchr("diufeEgG", conv)) return 0;
+  while (*s == ' ') s++;
+  if (*s == '+') return 0;
+  if (*s == '-') s++;
+  return isdigit((int)*s) && !strpbrk(s, "inIN");
+}
+
+void utl_log_kv(utlLogger lg, int lv, char *event, ...)
+{
+  va_list args;
+  char line[UTL_LOG_LINEMAX];
+  char pair[UTL_LOG_LINEMAX];
+  char val[UTL_LOG_LINEMAX];
+  char *key, *fmt, *end;
+  int json, n, m, cls, stars, w, p;
+  
+  if (!lg || (lv & 0x0F) > utl_log_level(lg)) return;
+  json = (lg->flags & UTL_LOG_JSON) != 0;
+  
+  if (!event) event = "";
+  if (json) n = utl_log_kv_put(line, 0, "{\"event\":", 9);
+  else      n = utl_log_kv_put(line, 0, "event=", 6);
+  m = utl_log_kv_esc(line, n, event, json || utl_log_kv_quote(event));
+  if (m < 0) m = utl_log_kv_esc(line, n, "", 1);  /* an event too long is dropped */
+  n = m;
+  
+  va_start(args, event);
+  while ((key = va_arg(args, char *))) {
+    fmt = va_arg(args, char *);
+    if (!fmt) break;
+    
+    /* Fetch the value according to its type and format it */
+    end = strchr(fmt, '%');
+    cls = UTL_ARG_NONE; stars = 0;
+    while (end && end[1] == '%') end = strchr(end+2, '%');
+    if (end) end = utl_fmt_next(end, &cls, &stars);
+    w = (stars > 0) ? va_arg(args, int) : 0;
+    p = (stars > 1) ? va_arg(args, int) : 0;
+    val[0] = '\0';
+    
+#define utl_log_kv_val(ty) (stars == 0 ? snprintf(val, sizeof(val), fmt, va_arg(args, ty)) : \
+                            stars == 1 ? snprintf(val, sizeof(val), fmt, w, va_arg(args, ty)) : \
+                                         snprintf(val, sizeof(val), fmt, w, p, va_arg(args, ty)))
+    switch (cls) {
+      case UTL_ARG_NONE  : snprintf(val, sizeof(val), "%s", fmt); break;
+      case UTL_ARG_INT   : utl_log_kv_val(int);         break;
+      case UTL_ARG_LONG  : utl_log_kv_val(long);        break;
+      case UTL_ARG_LLONG : utl_log_kv_val(long long);   break;
+      case UTL_ARG_SIZE  : utl_log_kv_val(size_t);      break;
+      case UTL_ARG_IMAX  : utl_log_kv_val(intmax_t);    break;
+      case UTL_ARG_PDIFF : utl_log_kv_val(ptrdiff_t);   break;
+      case UTL_ARG_DBL   : utl_log_kv_val(double);      break;
+      case UTL_ARG_LDBL  : utl_log_kv_val(long double); break;
+      case UTL_ARG_STR   : utl_log_kv_val(char *);      break;
+      case UTL_ARG_WSTR  : utl_log_kv_val(wchar_t *);   break;
+      case UTL_ARG_WCHR  : utl_log_kv_val(wint_t);      break;
+      case UTL_ARG_PTR   : utl_log_kv_val(void *);      break;
+      case UTL_ARG_CNT   : (void)va_arg(args, void *);  break;
+    }
+#undef utl_log_kv_val
+    
+    if (json) {
+      m = utl_log_kv_put(pair, 0, ",", 1);
+      m = utl_log_kv_esc(pair, m, key, 1);
+      m = utl_log_kv_put(pair, m, ":", 1);
+      m = utl_log_kv_esc(pair, m, val, !utl_log_kv_number(val, end ? end[-1] : 0));
+    }
+    else {
+      m = utl_log_kv_put(pair, 0, " ", 1);
+      m = utl_log_kv_esc(pair, m, key, 0);
+      m = utl_log_kv_put(pair, m, "=", 1);
+      m = utl_log_kv_esc(pair, m, val, utl_log_kv_quote(val));
+    }
+    /* This pair and all the following ones are dropped if it doesn't fit */
+    if (m < 0 || utl_log_kv_put(line, n, pair, m) < 0) break;
+    n += m;
+  }
+  va_end(args);
+  
+  if (json) line[n++] = '}';
+  line[n] = '\0';
+  utl_log_write(lg, lv, 1, "%s", line);
+}
+                 
+#endif  /*- UTL_LIB */
+
+#else   /*- UTL_NOLOGGING */
+
+#define logLevel(lg,lv)       log_W
+#define logLevelEnv(lg,v,l)   log_W     
+#define logDebug(lg, ...)     ((void)0)
+#define logInfo(lg, ...)      ((void)0)
+#define logMessage(lg, ...)   ((void)0)
+#define logWarn(lg, ...)      ((void)0)
+#define logError(lg, ...)     ((void)0)
+#define logCritical(lg, ...)  ((void)0)
+#define logAlarm(lg, ...)     ((void)0)
+#define logFatal(lg, ...)     ((void)0)
+
+#define logDContinue(lg, ...) ((void)0)
+#define logIContinue(lg, ...) ((void)0)
+#define logMContinue(lg, ...) ((void)0)
+#define logWContinue(lg, ...) ((void)0)
+#define logEContinue(lg, ...) ((void)0)
+#define logCContinue(lg, ...) ((void)0)
+#define logAContinue(lg, ...) ((void)0)
+#define logFContinue(lg, ...) ((void)0)
+
+#define logAssert(lg,e)       ((void)0)
+
+#define logEvery(lg,n,lv,...)    ((void)0)
+#define logEveryMs(lg,ms,lv,...) ((void)0)
+#define logSample(lg,p,lv,...)   ((void)0)
+
+#define logKV(lg,lv,...)         ((void)0)
+#define logKVFormat(l,f)         ((void)0)
+
+#define logIf(lg,lv) if (!utlZero) (void)0 ; else
+
+#define logOpen(f,m)    NULL
+#define logOpenRing(f,s) NULL
+#define logGet(n)        NULL
+#define logConfig(n,l)   log_W
+#define logConfigEnv(v,d) 0
+#define logSink(n,l)     0
+#define logClose(lg)    NULL
+#define logAsync(lg,n,p) 0
+#define logDecode(i,o)   0
+#define logRotate(lg,s,t,n) 0
+#define logPre(l,s)      ((void)0)
+#define logTimestamp(l,m) ((void)0)
+
+typedef void *utlLogger;
+
+#define logFile(x) NULL
+#define logStdout  NULL
+#define logStderr  NULL
+
+#endif /*- UTL_NOLOGGING */
+
+#ifdef NDEBUG
+#undef logDebug
+#define logDebug(lg,...) ((void)0)
+#endif  /*- NDEBUG */
+
+#define logNDebug(lg,...) ((void)0)
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+/*  .% Traced memory
+**  ================
+**
+**   If '{=UTL_MEMCHECK} is defined, '|malloc()|, '|free()| and the other
+** memory functions are replaced by versions that check the blocks for
+** overflows and invalid frees and log every operation on '{utlMemLog}.
+**
+**   '{=utlMallocAligned(n,a)} allocates '|n| bytes aligned to '|a| bytes
+** (a power of 2, e.g. 32 or 64 for SIMD loads) whether '|UTL_MEMCHECK| is
+** defined or not. The block must be freed with '{=utlFreeAligned(p)}; with
+** '|UTL_MEMCHECK| it is checked and accounted like any other block.
+**
+**   The allocations are also accounted by allocation site (the source file
+** and line where '|malloc()| and the others have been called): for each
+** site the live bytes and blocks, the peak of live bytes, and the number
+** of allocations are kept in a table of '{=UTL_MEM_SITES} entries (sites
+** that don't fit are accounted together under '|(other)|).
+**
+**   '{=utlMemReport(f,n)} writes the '|n| sites with the most live bytes
+** to the file '|f| (all of them if '|n| is 0):
+** .v
+**     #     live   blocks       peak     allocs  site
+**         204800       50     409600        200  parser.c:112
+**           4096        1       4096          1  main.c:40
+** ..
+**   '{=utlMemReportAtExit(n)} does the same on '|stderr| when the program
+** exits. It's a quick way to find which module is growing memory without
+** using a (much slower) memory profiler.
+**
+**   After '{=utlMemTrack(1)}, all the blocks allocated are kept in a list
+** (with a sequence number to tell the order of allocation) so that:
+**   .- '{=utlMemLeaks(f)} can write to the file '|f| the blocks that have
+**      not been freed yet, grouped by allocation site. This is also done
+**      on '|stderr| when the program exits, if there are leaks:
+**      .v
+**        # 2 blocks (300 bytes) not freed, allocated at parser.c:112
+**        #   #1041 [200] 0x8e4f30
+**        #   #1187 [100] 0x8e5a10
+**      ..
+**    - '{=utlMemCheckAll()} can check the guards of all the blocks, to catch
+**      a buffer overflow close to where it happened rather than when the
+**      block is freed. It returns the number of corrupted blocks.
+**    - '{=utlMemSweep(n)} makes '|utlMemCheckAll()| automatically run
+**      every '|n| memory operations (0 to stop).
+**   ..
+**   Only the blocks allocated while tracking is on are listed.
+**
+**   All these checks have a cost. To leave them on in production, use
+** '{=utlMemSample(n)} so that only one allocation out of '|n| (chosen at
+** random) gets the guards, the site accounting and the logging. The other
+** blocks are allocated with a small header that only marks them as not
+** checked (and stores their size, so that '{utlMemAllocated} is still
+** correct). The default is '|utlMemSample(1)|: every block is checked.
+**
+**   A write through a dangling pointer goes unnoticed if the block has
+** already been given back to the system. '{=utlMemQuarantine(n)} keeps up
+** to '|n| bytes of freed blocks aside (in FIFO order) instead of releasing
+** them. Their content is filled with a poison pattern which is checked
+** when they leave the quarantine (or on '|utlMemCheckAll()|); a block that
+** has been modified is reported as a use after free, with the site where
+** it was allocated and the one where it was freed. Freeing a block that is
+** in the quarantine is reported as a double free with the same details.
+** '|utlMemQuarantine(0)| checks and releases all the blocks in quarantine.
+**
+**   '{=utlMemStats(st)} fills the '|utl_mem_stats_t| structure pointed by
+** '|st| with the bytes currently allocated (the same as '{utlMemAllocated}),
+** their peak, the cumulative bytes allocated and the number of
+** allocations and deallocations. These counters are kept per thread and
+** merged when read, so they can be left on (possibly with sampling, see
+** above) in multithreaded programs and exported as metrics. With
+** '|UTL_THREADS|, the peak is only updated every '|UTL_MEM_BATCH| bytes
+** allocated or freed by a thread, and may be underestimated by that amount.
+** The allocation sites, the list of blocks and the quarantine are shared
+** and protected by a lock.
+**
+**   Logging each operation as text (at the '|Info| level) is slow and the
+** result is hard to analyze. '{=utlMemTrace(fname)} writes instead a
+** compact binary record (operation, pointer, size, allocation site,
+** timestamp and thread) for each allocation and free into per-thread
+** buffers that are written to the file '|fname| when full. The trace is
+** closed (and the buffers of all the threads flushed) with
+** '|utlMemTrace(NULL)| or when the program exits; do it when the other
+** threads are not allocating. The '|memtrace| tool reconstructs the heap
+** timeline, the composition of the heap at its peak and the churn of
+** each site. Only blocks that are checked (see '|utlMemSample()|) are traced.
+**
+**   The '|END_CHK| guard only tells that a block has been overflown when
+** it is checked. On Unix systems, selected blocks can be placed at the end
+** of their own '|mmap()|ed pages, followed by a page that can't be accessed,
+** so that the program faults on the very instruction that overflows them.
+** Since each of these blocks takes at least two pages, they are selected
+** with the environment variable '|UTL_MEMGUARD| (or with '{=utlMemGuard(s)},
+** which overrides it), a comma separated list of:
+**   .- '|file| or '|file:line| to guard the blocks allocated in a source
+**      file (or at a specific line), like '|UTL_MEMGUARD=parser.c:112|;
+**    - '|n|, '|n-m| or '|n-| to guard the blocks whose size is exactly '|n|,
+**      between '|n| and '|m|, or at least '|n| bytes.
+**   ..
+**   Guarded blocks are aligned to '|UTL_MEM_GUARD_ALIGN| bytes (by default
+** the size of a pointer); an overflow within the alignment padding is only
+** caught by the usual checks. They are unmapped when freed, so that a use
+** after free faults as well.
+*/
+
+#ifndef UTL_MEM_SITES
+#define UTL_MEM_SITES 1024
+#endif
+
+typedef struct {
+  size_t current;   /* bytes currently allocated */
+  size_t peak;      /* maximum of current */
+  size_t total;     /* cumulative bytes allocated */
+  size_t allocs;    /* number of allocations */
+  size_t frees;     /* number of deallocations */
+} utl_mem_stats_t;
+
+/* Records of the binary trace written by utlMemTrace(). A site record
+** ('S') is followed by the name of the source file. Each thread writes its
+** records in batches, so they must be sorted by their sequence number
+** 'seq' (global, taken under the memcheck lock) to be replayed. The time
+** is from the monotonic clock and is only used to show the timeline.
+*/
+#define UTL_MEM_TRACE_SIG  "\x7Futlmtr"
+#define UTL_MEM_OP_ALLOC   'A'
+#define UTL_MEM_OP_FREE    'F'
+#define UTL_MEM_OP_SITE    'S'
+
+typedef struct {
+  uint8_t  op;
+  uint8_t  pad;
+  uint16_t thread;
+  uint32_t site;
+  uint64_t ptr;
+  uint64_t size;    /* line number for 'S' records */
+  uint64_t time;    /* microseconds; file name length for 'S' records */
+  uint64_t seq;
+} utl_mem_rec_t;
+
+#define utlMemInvalid    -2
+#define utlMemOverflow   -1
+#define utlMemValid       0
+#define utlMemNull        1
+
+#ifdef UTL_MEMCHECK
+void *utl_malloc  (size_t size, char *file, int line );
+void *utl_malloc_aligned(size_t size, size_t align, char *file, int line);
+void *utl_calloc  (size_t num, size_t size, char *file, int line);
+void *utl_realloc (void *ptr, size_t size, char *file, int line);
+void  utl_free    (void *ptr, char *file, int line );
+void *utl_strdup  (void *ptr, char *file, int line);
+
+int utl_check(void *ptr,char *file, int line);
+
+void utl_mem_report(FILE *f, int n);
+void utl_mem_report_atexit(int n);
+void utl_mem_track(int on);
+int  utl_mem_leaks(FILE *f);
+int  utl_check_all(char *file, int line);
+void utl_mem_sweep(unsigned long n);
+void utl_mem_sample(unsigned long n);
+void utl_mem_stats(utl_mem_stats_t *st);
+int  utl_mem_trace_open(char *fname);
+size_t utl_mem_current(void);
+int  utl_mem_quarantine(size_t n, char *file, int line);
+int  utl_mem_guard(char *spec);
+void *utl_mem_account(char *file, int line, size_t size);
+void  utl_mem_unaccount(void *site, size_t size);
+
+utl_extern(utlLogger utlMemLog , = &utl_log_stderr);
+
+#ifdef UTL_LIB
+/*************************************/
+
+static char *BEG_CHK = "\xBE\xEF\xF0\x0D";
+static char *END_CHK = "\xDE\xAD\xC0\xDA";
+static char *CLR_CHK = "\xDE\xFA\xCE\xD0";
+static char *PLN_CHK = "\xB1\x0C\xF0\x0D";
+
+#define UTL_MEM_POISON 0xFD
+
+#ifndef UTL_MEM_GUARD_ALIGN
+#define UTL_MEM_GUARD_ALIGN sizeof(void *)
+#endif
+
+#ifdef UTL_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/* Memory accounting
+** Each thread updates its own counters. The bytes currently allocated are
+** merged into utl_mem_cur (and the peak updated) every UTL_MEM_BATCH bytes
+** so that the peak is exact without threads and off by at most
+** UTL_MEM_BATCH bytes per thread with them. Threads beyond UTL_MEM_THREADS
+** share the last slot.
+*/
+#ifndef UTL_MEM_THREADS
+#define UTL_MEM_THREADS 64
+#endif
+
+#ifndef UTL_MEM_BATCH
+#ifdef UTL_THREADS
+#define UTL_MEM_BATCH 65536
+#else
+#define UTL_MEM_BATCH 0
+#endif
+#endif
+
+/* Each thread only writes its own slot. The padding keeps the counters of
+** two slots at least a cache line apart, whatever the array alignment.
+*/
+typedef struct {
+  long    cur;      /* not merged yet into utl_mem_cur */
+  size_t  allocs;
+  size_t  frees;
+  size_t  bytes;    /* cumulative */
+  char    pad[UTL_CACHE_LINE];
+} utl_mem_cnt_t;
+
+static utl_mem_cnt_t utl_mem_cnt[UTL_MEM_THREADS+1];
+static int           utl_mem_cnt_n = 0;
+static long          utl_mem_cur = 0;
+static long          utl_mem_peak = 0;
+static utl_thread_local utl_mem_cnt_t *utl_mem_my = NULL;
+
+static utl_mem_cnt_t *utl_mem_slot(void)
+{
+  int k;
+  
+  if (!utl_mem_my) {
+    k = utl_atomic_add(&utl_mem_cnt_n, 1) - 1;
+    utl_mem_my = utl_mem_cnt + (k < UTL_MEM_THREADS ? k : UTL_MEM_THREADS);
+  }
+  return utl_mem_my;
+}
+
+static void utl_mem_count(size_t add, size_t del)
+{
+  utl_mem_cnt_t *c = utl_mem_slot();
+  long d, cur, peak;
+  
+  if (add) { utl_atomic_add(&c->allocs, 1); utl_atomic_add(&c->bytes, add); }
+  if (del) utl_atomic_add(&c->frees, 1);
+  d = utl_atomic_add(&c->cur, (long)add - (long)del);
+  if (d > UTL_MEM_BATCH || d < -UTL_MEM_BATCH) {
+    cur = utl_atomic_add(&utl_mem_cur, d);
+    utl_atomic_add(&c->cur, -d);
+    peak = utl_atomic_get(&utl_mem_peak);
+    while (cur > peak && !utl_atomic_cas(&utl_mem_peak, peak, cur)) ;
+  }
+}
+
+size_t utl_mem_current(void)
+{
+  long cur = utl_atomic_get(&utl_mem_cur);
+  int k;
+  
+  for (k = 0; k <= UTL_MEM_THREADS; k++) cur += utl_atomic_get(&utl_mem_cnt[k].cur);
+  return cur > 0 ? (size_t)cur : 0;
+}
+
+void utl_mem_stats(utl_mem_stats_t *st)
+{
+  size_t cur;
+  int k;
+  
+  if (!st) return;
+  memset(st, 0, sizeof(utl_mem_stats_t));
+  for (k = 0; k <= UTL_MEM_THREADS; k++) {
+    st->allocs += utl_atomic_get(&utl_mem_cnt[k].allocs);
+    st->frees  += utl_atomic_get(&utl_mem_cnt[k].frees);
+    st->total  += utl_atomic_get(&utl_mem_cnt[k].bytes);
+  }
+  cur = utl_mem_current();
+  st->current = cur;
+  st->peak = utl_atomic_get(&utl_mem_peak);
+  if (st->peak < cur) st->peak = cur;
+}
+
+/* The site table, the list of live blocks and the quarantine are shared */
+#ifdef UTL_THREADS
+static pthread_mutex_t utl_mem_mtx;
+static pthread_once_t  utl_mem_once = PTHREAD_ONCE_INIT;
+
+static void utl_mem_mtx_init(void)
+{
+  pthread_mutexattr_t a;
+  pthread_mutexattr_init(&a);
+  pthread_mutexattr_settype(&a, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&utl_mem_mtx, &a);
+  pthread_mutexattr_destroy(&a);
+}
+#define utl_mem_lock()   (pthread_once(&utl_mem_once, utl_mem_mtx_init), \
+                          pthread_mutex_lock(&utl_mem_mtx))
+#define utl_mem_unlock() pthread_mutex_unlock(&utl_mem_mtx)
+#else
+#define utl_mem_lock()   ((void)0)
+#define utl_mem_unlock() ((void)0)
+#endif
+
+typedef struct {
+  char   *file;
+  int     line;
+  size_t  live;     /* bytes currently allocated */
+  size_t  blocks;   /* blocks currently allocated */
+  size_t  peak;     /* maximum of live */
+  size_t  allocs;   /* number of allocations */
+  unsigned guard_gen; /* utl_mem_guard_gen when guard was computed */
+  unsigned trace_gen; /* utl_mem_trace_gen when written to the trace */
+  int      guard;   /* blocks allocated here are page guarded */
+} utl_mem_site_t;
+
+/* The header of each block is followed by the BEG_CHK guard and the data.
+** The header size is rounded so that data has the same alignment that
+** malloc() would guarantee.
+*/
+typedef struct utl_mem_s {
+  struct utl_mem_s *next;   /* list of live blocks (if tracked) */
+  struct utl_mem_s *prev;
+  utl_mem_site_t   *site;
+  utl_mem_site_t   *fsite;  /* where it was freed (if in quarantine) */
+  size_t            size;
+  size_t            mapped; /* length of the mapping for guarded blocks */
+  size_t            align;  /* requested alignment (0 for malloc()'s one) */
+  size_t            shift;  /* offset from the start of the malloc()ed area */
+  unsigned long     seq;
+} utl_mem_t;
+
+#define UTL_MEM_HDR    ((sizeof(utl_mem_t) + 4 + 15) & ~(size_t)15)
+#define utl_mem(x)     ((utl_mem_t *)((char *)(x) - UTL_MEM_HDR))
+#define utl_mem_data(p) ((char *)(p) + UTL_MEM_HDR)
+#define utl_mem_chk(p)  (utl_mem_data(p) - 4)
+
+/* Allocation sites are kept in an open addressing table. Entries are never
+** removed so that blocks can keep a pointer to their site.
+*/
+static utl_mem_site_t utl_mem_sites[UTL_MEM_SITES+1];
+
+static utl_mem_site_t *utl_mem_site(char *file, int line)
+{
+  utl_mem_site_t *s;
+  size_t h, k;
+  
+  h = ((size_t)(uintptr_t)file >> 3) * 31 + (size_t)line;
+  h ^= h >> 15;  h *= 0x2C1B3C6DU;  h ^= h >> 12;
+  for (k = 0; k < UTL_MEM_SITES; k++) {
+    s = utl_mem_sites + ((h + k) % UTL_MEM_SITES);
+    if (s->file == file && s->line == line) return s;
+    if (s->file == NULL) {
+      s->file = file;
+      s->line = line;
+      return s;
+    }
+  }
+  s = utl_mem_sites + UTL_MEM_SITES;   /* Table full */
+  s->file = "(other)";
+  return s;
+}
+
+static void utl_mem_site_add(utl_mem_site_t *s, size_t size)
+{
+  s->live += size;
+  s->blocks++;
+  s->allocs++;
+  if (s->live > s->peak) s->peak = s->live;
+}
+
+static void utl_mem_site_del(utl_mem_site_t *s, size_t size)
+{
+  s->live -= size;
+  s->blocks--;
+}
+
+/* For memory that is not allocated by utl_malloc() (e.g. arenas) */
+void *utl_mem_account(char *file, int line, size_t size)
+{
+  utl_mem_site_t *s;
+  
+  utl_mem_lock();
+  s = utl_mem_site(file, line);
+  utl_mem_site_add(s, size);
+  utl_mem_unlock();
+  return s;
+}
+
+void utl_mem_unaccount(void *site, size_t size)
+{
+  utl_mem_lock();
+  utl_mem_site_del((utl_mem_site_t *)site, size);
+  utl_mem_unlock();
+}
+
+static int utl_mem_site_cmp(const void *a, const void *b)
+{
+  size_t x = (*(utl_mem_site_t **)a)->live;
+  size_t y = (*(utl_mem_site_t **)b)->live;
+  return (x < y) - (x > y);
+}
+
+void utl_mem_report(FILE *f, int n)
+{
+  utl_mem_site_t *top[UTL_MEM_SITES+1];
+  int k, cnt = 0;
+  
+  if (!f) return;
+  utl_mem_lock();
+  for (k = 0; k <= UTL_MEM_SITES; k++)
+    if (utl_mem_sites[k].file && utl_mem_sites[k].allocs > 0) top[cnt++] = utl_mem_sites + k;
+  qsort(top, cnt, sizeof(utl_mem_site_t *), utl_mem_site_cmp);
+  if (n <= 0 || n > cnt) n = cnt;
+  
+  fprintf(f, "#     live   blocks       peak     allocs  site\n");
+  for (k = 0; k < n; k++)
+    fprintf(f, "%10lu %8lu %10lu %10lu  %s:%d\n", (unsigned long)top[k]->live,
+               (unsigned long)top[k]->blocks, (unsigned long)top[k]->peak,
+               (unsigned long)top[k]->allocs, top[k]->file, top[k]->line);
+  utl_mem_unlock();
+  fflush(f);
+}
+
+static int utl_mem_report_n = 0;
+
+/* Blocks that are not sampled only have the size and the PLN_CHK tag */
+#define UTL_MEM_PLAIN 16
+#define utl_mem_plain(x) (memcmp((char *)(x) - 4, PLN_CHK, 4) == 0)
+
+static unsigned long utl_mem_sample_n = 1;
+static utl_thread_local uint32_t utl_mem_rnd = 0;
+
+static int utl_mem_sampled(void)
+{
+  uint32_t x = utl_mem_rnd;
+  
+  if (utl_mem_sample_n <= 1) return 1;
+  if (x == 0) x = (uint32_t)utl_clock(1) ^ (uint32_t)(uintptr_t)&utl_mem_rnd;
+  if (x == 0) x = 1;
+  x ^= x << 13;  x ^= x >> 17;  x ^= x << 5;
+  utl_mem_rnd = x;
+  return (x % utl_mem_sample_n) == 0;
+}
+
+void utl_mem_sample(unsigned long n)
+{
+  utl_mem_sample_n = n;
+}
+
+static void *utl_mem_plain_alloc(void *old, size_t size)
+{
+  char *p = old ? (char *)old - UTL_MEM_PLAIN : NULL;
+  
+  size_t old_size = old ? *(size_t *)p : 0;
+  
+  p = realloc(p, UTL_MEM_PLAIN + size);
+  if (!p) return NULL;
+  *(size_t *)p = size;
+  memcpy(p + UTL_MEM_PLAIN - 4, PLN_CHK, 4);
+  utl_mem_count(size, old_size);
+  return p + UTL_MEM_PLAIN;
+}
+
+static void utl_mem_plain_free(void *ptr)
+{
+  char *p = (char *)ptr - UTL_MEM_PLAIN;
+  
+  utl_mem_count(0, *(size_t *)p);
+  memcpy(p + UTL_MEM_PLAIN - 4, CLR_CHK, 4);
+  free(p);
+}
+
+/* Guarded blocks end where the inaccessible page begins. The bytes used
+** to align them are filled with the END_CHK guard.
+*/
+#define UTL_MEM_GUARDS 32
+
+static struct {
+  char   *file;     /* NULL for a size range */
+  int     line;     /* 0 for any line */
+  size_t  lo, hi;
+} utl_mem_guards[UTL_MEM_GUARDS];
+
+static int       utl_mem_guard_n = -1;   /* -1: UTL_MEMGUARD not read yet */
+static unsigned  utl_mem_guard_gen = 1;
+static char     *utl_mem_guard_spec = NULL;
+
+#define utl_mem_galign(a) ((a) > UTL_MEM_GUARD_ALIGN ? (a) : UTL_MEM_GUARD_ALIGN)
+#define utl_mem_slack(p) \
+  ((p)->mapped ? ((0 - (p)->size) & (utl_mem_galign((p)->align) - 1)) : 4)
+#define utl_mem_raw(p)   ((char *)(p) - (p)->shift)
+
+static int utl_mem_end_ok(utl_mem_t *p)
+{
+  char *e = utl_mem_data(p) + p->size;
+  size_t k, n = utl_mem_slack(p);
+  
+  for (k = 0; k < n; k++)
+    if (e[k] != END_CHK[k & 3]) return 0;
+  return 1;
+}
+
+static void utl_mem_end_set(utl_mem_t *p)
+{
+  char *e = utl_mem_data(p) + p->size;
+  size_t k, n = utl_mem_slack(p);
+  
+  for (k = 0; k < n; k++) e[k] = END_CHK[k & 3];
+}
+
+static int utl_mem_guard_set(char *spec)
+{
+  char *s, *t, *e;
+  int n = 0;
+  
+  free(utl_mem_guard_spec);
+  utl_mem_guard_spec = NULL;
+  utl_mem_guard_gen++;
+  utl_mem_guard_n = 0;
+  if (!spec || !*spec) return 0;
+#ifndef UTL_UNIX
+  logWarn(utlMemLog, "Page guarded blocks are not supported (UTL_MEMGUARD=%s)", spec);
+  return 0;
+#else
+  if (!(s = malloc(strlen(spec)+1))) return 0;
+  utl_mem_guard_spec = strcpy(s, spec);
+  
+  while (*s && n < UTL_MEM_GUARDS) {
+    while (*s == ',' || isspace((int)*s)) s++;
+    if (!*s) break;
+    for (t = s; *s && *s != ',' && !isspace((int)*s); s++) ;
+    if (*s) *s++ = '\0';
+    
+    utl_mem_guards[n].file = NULL;
+    utl_mem_guards[n].line = 0;
+    if (isdigit((int)*t)) {
+      utl_mem_guards[n].lo = utl_mem_guards[n].hi = strtoul(t, &e, 10);
+      if (*e == '-') utl_mem_guards[n].hi = e[1] ? strtoul(e+1, NULL, 10) : (size_t)-1;
+    }
+    else {
+      e = strrchr(t, ':');
+      if (e && isdigit((int)e[1])) { *e = '\0'; utl_mem_guards[n].line = atoi(e+1); }
+      utl_mem_guards[n].file = t;
+    }
+    n++;
+  }
+  return (utl_mem_guard_n = n);
+#endif
+}
+
+int utl_mem_guard(char *spec)
+{
+  int n;
+  
+  utl_mem_lock();
+  n = utl_mem_guard_set(spec);
+  utl_mem_unlock();
+  return n;
+}
+
+/* A site file matches if it ends with the file in the spec */
+static int utl_mem_guard_site(utl_mem_site_t *s)
+{
+  size_t ls, lg;
+  char *g;
+  int k;
+  
+  ls = strlen(s->file);
+  for (k = 0; k < utl_mem_guard_n; k++) {
+    if (!(g = utl_mem_guards[k].file)) continue;
+    if (utl_mem_guards[k].line && utl_mem_guards[k].line != s->line) continue;
+    lg = strlen(g);
+    if (lg <= ls && strcmp(s->file + ls - lg, g) == 0 &&
+        (lg == ls || s->file[ls-lg-1] == '/' || s->file[ls-lg-1] == '\\'))
+      return 1;
+  }
+  return 0;
+}
+
+static int utl_mem_guarded(utl_mem_site_t *s, size_t size)
+{
+  int k;
+  
+  if (utl_mem_guard_n < 0) utl_mem_guard_set(getenv("UTL_MEMGUARD"));
+  if (utl_mem_guard_n == 0) return 0;
+  if (s->guard_gen != utl_mem_guard_gen) {
+    s->guard_gen = utl_mem_guard_gen;
+    s->guard = utl_mem_guard_site(s);
+  }
+  if (s->guard) return 1;
+  for (k = 0; k < utl_mem_guard_n; k++)
+    if (!utl_mem_guards[k].file && utl_mem_guards[k].lo <= size && size <= utl_mem_guards[k].hi)
+      return 1;
+  return 0;
+}
+
+#ifdef UTL_UNIX
+static size_t utl_mem_page(void)
+{
+  static size_t pg = 0;
+  if (pg == 0) pg = (size_t)sysconf(_SC_PAGESIZE);
+  return pg;
+}
+
+static utl_mem_t *utl_mem_map(size_t size, size_t align)
+{
+  size_t pg = utl_mem_page();
+  size_t sz = (size + utl_mem_galign(align) - 1) & ~(size_t)(utl_mem_galign(align) - 1);
+  size_t len = ((UTL_MEM_HDR + sz + pg - 1) / pg + 1) * pg;
+  char *base;
+  utl_mem_t *p;
+  
+  base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED) return NULL;
+  if (mprotect(base + len - pg, pg, PROT_NONE) != 0) {
+    munmap(base, len);
+    return NULL;
+  }
+  p = (utl_mem_t *)(base + len - pg - sz - UTL_MEM_HDR);
+  p->mapped = len;
+  return p;
+}
+
+static void utl_mem_unmap(utl_mem_t *p)
+{
+  char *base = (char *)p - ((uintptr_t)p % utl_mem_page());
+  munmap(base, p->mapped);
+}
+#else
+#define utl_mem_map(size,align) NULL
+#define utl_mem_unmap(p)  ((void)0)
+#endif
+
+/* Allocate a new block (header included) for the site s. If an alignment
+** is requested, the header is placed so that the data are aligned.
+*/
+static utl_mem_t *utl_mem_new(size_t size, size_t align, utl_mem_site_t *s)
+{
+  utl_mem_t *p = NULL;
+  char *raw;
+  
+  if (utl_mem_guarded(s, size)) {
+    p = utl_mem_map(size, align);
+    if (!p) logWarn(utlMemLog, "Unable to map a guarded block [%d] (%s:%d)", size, s->file, s->line);
+  }
+  if (!p) {
+    if (align <= 16) align = 0;
+    raw = malloc(UTL_MEM_HDR + size + 4 + (align ? align - 1 : 0));
+    if (!raw) return NULL;
+    p = (utl_mem_t *)raw;
+    if (align)
+      p = (utl_mem_t *)((((uintptr_t)raw + UTL_MEM_HDR + align - 1) & ~(uintptr_t)(align - 1))
+                         - UTL_MEM_HDR);
+    p->mapped = 0;
+    p->shift = (char *)p - raw;
+  }
+  p->align = align;
+  return p;
+}
+
+/* Live blocks are linked in a circular list while tracking is on */
+static utl_mem_t     utl_mem_live = {&utl_mem_live, &utl_mem_live, NULL, NULL, 0, 0, 0, 0, 0};
+static int           utl_mem_tracking = 0;
+static unsigned long utl_mem_seq = 0;
+static unsigned long utl_mem_sweep_n = 0;
+static unsigned long utl_mem_ops = 0;
+
+static void utl_mem_relink(utl_mem_t *p)
+{
+  p->next = &utl_mem_live;
+  p->prev = utl_mem_live.prev;
+  p->prev->next = p;
+  utl_mem_live.prev = p;
+}
+
+static void utl_mem_link(utl_mem_t *p)
+{
+  p->seq = ++utl_mem_seq;
+  p->next = p->prev = NULL;
+  if (utl_mem_tracking > 0) utl_mem_relink(p);
+}
+
+static void utl_mem_unlink(utl_mem_t *p)
+{
+  if (!p->next) return;
+  p->prev->next = p->next;
+  p->next->prev = p->prev;
+  p->next = p->prev = NULL;
+}
+
+/* Freed blocks in quarantine are kept in a separate FIFO list */
+static utl_mem_t utl_mem_quar = {&utl_mem_quar, &utl_mem_quar, NULL, NULL, 0, 0, 0, 0, 0};
+static size_t    utl_mem_quar_bytes = 0;
+static size_t    utl_mem_quar_max = 0;
+
+static int utl_mem_quar_bad(utl_mem_t *p, char *file, int line)
+{
+  unsigned char *d = (unsigned char *)utl_mem_data(p);
+  size_t k;
+  
+  for (k = 0; k < p->size; k++)
+    if (d[k] != UTL_MEM_POISON) break;
+  
+  if (k < p->size || memcmp(utl_mem_chk(p),CLR_CHK,4) || memcmp(d+p->size,END_CHK,4)) {
+    logError(utlMemLog,"Use after free %p [%d] #%lu (offset %lu) allocated at %s:%d freed at %s:%d (%u %s %d)",
+                       d, p->size, p->seq, (unsigned long)k, p->site->file, p->site->line,
+                       p->fsite->file, p->fsite->line, utl_mem_current(), file, line);
+    /* Report it only once */
+    memset(d, UTL_MEM_POISON, p->size);
+    memcpy(utl_mem_chk(p),CLR_CHK,4);
+    memcpy(d+p->size,END_CHK,4);
+    return 1;
+  }
+  return 0;
+}
+
+static int utl_mem_quar_evict(size_t max, char *file, int line)
+{
+  utl_mem_t *p;
+  int bad = 0;
+  
+  while (utl_mem_quar_bytes > max || (max == 0 && utl_mem_quar.next != &utl_mem_quar)) {
+    p = utl_mem_quar.next;
+    bad += utl_mem_quar_bad(p, file, line);
+    p->prev->next = p->next;
+    p->next->prev = p->prev;
+    utl_mem_quar_bytes -= p->size;
+    free(utl_mem_raw(p));
+  }
+  return bad;
+}
+
+static void utl_mem_release(utl_mem_t *p, char *file, int line)
+{
+  if (p->mapped) { utl_mem_unmap(p); return; }
+  if (utl_mem_quar_max == 0) { free(utl_mem_raw(p)); return; }
+  
+  p->fsite = utl_mem_site(file, line);
+  memset(utl_mem_data(p), UTL_MEM_POISON, p->size);
+  p->next = &utl_mem_quar;
+  p->prev = utl_mem_quar.prev;
+  p->prev->next = p;
+  utl_mem_quar.prev = p;
+  utl_mem_quar_bytes += p->size;
+  utl_mem_quar_evict(utl_mem_quar_max, file, line);
+}
+
+static utl_mem_t *utl_mem_quarantined(void *ptr)
+{
+  utl_mem_t *p;
+  
+  for (p = utl_mem_quar.next; p != &utl_mem_quar; p = p->next)
+    if (utl_mem_data(p) == (char *)ptr) return p;
+  return NULL;
+}
+
+int utl_mem_quarantine(size_t n, char *file, int line)
+{
+  int bad;
+  
+  utl_mem_lock();
+  utl_mem_quar_max = n;
+  bad = utl_mem_quar_evict(n, file, line);
+  utl_mem_unlock();
+  return bad;
+}
+
+int utl_check_all(char *file, int line)
+{
+  utl_mem_t *p;
+  int bad = 0;
+  
+  utl_mem_lock();
+  for (p = utl_mem_quar.next; p != &utl_mem_quar; p = p->next)
+    bad += utl_mem_quar_bad(p, file, line);
+  
+  for (p = utl_mem_live.next; p != &utl_mem_live; p = p->next) {
+    if (memcmp(utl_mem_chk(p),BEG_CHK,4) || !utl_mem_end_ok(p)) {
+      logError(utlMemLog,"Corrupted block %p [%d] #%lu allocated at %s:%d (%u %s %d)",
+                         utl_mem_data(p), p->size, p->seq, p->site->file, p->site->line,
+                         utl_mem_current(), file, line);
+      bad++;
+    }
+  }
+  utl_mem_unlock();
+  return bad;
+}
+
+#define utl_mem_swept(file,line) \
+  (utl_mem_sweep_n > 0 && ++utl_mem_ops >= utl_mem_sweep_n \
+          ? (utl_mem_ops = 0, utl_check_all(file,line)) : 0)
+
+void utl_mem_sweep(unsigned long n)
+{
+  utl_mem_sweep_n = n;
+  utl_mem_ops = 0;
+}
+
+static int utl_mem_leak_cmp(const void *a, const void *b)
+{
+  utl_mem_t *x = *(utl_mem_t **)a;
+  utl_mem_t *y = *(utl_mem_t **)b;
+  if (x->site != y->site) return (x->site < y->site) ? -1 : 1;
+  return (x->seq > y->seq) - (x->seq < y->seq);
+}
+
+int utl_mem_leaks(FILE *f)
+{
+  utl_mem_t **blks, *p;
+  size_t bytes;
+  int n = 0, k, j;
+  
+  utl_mem_lock();
+  for (p = utl_mem_live.next; p != &utl_mem_live; p = p->next) n++;
+  blks = (n > 0 && f) ? malloc(n * sizeof(utl_mem_t *)) : NULL;
+  if (!blks) { utl_mem_unlock(); return n; }
+  for (k = 0, p = utl_mem_live.next; k < n; k++, p = p->next) blks[k] = p;
+  qsort(blks, n, sizeof(utl_mem_t *), utl_mem_leak_cmp);
+  
+  for (k = 0; k < n; k = j) {
+    bytes = 0;
+    for (j = k; j < n && blks[j]->site == blks[k]->site; j++) bytes += blks[j]->size;
+    fprintf(f, "# %d block%s (%lu bytes) not freed, allocated at %s:%d\n", j-k,
+               (j-k > 1) ? "s" : "", (unsigned long)bytes, blks[k]->site->file, blks[k]->site->line);
+    for (; k < j; k++)
+      fprintf(f, "#   #%lu [%lu] %p\n", blks[k]->seq, (unsigned long)blks[k]->size,
+                                        (void *)utl_mem_data(blks[k]));
+  }
+  utl_mem_unlock();
+  fflush(f);
+  free(blks);
+  return n;
+}
+
+static void utl_mem_leaks_exit(void)
+{
+  utl_mem_leaks(stderr);
+}
+
+void utl_mem_track(int on)
+{
+  if (on && utl_mem_tracking == 0) atexit(utl_mem_leaks_exit);
+  utl_mem_tracking = on ? 1 : -1;
+}
+
+static void utl_mem_report_exit(void)
+{
+  utl_mem_report(stderr, utl_mem_report_n);
+}
+
+void utl_mem_report_atexit(int n)
+{
+  if (utl_mem_report_n == 0) atexit(utl_mem_report_exit);
+  utl_mem_report_n = (n > 0) ? n : -1;
+}
+
+/* Binary trace. Records are collected in per-thread buffers that are
+** written to the file when full or when the trace is closed. Buffers are
+** never freed since a thread keeps a pointer to its own.
+*/
+#ifndef UTL_MEM_TRACE_RECS
+#define UTL_MEM_TRACE_RECS 1024
+#endif
+
+typedef struct utl_mem_tbuf_s {
+  struct utl_mem_tbuf_s *next;
+  int                    n;
+  utl_mem_rec_t          rec[UTL_MEM_TRACE_RECS];
+} utl_mem_tbuf_t;
+
+static FILE           *utl_mem_trace_f = NULL;
+static unsigned        utl_mem_trace_gen = 0;
+static uint64_t        utl_mem_trace_seq = 0;
+static utl_mem_tbuf_t *utl_mem_tbufs = NULL;
+static utl_thread_local utl_mem_tbuf_t *utl_mem_tbuf = NULL;
+
+static void utl_mem_trace_flush(utl_mem_tbuf_t *b)
+{
+  if (b->n > 0) fwrite(b->rec, sizeof(utl_mem_rec_t), b->n, utl_mem_trace_f);
+  b->n = 0;
+}
+
+/* Must be called with the memcheck lock held */
+static void utl_mem_trace(int op, void *ptr, size_t size, utl_mem_site_t *s)
+{
+  utl_mem_tbuf_t *b = utl_mem_tbuf;
+  utl_mem_rec_t *r;
+  
+  if (!utl_mem_trace_f) return;
+  if (!b) {
+    if (!(b = malloc(sizeof(utl_mem_tbuf_t)))) return;
+    b->n = 0;
+    b->next = utl_mem_tbufs;
+    utl_mem_tbufs = utl_mem_tbuf = b;
+  }
+  if (s->trace_gen != utl_mem_trace_gen) {
+    s->trace_gen = utl_mem_trace_gen;
+    utl_mem_trace_flush(b);
+    r = b->rec;
+    memset(r, 0, sizeof(utl_mem_rec_t));
+    r->op   = UTL_MEM_OP_SITE;
+    r->site = (uint32_t)(s - utl_mem_sites);
+    r->size = s->line;
+    r->time = strlen(s->file);
+    fwrite(r, sizeof(utl_mem_rec_t), 1, utl_mem_trace_f);
+    fwrite(s->file, 1, (size_t)r->time, utl_mem_trace_f);
+  }
+  r = b->rec + b->n++;
+  r->op     = (uint8_t)op;
+  r->seq    = utl_mem_trace_seq++;
+  r->thread = (uint16_t)(utl_mem_slot() - utl_mem_cnt);
+  r->site   = (uint32_t)(s - utl_mem_sites);
+  r->ptr    = (uint64_t)(uintptr_t)ptr;
+  r->size   = size;
+  r->time   = (uint64_t)utl_elapsed();
+  if (b->n == UTL_MEM_TRACE_RECS) utl_mem_trace_flush(b);
+}
+
+static void utl_mem_trace_exit(void)
+{
+  utl_mem_trace_open(NULL);
+}
+
+int utl_mem_trace_open(char *fname)
+{
+  static int at_exit = 0;
+  utl_mem_tbuf_t *b;
+  uint32_t hdr[2] = {2, sizeof(utl_mem_rec_t)};
+  int ret = 1;
+  
+  utl_mem_lock();
+  if (utl_mem_trace_f) {
+    for (b = utl_mem_tbufs; b; b = b->next) utl_mem_trace_flush(b);
+    fclose(utl_mem_trace_f);
+    utl_mem_trace_f = NULL;
+  }
+  if (fname) {
+    utl_mem_trace_f = fopen(fname, "wb");
+    if (utl_mem_trace_f) {
+      fwrite(UTL_MEM_TRACE_SIG, 1, 8, utl_mem_trace_f);
+      fwrite(hdr, sizeof(uint32_t), 2, utl_mem_trace_f);
+      utl_mem_trace_gen++;
+      if (!at_exit) at_exit = !atexit(utl_mem_trace_exit);
+    }
+    else ret = 0;
+  }
+  utl_mem_unlock();
+  return ret;
+}
+
+int utl_check(void *ptr,char *file, int line)
+{
+  utl_mem_t *p;
+  
+  if (ptr == NULL) return utlMemNull;
+  if (utl_mem_plain(ptr)) return utlMemValid;
+  p = utl_mem(ptr);
+  if (memcmp(utl_mem_chk(p),BEG_CHK,4)) { 
+    logError(utlMemLog,"Invalid or double freed %p (%u %s %d)",ptr, \
+                                               utl_mem_current(), file, line);     
+    return utlMemInvalid; 
+  }
+  if (!utl_mem_end_ok(p)) {
+    logError(utlMemLog,"Boundary overflow detected %p [%d] (%u %s %d)", \
+                              ptr, p->size, utl_mem_current(), file, line); 
+    return utlMemOverflow;
+  }
+  logInfo(utlMemLog,"Valid pointer %p (%u %s %d)",ptr, utl_mem_current(), file, line); 
+  return utlMemValid; 
+}
+
+void *utl_malloc(size_t size, char *file, int line )
+{
+  void *ptr;
+  
+  if (!utl_mem_sampled()) {
+    ptr = utl_mem_plain_alloc(NULL, size);
+    if (!ptr) logCritical(utlMemLog,"Out of Memory (%u %s %d)",utl_mem_current(), file, line);
+    return ptr;
+  }
+  return utl_malloc_aligned(size, 0, file, line);
+}
+
+/* Aligned blocks are always checked (never sampled out) */
+void *utl_malloc_aligned(size_t size, size_t align, char *file, int line)
+{
+  utl_mem_t *p;
+  utl_mem_site_t *s;
+  
+  if (align & (align - 1)) {
+    logError(utlMemLog,"Alignment %lu is not a power of 2 (%u %s %d)", (unsigned long)align,
+                                                utl_mem_current(), file, line);
+    return NULL;
+  }
+  if (size == 0) logWarn(utlMemLog,"Shouldn't allocate 0 bytes (%u %s %d)", \
+                                                utl_mem_current(), file, line);
+  utl_mem_lock();
+  s = utl_mem_site(file, line);
+  p = utl_mem_new(size, align, s);
+  if (p == NULL) {
+    utl_mem_unlock();
+    logCritical(utlMemLog,"Out of Memory (%u %s %d)",utl_mem_current(), file, line);
+    return NULL;
+  }
+  p->size = size;
+  p->site = s;
+  utl_mem_site_add(p->site, size);
+  utl_mem_link(p);
+  utl_mem_swept(file, line);
+  memcpy(utl_mem_chk(p),BEG_CHK,4);
+  utl_mem_end_set(p);
+  utl_mem_trace(UTL_MEM_OP_ALLOC, utl_mem_data(p), size, s);
+  utl_mem_unlock();
+  utl_mem_count(size, 0);
+  logInfo(utlMemLog,"alloc %p [%d] (%u %s %d)",utl_mem_data(p),size,utl_mem_current(),file,line);
+  return utl_mem_data(p);
+}
+
+void *utl_calloc(size_t num, size_t size, char *file, int line)
+{
+  void *ptr;
+  
+  size = num * size;
+  ptr = utl_malloc(size,file,line);
+  if (ptr)  memset(ptr,0x00,size);
+  return ptr;
+};
+
+void utl_free(void *ptr, char *file, int line)
+{
+  utl_mem_t *p=NULL;
+  
+  if (ptr && utl_mem_plain(ptr)) { utl_mem_plain_free(ptr); return; }
+  
+  utl_mem_lock();
+  switch (utl_check(ptr,file,line)) {
+    case utlMemNull  :    logWarn(utlMemLog,"free NULL (%u %s %d)", 
+                                                utl_mem_current(), file, line);
+                          break;
+                          
+    case utlMemOverflow : logWarn(utlMemLog, "Freeing an overflown block  (%u %s %d)", 
+                                                           utl_mem_current(), file, line);
+    case utlMemValid :    p = utl_mem(ptr); 
+                          memcpy(utl_mem_chk(p),CLR_CHK,4);
+                          utl_mem_count(0, p->size);
+                          utl_mem_trace(UTL_MEM_OP_FREE, ptr, p->size, p->site);
+                          utl_mem_site_del(p->site, p->size);
+                          utl_mem_unlink(p);
+                          utl_mem_swept(file, line);
+                          if (p->size == 0)
+                            logWarn(utlMemLog,"Freeing a block of 0 bytes (%u %s %d)", 
+                                                utl_mem_current(), file, line);
+
+                          logInfo(utlMemLog,"free %p [%d] (%u %s %d)", ptr, 
+                                    p?p->size:0,utl_mem_current(), file, line);
+                          utl_mem_release(p, file, line);
+                          break;
+                          
+    case utlMemInvalid :  if ((p = utl_mem_quarantined(ptr)) != NULL) {
+                            logError(utlMemLog,"Double free %p [%d] #%lu allocated at %s:%d freed at %s:%d (%u %s %d)",
+                                       ptr, p->size, p->seq, p->site->file, p->site->line,
+                                       p->fsite->file, p->fsite->line, utl_mem_current(), file, line);
+                            break;
+                          }
+                          logError(utlMemLog,"free an invalid pointer! (%u %s %d)", \
+                                                utl_mem_current(), file, line);
+                          break;
+  }
+  utl_mem_unlock();
+}
+
+void *utl_realloc(void *ptr, size_t size, char *file, int line)
+{
+  utl_mem_t *p, *q;
+  utl_mem_site_t *s;
+  int tracked;
+  
+  if (size == 0) {
+    logWarn(utlMemLog,"realloc() used as free() %p -> [0] (%u %s %d)",ptr,utl_mem_current(), file, line);
+    utl_free(ptr,file,line); 
+  } 
+  else if (ptr && utl_mem_plain(ptr)) {
+    ptr = utl_mem_plain_alloc(ptr, size);
+    if (!ptr) logCritical(utlMemLog,"Out of Memory (%u %s %d)",utl_mem_current(), file, line);
+  }
+  else {
+    utl_mem_lock();
+    switch (utl_check(ptr,file,line)) {
+      case utlMemNull   : utl_mem_unlock();
+                          logWarn(utlMemLog,"realloc() used as malloc() (%u %s %d)", \
+                                             utl_mem_current(), file, line);
+                          return utl_malloc(size,file,line);
+                        
+      case utlMemValid  : p = utl_mem(ptr); 
+                          tracked = (p->next != NULL);
+                          utl_mem_unlink(p);   /* The block may move */
+                          s = utl_mem_site(file, line);
+                          if (p->mapped || p->align || utl_mem_guarded(s, size)) {
+                            q = utl_mem_new(size, p->align, s);
+                            if (q) {
+                              memcpy(utl_mem_data(q), ptr, p->size < size ? p->size : size);
+                              q->site = p->site; q->size = p->size; q->seq = p->seq;
+                              q->next = q->prev = NULL;
+                              if (p->mapped) utl_mem_unmap(p); else free(utl_mem_raw(p));
+                            }
+                          }
+                          else q = realloc(p,UTL_MEM_HDR + size + 4); 
+                          if (q == NULL) {
+                            if (tracked) utl_mem_relink(p);
+                            utl_mem_unlock();
+                            logCritical(utlMemLog,"Out of Memory (%u %s %d)", \
+                                             utl_mem_current(), file, line);
+                            return NULL;
+                          }
+                          p = q;
+                          if (tracked) utl_mem_relink(p);
+                          utl_mem_count(size, p->size);
+                          utl_mem_trace(UTL_MEM_OP_FREE, ptr, p->size, p->site);
+                          utl_mem_trace(UTL_MEM_OP_ALLOC, utl_mem_data(p), size, s);
+                          logInfo(utlMemLog,"realloc %p [%d] -> %p [%d] (%u %s %d)", \
+                                          ptr, p->size, utl_mem_data(p), size, \
+                                          utl_mem_current(), file, line);
+                          /* The block now belongs to the site of realloc() */
+                          utl_mem_site_del(p->site, p->size);
+                          p->site = s;
+                          utl_mem_site_add(p->site, size);
+                          p->size = size;
+                          memcpy(utl_mem_chk(p),BEG_CHK,4);
+                          utl_mem_end_set(p);
+                          ptr = utl_mem_data(p);
+                          break;
+    }
+    utl_mem_unlock();
+  }
+  return ptr;
+}
+
+void *utl_strdup(void *ptr, char *file, int line)
+{
+  char *dest;
+  size_t size;
+  
+  if (ptr == NULL) {
+    logWarn(utlMemLog,"strdup NULL (%u %s %d)", utl_mem_current(), file, line);
+    return NULL;
+  }
+  size = strlen(ptr)+1;
+
+  dest = utl_malloc(size,file,line);
+  if (dest) memcpy(dest,ptr,size);
+  logInfo(utlMemLog,"strdup %p [%d] -> %p (%u %s %d)", ptr, size, dest, \
+                                                utl_mem_current(), file, line);
+  return dest;
+}
+#undef utl_mem
+#undef utl_mem_plain
+#undef utl_mem_data
+#undef utl_mem_chk
+#undef utl_mem_slack
+#undef utl_mem_galign
+#undef utl_mem_raw
+#undef utl_mem_map
+#undef utl_mem_unmap
+
+/*************************************/
+#endif
+
+#define malloc(n)     utl_malloc(n,__FILE__,__LINE__)
+#define calloc(n,s)   utl_calloc(n,s,__FILE__,__LINE__)
+#define realloc(p,n)  utl_realloc(p,n,__FILE__,__LINE__)
+#define free(p)       utl_free(p,__FILE__,__LINE__)
+#define strdup(p)     utl_strdup(p,__FILE__,__LINE__)
+
+#define utlMemCheck(p)    utl_check(p,__FILE__, __LINE__)
+#define utlMemAllocated   utl_mem_current()
+#define utlMemValidate(p) utl_mem_validate(p)
+#define utlMemReport(f,n)      utl_mem_report(f,n)
+#define utlMemReportAtExit(n)  utl_mem_report_atexit(n)
+#define utlMemTrack(on)        utl_mem_track(on)
+#define utlMemLeaks(f)         utl_mem_leaks(f)
+#define utlMemCheckAll()       utl_check_all(__FILE__, __LINE__)
+#define utlMemSweep(n)         utl_mem_sweep(n)
+#define utlMemSample(n)        utl_mem_sample(n)
+#define utlMemQuarantine(n)    utl_mem_quarantine(n, __FILE__, __LINE__)
+#define utlMemGuard(s)         utl_mem_guard(s)
+#define utlMemStats(st)        utl_mem_stats(st)
+#define utlMemTrace(f)         utl_mem_trace_open(f)
+
+#define utlMalloc(n)     utl_malloc(n,__FILE__,__LINE__)
+#define utlCalloc(n,s)   utl_calloc(n,s,__FILE__,__LINE__)
+#define utlRealloc(p,n)  utl_realloc(p,n,__FILE__,__LINE__)
+#define utlFree(p)       utl_free(p,__FILE__,__LINE__)
+#define utlStrdup(p)     utl_strdup(p,__FILE__,__LINE__)
+
+#define utlMallocAligned(n,a) utl_malloc_aligned(n,a,__FILE__,__LINE__)
+#define utlFreeAligned(p)     utl_free(p,__FILE__,__LINE__)
+
+#else /* UTL_MEMCHECK */
+
+#define utlMemCheck(p) utlMemValid
+#define utlMemAllocated 0
+#define utlMemValidate(p) (p)
+#define utlMemReport(f,n)      ((void)0)
+#define utlMemReportAtExit(n)  ((void)0)
+#define utlMemTrack(on)        ((void)0)
+#define utlMemLeaks(f)         0
+#define utlMemCheckAll()       0
+#define utlMemSweep(n)         ((void)0)
+#define utlMemSample(n)        ((void)0)
+#define utlMemQuarantine(n)    0
+#define utlMemGuard(s)         0
+#define utlMemStats(st)        memset(st, 0, sizeof(utl_mem_stats_t))
+#define utlMemTrace(f)         0
+
+void *utl_aligned_alloc(size_t size, size_t align);
+void  utl_aligned_free(void *ptr);
+#define utlMallocAligned(n,a) utl_aligned_alloc(n,a)
+#define utlFreeAligned(p)     utl_aligned_free(p)
+
+#ifdef UTL_LIB
+/*************************************/
+
+/* The pointer returned by malloc() is stored just before the data */
+void *utl_aligned_alloc(size_t size, size_t align)
+{
+  char *raw, *ptr;
+  
+  if (align & (align - 1)) return NULL;
+  if (align < sizeof(void *)) align = sizeof(void *);
+  raw = malloc(size + align - 1 + sizeof(void *));
+  if (!raw) return NULL;
+  ptr = (char *)(((uintptr_t)raw + sizeof(void *) + align - 1) & ~(uintptr_t)(align - 1));
+  ((void **)ptr)[-1] = raw;
+  return ptr;
+}
+
+void utl_aligned_free(void *ptr)
+{
+  if (ptr) free(((void **)ptr)[-1]);
+}
+
+/*************************************/
+#endif
+
+#endif /* UTL_MEMCHECK */
+
+#ifndef UTL_NOADT
+
+/* .%% Arenas
+** ~~~~~~~~~~
+**
+**   Many objects (the nodes of a parse tree, the strings read from a
+** request, ...) are allocated one by one and then all freed together.
+** An arena allocates them by simply moving a pointer within large chunks
+** of memory and frees them all at once:
+** .v
+**     arena_t a = arenaNew(0);         // 0 is for UTL_ARENA_CHUNK bytes
+**     node = arenaAlloc(a, sizeof(node_t));
+**     name = arenaStrdup(a, "a name");
+**     ...
+**     arenaReset(a);                   // everything is gone, the arena
+**     ...                              // can be reused
+**     a = arenaFree(a);
+** ..
+**   A savepoint, taken with '{=arenaSave(a)}, can be used with
+** '{=arenaRollback(a,m)} to free only what has been allocated after it
+** (for example when a parser needs to backtrack). A savepoint is no longer
+** valid after rolling back to an earlier one or after '{=arenaReset(a)}.
+**   '{=vecNewIn(a,ty)} and '{=bufNewIn(a)} create vectors and buffers
+** whose memory comes from the arena '|a|. They are freed with the arena;
+** since an arena can't shrink, the space used before the vector grows is
+** only reclaimed then.
+**   All the blocks are aligned to '|UTL_ARENA_ALIGN| bytes.
+**
+**   With '|UTL_MEMCHECK|, the chunks are reported at the site where the
+** arena has been created and each object is reported (by
+** '{utlMemReport()}) at the site where it has been allocated, until the
+** arena is reset or the object is rolled back.
+*/
+
+#ifndef UTL_ARENA_CHUNK
+#define UTL_ARENA_CHUNK 65536
+#endif
+
+#ifndef UTL_ARENA_ALIGN
+#define UTL_ARENA_ALIGN 16
+#endif
+
+typedef struct utl_arena_chunk_s {
+  struct utl_arena_chunk_s *next;   /* previous (older) chunk */
+  char                     *top;    /* first free byte if not current */
+  char                     *end;
+} utl_arena_chunk_t;
+
+typedef struct utl_arena_s {
+  utl_arena_chunk_t *chunk;   /* current chunk */
+  char              *cur;     /* first free byte in the current chunk */
+  size_t             chunk_size;
+  size_t             used;
+  char              *file;    /* where the arena has been created */
+  int                line;
+} *arena_t;
+
+typedef struct {
+  utl_arena_chunk_t *chunk;
+  char              *cur;
+  size_t             used;
+} arena_mark_t;
+
+arena_t utl_arena_new(size_t chunk, char *file, int line);
+#define arenaNew(n) utl_arena_new(n, __FILE__, __LINE__)
+
+arena_t utl_arena_free(arena_t a);
+#define arenaFree utl_arena_free
+
+void *utl_arena_alloc(arena_t a, size_t n, char *file, int line);
+#define arenaAlloc(a,n) utl_arena_alloc(a, n, __FILE__, __LINE__)
+
+char *utl_arena_strdup(arena_t a, char *s, char *file, int line);
+#define arenaStrdup(a,s) utl_arena_strdup(a, s, __FILE__, __LINE__)
+
+arena_mark_t utl_arena_save(arena_t a);
+#define arenaSave utl_arena_save
+
+void utl_arena_rollback(arena_t a, arena_mark_t m);
+#define arenaRollback utl_arena_rollback
+
+void utl_arena_reset(arena_t a);
+#define arenaReset utl_arena_reset
+
+#define arenaUsed(a) ((a) ? (a)->used : 0)
+
+/* .%% Pools
+** ~~~~~~~~~
+**
+**   Small objects of the same size (the header of a vector, the node of a
+** list, ...) are better served by a pool than by '|malloc()|.
+** '{=poolAlloc(n)} takes the object from a free list (one for each size
+** class, multiple of 16 bytes, up to '|UTL_POOL_MAX| bytes) or, if the list
+** is empty, carves it out of a slab of '|UTL_POOL_SLAB| bytes.
+** '{=poolFree(p,n)} puts it back in the free list and needs the same size
+** '|n| that was used to allocate it. Objects larger than '|UTL_POOL_MAX| are
+** simply allocated with '|malloc()|.
+**
+**   With '|UTL_THREADS|, each thread has its own free lists and slabs, so
+** no lock is needed. An object freed by a thread different from the one
+** that allocated it goes to the free list of the former. Slabs are never
+** returned to the system: the objects that are in the free lists of a
+** thread are lost when the thread ends.
+**
+**   '{=poolStats(f)} writes to the file '|f| the occupancy of each size
+** class and returns the number of objects in use:
+** .v
+**     #  size    slabs     used     free
+**          32        1        3      505
+** ..
+**
+**   The counters of the objects in use and of the slabs are kept per
+** thread and summed up by '|poolStats()|; the counters of a thread that
+** frees objects allocated by another one can go below zero.
+**
+**   If '|UTL_POOL| is defined, '|vecNew()| and '|bufNew()| take the header
+** of the vector from the pool.
+**   With '|UTL_MEMCHECK|, there are no slabs: '|poolAlloc()| and
+** '|poolFree()| become '|malloc()| and '|free()| so that pooled objects
+** get all the checks of the traced memory (guards, quarantine, leaks
+** report). '|poolStats()| still counts the objects in use.
+*/
+
+#ifndef UTL_POOL_MAX
+#define UTL_POOL_MAX  256
+#endif
+
+#ifndef UTL_POOL_SLAB
+#define UTL_POOL_SLAB 16384
+#endif
+
+void *utl_pool_alloc(size_t n, char *file, int line);
+#define poolAlloc(n) utl_pool_alloc(n, __FILE__, __LINE__)
+
+void utl_pool_free(void *p, size_t n, char *file, int line);
+#define poolFree(p,n) utl_pool_free(p, n, __FILE__, __LINE__)
+
+size_t utl_pool_stats(FILE *f);
+#define poolStats utl_pool_stats
+
+typedef struct vec_s {
+  size_t  max;
+  size_t  cnt;
+  size_t  esz;
+  void   *vec;
+  arena_t arena;
+  size_t  grow_max;  /* max elements added in a single growth (0 = no limit) */
+  size_t  inl_max;   /* elements stored inline (small vectors) */
+  uint32_t align;
+  uint16_t grow;     /* growth percentage (0 = double) */
+  uint16_t flags;
+} *vec_t;
+
+#define UTL_VEC_STACK  0x01  /* header not allocated on the heap */
+#define UTL_VEC_SMALL  0x02  /* inline storage after the header */
+
+/* The inline storage of small vectors is placed after the header */
+#define utl_vec_hdr_size ((sizeof(struct vec_s) + 15) & ~(size_t)15)
+
+vec_t utl_vecNew(size_t esz);
+#define vecNew(ty) utl_vecNew(sizeof(ty))
+
+vec_t utl_vecNewIn(arena_t a, size_t esz);
+#define vecNewIn(a,ty) utl_vecNewIn(a, sizeof(ty))
+
+/* The elements of a vector created with vecNewAligned() are aligned to
+** 'align' bytes (a power of 2). After vecHugePages(n), the storage of any
+** vector that grows to 'n' bytes or more is aligned to UTL_HUGE_PAGE and,
+** where madvise() supports it, backed by transparent huge pages.
+*/
+#ifndef UTL_HUGE_PAGE
+#define UTL_HUGE_PAGE (2*1024*1024)
+#endif
+
+vec_t utl_vecNewAligned(size_t esz, size_t align);
+#define vecNewAligned(ty,a) utl_vecNewAligned(sizeof(ty), a)
+
+void utl_vec_huge_pages(size_t n);
+#define vecHugePages utl_vec_huge_pages
+
+/* Small vectors keep their first 'n' elements in the same block of the
+** header and move them to the heap only when they grow larger. vecStack()
+** declares a small vector whose header and inline elements are on the
+** stack; vecFree() must still be called on it to release the heap storage
+** it might have grown into. e.g:
+**   vecStack(v, int, 16);
+**   ...
+**   vecFree(v);
+*/
+vec_t utl_vecNewSmall(size_t esz, size_t n);
+#define vecNewSmall(ty,n) utl_vecNewSmall(sizeof(ty), n)
+#define bufNewSmall(n)    utl_vecNewSmall(1, n)
+
+vec_t utl_vec_stack(struct vec_s *v, size_t esz, size_t n);
+
+#define vecStack(v,ty,n) \
+  struct { union { struct vec_s h; char pad[utl_vec_hdr_size]; } h; \
+           union { ty e[n]; double d; void *p; } s; } v##_stk; \
+  vec_t v = utl_vec_stack(&v##_stk.h.h, sizeof(ty), n)
+
+#define bufStack(b,n) vecStack(b,char,n)
+
+vec_t utl_vecFree(vec_t v);
+#define vecFree utl_vecFree
+
+int utl_vecSet(vec_t v, size_t i, void *e);
+#define vecSet utl_vecSet
+
+int utl_vecAdd(vec_t v, void *e);
+#define vecAdd  utl_vecAdd
+
+/* Bulk operations grow the vector at most once and move the elements with
+** a single memmove(). If 'e' is NULL, the new elements are zeroed.
+** Inserting past the end zeroes the elements in between.
+*/
+int utl_vecAddN(vec_t v, void *e, size_t n);
+#define vecAddN utl_vecAddN
+
+int utl_vecInsertN(vec_t v, size_t i, void *e, size_t n);
+#define vecInsertN utl_vecInsertN
+
+int utl_vecExtend(vec_t v, vec_t w);
+#define vecExtend utl_vecExtend
+
+int utl_vecRemoveRange(vec_t v, size_t i, size_t n);
+#define vecRemoveRange utl_vecRemoveRange
+
+void *utl_vecGet(vec_t v, size_t  i);
+#define vecGet utl_vecGet
+
+int utl_vecResize(vec_t v, size_t n);
+#define vecResize utl_vecResize
+
+/* vecResize() rounds the capacity to a power of 2, vecReserve() ensures
+** room for exactly 'n' elements and vecShrinkToFit() releases the unused
+** room (bufShrinkToFit() keeps the place for the '\0' terminator).
+**   vecGrowth() sets how a vector grows when full: by 'pct' percent of its
+** capacity (0 is the default, doubling; at most 65535) but never by more
+** than 'max' elements (0 for no limit). For example, vecGrowth(v, 50, 0)
+** grows by 1.5x and vecGrowth(v, 100, 1024*1024) doubles until the vector
+** has 1M elements and then adds 1M elements at a time.
+*/
+int utl_vecReserve(vec_t v, size_t n);
+#define vecReserve utl_vecReserve
+
+int utl_vec_fit(vec_t v, size_t n);
+#define vecShrinkToFit(v) utl_vec_fit(v, vecCount(v))
+
+int utl_vecGrowth(vec_t v, size_t pct, size_t max);
+#define vecGrowth utl_vecGrowth
+
+size_t utl_vecCount(vec_t v);
+#define vecCount     utl_vecCount
+
+size_t utl_vecMax(vec_t v);
+#define vecMax     utl_vecMax
+
+void  *utl_vecVec(vec_t v);
+#define vec(v,ty)   ((ty *)utl_vecVec(v))
+
+int utl_vec_expand(vec_t v, size_t i);
+
+/* Typed vectors
+**   vecDeclare(ty,name) defines inline functions that handle a vector of
+** elements of type 'ty' directly (no memcpy() and the size of elements
+** known at compile time) so that loops over them can be optimized as
+** loops over a plain array:
+**
+**   vec_t nameNew(void)                create a new vector
+**   int   nameSet(vec_t v, size_t i, ty e)
+**   int   nameAdd(vec_t v, ty e)       add at the end (namePush is the same)
+**   ty    nameGet(vec_t v, size_t i)   a zeroed 'ty' if i is out of range
+**   ty    namePop(vec_t v)             remove the last element
+**   ty   *nameVec(vec_t v)             the elements as an array
+**
+**   They are plain vec_t: vecCount(), vecFree() and the others can be used
+** on them as well. For speed, 'v' is not checked against NULL.
+** Use vecDeclare() at file scope, e.g:
+**   vecDeclare(int, ivec);
+*/
+#if defined(_MSC_VER) && !defined(__cplusplus)
+#define utl_inline static __inline
+#else
+#define utl_inline static inline
+#endif
+
+#define vecDeclare(ty,nm) \
+  utl_inline vec_t nm##New(void) { return utl_vecNew(sizeof(ty)); } \
+  utl_inline ty *nm##Vec(vec_t v) { return v ? (ty *)(v->vec) : NULL; } \
+  utl_inline int nm##Set(vec_t v, size_t i, ty e) { \
+    if (!v) return 0; \
+    assert(v->esz == sizeof(ty)); \
+    if (i >= v->max && !utl_vec_expand(v, i)) return 0; \
+    ((ty *)(v->vec))[i] = e; \
+    if (i >= v->cnt) v->cnt = i+1; \
+    return 1; \
+  } \
+  utl_inline int nm##Add(vec_t v, ty e) { return v ? nm##Set(v, v->cnt, e) : 0; } \
+  utl_inline int nm##Push(vec_t v, ty e) { return v ? nm##Set(v, v->cnt, e) : 0; } \
+  utl_inline ty nm##Get(vec_t v, size_t i) { \
+    ty z; \
+    if (v && i < v->cnt) return ((ty *)(v->vec))[i]; \
+    memset(&z, 0, sizeof(ty)); \
+    return z; \
+  } \
+  utl_inline ty nm##Pop(vec_t v) { \
+    ty z; \
+    if (v && v->cnt > 0) return ((ty *)(v->vec))[--v->cnt]; \
+    memset(&z, 0, sizeof(ty)); \
+    return z; \
+  } \
+  typedef ty nm##_elem_t
+
+#define buf_t vec_t
+int utl_bufSet(buf_t bf, size_t i, char c);
+
+#define bufNew() utl_vecNew(1)
+#define bufNewIn(a) utl_vecNewIn(a, 1)
+#define bufFree  utl_vecFree
+
+char utl_bufGet(buf_t bf, size_t i);
+#define bufGet   utl_bufGet
+
+int utl_bufSet(buf_t bf, size_t i, char c);
+#define bufSet   utl_bufSet
+
+int utl_bufAdd(buf_t bf, char c);
+#define bufAdd   utl_bufAdd
+
+int utl_bufAddStr(buf_t bf, char *s);
+#define bufAddStr  utl_bufAddStr
+
+int utl_bufAddN(buf_t bf, char *s, size_t n);
+#define bufAddN  utl_bufAddN
+
+#define bufResize utl_vecResize
+#define bufReserve(bf,n) utl_vecReserve(bf, (n)+1)
+#define bufShrinkToFit(bf) utl_vec_fit(bf, bufLen(bf)+1)
+
+#define bufClr(bf) utl_bufSet(bf,0,'\0');
+
+int utl_bufFormat(buf_t bf, char *format, ...);
+#define bufFormat utl_bufFormat
+
+#define bufLen vecCount
+#define bufMax vecMax
+#define bufStr(b) vec(b,char)
+
+int utl_bufAddLine(buf_t bf, FILE *f);
+#define bufAddLine utl_bufAddLine
+
+int utl_bufAddFile(buf_t bf, FILE *f);
+#define bufAddFile utl_bufAddFile
+
+/* .%% Segmented vectors
+** ~~~~~~~~~~~~~~~~~~~~~
+**
+**   A segmented vector stores its elements in chunks of the same size (a
+** power of 2) reached through a directory. When it grows, a new chunk is
+** added and the existing elements are neither copied nor moved: pointers
+** returned by '|segGet()| remain valid until the vector is freed.
+** Only the directory (one pointer per chunk) is reallocated.
+**
+**   '{=segNew(ty)} creates a vector with chunks of '|UTL_SEG_CHUNK|
+** elements, '{=segNewChunk(ty,n)} with chunks of '|n| elements (rounded up
+** to a power of 2). '{=segSet(s,i,e)}, '{=segAdd(s,e)}, '{=segGet(s,i)},
+** '{=segCount(s)} and '{=segFree(s)} behave as their '|vec| counterparts.
+** Element '|i| is found with a shift and a mask of its index.
+*/
+
+#ifndef UTL_SEG_CHUNK
+#define UTL_SEG_CHUNK 1024
+#endif
+
+typedef struct seg_s {
+  size_t  cnt;
+  size_t  esz;
+  size_t  shift;     /* log2 of the number of elements in a chunk */
+  size_t  mask;
+  size_t  chunks;
+  size_t  dir_max;
+  char  **dir;
+} *seg_t;
+
+seg_t utl_segNew(size_t esz, size_t n);
+#define segNew(ty) utl_segNew(sizeof(ty), UTL_SEG_CHUNK)
+#define segNewChunk(ty,n) utl_segNew(sizeof(ty), n)
+
+seg_t utl_segFree(seg_t s);
+#define segFree utl_segFree
+
+int utl_segSet(seg_t s, size_t i, void *e);
+#define segSet utl_segSet
+
+int utl_segAdd(seg_t s, void *e);
+#define segAdd utl_segAdd
+
+void *utl_segGet(seg_t s, size_t i);
+#define segGet utl_segGet
+
+size_t utl_segCount(seg_t s);
+#define segCount utl_segCount
+
+/* .%% Ring queues
+** ~~~~~~~~~~~~~~~
+**
+**   A '|que_t| is a fixed size ring buffer that can be used, without any
+** lock, by two threads: one (the producer) adding elements and the other
+** (the consumer) taking them. The number of elements '|n| is rounded up to
+** a power of 2. The indices written by the two threads are on different
+** cache lines and each thread keeps a copy of the other one's index so
+** that the shared one is read only when the queue looks full (or empty).
+**
+**   '{=queNew(ty,n)} creates a queue for '|n| elements of type '|ty|.
+** '{=quePut(q,e)} and '{=queGet(q,e)} copy an element in and out of the
+** queue and return 0 if it is full (or empty). '{=quePutN(q,e,n)} and
+** '{=queGetN(q,e,n)} copy up to '|n| elements from (to) the array '|e|
+** and return how many they copied.
+**
+**   '{=quePutWait()}, '{=queGetWait()} and '{=quePutNWait()} wait until
+** they can copy all the elements, '{=queGetNWait()} until it can copy at
+** least one. They can only wait on queues created with '{=queNewWait()}:
+** every put and get on those queues also checks (after a full memory
+** fence) if the other thread is waiting to be woken up. A waiting thread
+** spins for '|UTL_QUE_SPIN| times and then sleeps on a futex (on Linux,
+** unless '|UTL_QUE_NOFUTEX| is defined) or a condition variable.
+**   On queues created with '{=queNew()}, or without '|UTL_THREADS|, they
+** can't wait and behave as their non-blocking version.
+*/
+
+#ifndef UTL_QUE_SPIN
+#define UTL_QUE_SPIN 1000
+#endif
+
+#if defined(UTL_THREADS) && defined(__linux__) && !defined(UTL_QUE_NOFUTEX)
+#define UTL_QUE_FUTEX
+#endif
+
+typedef struct que_s {
+  size_t   tail;        /* written by the producer */
+  size_t   head_cache;
+  char     pad_p[UTL_CACHE_LINE - 2 * sizeof(size_t)];
+  size_t   head;        /* written by the consumer */
+  size_t   tail_cache;
+  char     pad_c[UTL_CACHE_LINE - 2 * sizeof(size_t)];
+  unsigned ev[2];       /* bumped to wake a waiting thread */
+  int      waiting[2];
+  char     pad_w[UTL_CACHE_LINE - 2 * sizeof(unsigned) - 2 * sizeof(int)];
+  size_t   mask;
+  size_t   esz;
+  char    *buf;
+  int      wait;        /* created by queNewWait() */
+#if defined(UTL_THREADS) && !defined(UTL_QUE_FUTEX)
+  pthread_mutex_t mtx;
+  pthread_cond_t  cond[2];
+#endif
+} *que_t;
+
+que_t utl_queNew(size_t esz, size_t n, int wait);
+#define queNew(ty,n)     utl_queNew(sizeof(ty), n, 0)
+#define queNewWait(ty,n) utl_queNew(sizeof(ty), n, 1)
+
+que_t utl_queFree(que_t q);
+#define queFree utl_queFree
+
+size_t utl_quePutN(que_t q, void *e, size_t n);
+#define quePutN utl_quePutN
+#define quePut(q,e) (utl_quePutN(q, e, 1) == 1)
+
+size_t utl_queGetN(que_t q, void *e, size_t n);
+#define queGetN utl_queGetN
+#define queGet(q,e) (utl_queGetN(q, e, 1) == 1)
+
+size_t utl_quePutNWait(que_t q, void *e, size_t n);
+#define quePutNWait utl_quePutNWait
+#define quePutWait(q,e) (utl_quePutNWait(q, e, 1) == 1)
+
+size_t utl_queGetNWait(que_t q, void *e, size_t n);
+#define queGetNWait utl_queGetNWait
+#define queGetWait(q,e) (utl_queGetNWait(q, e, 1) == 1)
+
+size_t utl_queCount(que_t q);
+#define queCount utl_queCount
+#define queMax(q) ((q)->mask + 1)
+
+#if !defined(UTL_HAS_SNPRINTF) && defined(_MSC_VER) && (_MSC_VER < 1800)
+#define UTL_ADD_SNPRINTF
+#define snprintf  c99_snprintf
+#define vsnprintf c99_vsnprintf
+#endif
+
+#ifdef UTL_LIB
+
+#ifdef UTL_UNIX
+#include <sys/mman.h>
+#endif
+
+#ifdef UTL_QUE_FUTEX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define utl_arena_up(n) (((n) + UTL_ARENA_ALIGN - 1) & ~(size_t)(UTL_ARENA_ALIGN - 1))
+#define UTL_ARENA_HDR   utl_arena_up(sizeof(utl_arena_chunk_t))
+
+/* With UTL_MEMCHECK each object is preceded by its site and size so that
+** it can be accounted for when it's released.
+*/
+#ifdef UTL_MEMCHECK
+typedef struct {
+  void   *site;
+  size_t  size;
+} utl_arena_obj_t;
+#define UTL_ARENA_OBJ           utl_arena_up(sizeof(utl_arena_obj_t))
+#define utl_arena_malloc(n,f,l) utl_malloc(n, f, l)
+#else
+#define UTL_ARENA_OBJ           0
+#define utl_arena_malloc(n,f,l) malloc(n)
+#endif
+
+arena_t utl_arena_new(size_t chunk, char *file, int line)
+{
+  arena_t a;
+  
+  a = utl_arena_malloc(sizeof(struct utl_arena_s), file, line);
+  if (a) {
+    a->chunk = NULL;  a->cur = NULL;
+    a->chunk_size = chunk ? chunk : UTL_ARENA_CHUNK;
+    a->used = 0;
+    a->file = file;   a->line = line;
+  }
+  return a;
+}
+
+static int utl_arena_grow(arena_t a, size_t n)
+{
+  utl_arena_chunk_t *c;
+  size_t sz = a->chunk_size;
+  
+  if (sz < UTL_ARENA_HDR + n) sz = UTL_ARENA_HDR + n;
+  c = utl_arena_malloc(sz, a->file, a->line);
+  if (!c) return 0;
+  if (a->chunk) a->chunk->top = a->cur;
+  c->next = a->chunk;
+  c->end  = (char *)c + sz;
+  c->top  = (char *)c + UTL_ARENA_HDR;
+  a->chunk = c;
+  a->cur = c->top;
+  return 1;
+}
+
+void *utl_arena_alloc(arena_t a, size_t n, char *file, int line)
+{
+  size_t sz;
+  char *p;
+  
+  if (!a) return NULL;
+  sz = UTL_ARENA_OBJ + utl_arena_up(n);
+  if (!a->chunk || (size_t)(a->chunk->end - a->cur) < sz) {
+    if (!utl_arena_grow(a, sz)) return NULL;
+  }
+  p = a->cur;
+  a->cur += sz;
+  a->used += sz;
+#ifdef UTL_MEMCHECK
+  ((utl_arena_obj_t *)p)->site = utl_mem_account(file, line, n);
+  ((utl_arena_obj_t *)p)->size = n;
+  p += UTL_ARENA_OBJ;
+#endif
+  return p;
+}
+
+char *utl_arena_strdup(arena_t a, char *s, char *file, int line)
+{
+  size_t n;
+  char *p;
+  
+  if (!s) return NULL;
+  n = strlen(s) + 1;
+  p = utl_arena_alloc(a, n, file, line);
+  if (p) memcpy(p, s, n);
+  return p;
+}
+
+static void utl_arena_drop(char *from, char *to)
+{
+#ifdef UTL_MEMCHECK
+  utl_arena_obj_t *o;
+  
+  while (from < to) {
+    o = (utl_arena_obj_t *)from;
+    utl_mem_unaccount(o->site, o->size);
+    from += UTL_ARENA_OBJ + utl_arena_up(o->size);
+  }
+#endif
+}
+
+arena_mark_t utl_arena_save(arena_t a)
+{
+  arena_mark_t m = {NULL, NULL, 0};
+  
+  if (a) {
+    m.chunk = a->chunk;
+    m.cur   = a->cur;
+    m.used  = a->used;
+  }
+  return m;
+}
+
+void utl_arena_rollback(arena_t a, arena_mark_t m)
+{
+  utl_arena_chunk_t *c;
+  
+  if (!a) return;
+  while ((c = a->chunk) && c != m.chunk) {
+    utl_arena_drop((char *)c + UTL_ARENA_HDR, a->cur);
+    a->chunk = c->next;
+    a->cur = a->chunk ? a->chunk->top : NULL;
+    free(c);
+  }
+  if (c) {
+    utl_arena_drop(m.cur, a->cur);
+    a->cur = m.cur;
+  }
+  a->used = m.used;
+}
+
+/* Only the oldest chunk is kept */
+void utl_arena_reset(arena_t a)
+{
+  arena_mark_t m = {NULL, NULL, 0};
+  
+  if (!a || !a->chunk) return;
+  for (m.chunk = a->chunk; m.chunk->next; m.chunk = m.chunk->next) ;
+  m.cur = (char *)m.chunk + UTL_ARENA_HDR;
+  utl_arena_rollback(a, m);
+}
+
+arena_t utl_arena_free(arena_t a)
+{
+  arena_mark_t m = {NULL, NULL, 0};
+  
+  if (a) {
+    utl_arena_rollback(a, m);
+    free(a);
+  }
+  return NULL;
+}
+
+#undef utl_arena_malloc
+
+#define UTL_POOL_CLASSES  (UTL_POOL_MAX / 16)
+#define utl_pool_class(n) (((n) + 15) / 16 - 1)
+
+/* Counters of a thread. They are only written by their own thread (so
+** they don't need atomic RMW) and never freed, so that poolStats() can
+** still read them after the thread ends.
+*/
+typedef struct utl_pool_cnt_s {
+  struct utl_pool_cnt_s *next;
+  long used[UTL_POOL_CLASSES];
+  long slabs[UTL_POOL_CLASSES];
+  char pad[UTL_CACHE_LINE];
+} utl_pool_cnt_t;
+
+static utl_pool_cnt_t utl_pool_cnt0;  /* shared if malloc() fails */
+static utl_pool_cnt_t *utl_pool_cnts = &utl_pool_cnt0;
+static utl_thread_local utl_pool_cnt_t *utl_pool_cnt = NULL;
+#ifdef UTL_THREADS
+static pthread_mutex_t utl_pool_mtx = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static utl_pool_cnt_t *utl_pool_counters(void)
+{
+  utl_pool_cnt_t *c = utl_pool_cnt;
+  
+  if (c) return c;
+  c = (malloc)(sizeof(utl_pool_cnt_t));  /* not traced */
+  if (c) {
+    memset(c, 0, sizeof(utl_pool_cnt_t));
+#ifdef UTL_THREADS
+    pthread_mutex_lock(&utl_pool_mtx);
+#endif
+    c->next = utl_pool_cnts;
+    utl_pool_cnts = c;
+#ifdef UTL_THREADS
+    pthread_mutex_unlock(&utl_pool_mtx);
+#endif
+  }
+  else c = &utl_pool_cnt0;
+  utl_pool_cnt = c;
+  return c;
+}
+
+#define utl_pool_count(v,d) utl_atomic_set(&(v), utl_atomic_get(&(v)) + (d))
+
+#ifdef UTL_MEMCHECK
+
+void *utl_pool_alloc(size_t n, char *file, int line)
+{
+  void *p = utl_malloc(n ? n : 1, file, line);
+  
+  if (p && n <= UTL_POOL_MAX) utl_pool_count(utl_pool_counters()->used[utl_pool_class(n ? n : 1)], 1);
+  return p;
+}
+
+void utl_pool_free(void *ptr, size_t n, char *file, int line)
+{
+  if (!ptr) return;
+  if (n <= UTL_POOL_MAX) utl_pool_count(utl_pool_counters()->used[utl_pool_class(n ? n : 1)], -1);
+  utl_free(ptr, file, line);
+}
+
+#else
+
+static utl_thread_local char *utl_pool_list[UTL_POOL_CLASSES];
+static utl_thread_local char *utl_pool_cur[UTL_POOL_CLASSES];
+static utl_thread_local char *utl_pool_end[UTL_POOL_CLASSES];
+
+void *utl_pool_alloc(size_t n, char *file, int line)
+{
+  utl_pool_cnt_t *cnt;
+  size_t sz = n ? n : 1;
+  char *p;
+  int c;
+  
+  if (sz > UTL_POOL_MAX) return malloc(n);
+  cnt = utl_pool_counters();
+  c = utl_pool_class(sz);
+  if ((p = utl_pool_list[c]) != NULL) 
+    utl_pool_list[c] = *(char **)p;
+  else {
+    sz = (c + 1) * 16;
+    if ((size_t)(utl_pool_end[c] - utl_pool_cur[c]) < sz) {
+      if (!(p = malloc(UTL_POOL_SLAB))) return NULL;
+      utl_pool_cur[c] = p;
+      utl_pool_end[c] = p + UTL_POOL_SLAB;
+      utl_pool_count(cnt->slabs[c], 1);
+    }
+    p = utl_pool_cur[c];
+    utl_pool_cur[c] += sz;
+  }
+  utl_pool_count(cnt->used[c], 1);
+  return p;
+}
+
+void utl_pool_free(void *ptr, size_t n, char *file, int line)
+{
+  size_t sz = n ? n : 1;
+  char *p = ptr;
+  int c;
+  
+  if (!ptr) return;
+  if (sz > UTL_POOL_MAX) { free(ptr); return; }
+  c = utl_pool_class(sz);
+  *(char **)p = utl_pool_list[c];
+  utl_pool_list[c] = p;
+  utl_pool_count(utl_pool_counters()->used[c], -1);
+}
+
+#endif
+
+size_t utl_pool_stats(FILE *f)
+{
+  utl_pool_cnt_t *cnt;
+  long slabs, used, tot = 0;
+  int c;
+  
+#ifdef UTL_THREADS
+  pthread_mutex_lock(&utl_pool_mtx);
+#endif
+  if (f) fprintf(f, "#  size    slabs     used     free\n");
+  for (c = 0; c < UTL_POOL_CLASSES; c++) {
+    slabs = used = 0;
+    for (cnt = utl_pool_cnts; cnt; cnt = cnt->next) {
+      slabs += utl_atomic_get(&cnt->slabs[c]);
+      used  += utl_atomic_get(&cnt->used[c]);
+    }
+    tot += used;
+    if (f && (slabs > 0 || used > 0))
+      fprintf(f, "%7lu %8lu %8lu %8lu\n", (unsigned long)(c + 1) * 16, (unsigned long)slabs,
+                 (unsigned long)used, (unsigned long)(slabs * (UTL_POOL_SLAB / ((c + 1) * 16)) - used));
+  }
+#ifdef UTL_THREADS
+  pthread_mutex_unlock(&utl_pool_mtx);
+#endif
+  if (f) fflush(f);
+  return tot > 0 ? (size_t)tot : 0;
+}
+
+#undef utl_pool_count
+
+#ifdef UTL_POOL
+#define utl_vec_hdr_alloc()  poolAlloc(sizeof(struct vec_s))
+#define utl_vec_hdr_free(v)  poolFree(v, sizeof(struct vec_s))
+#else
+#define utl_vec_hdr_alloc()  malloc(sizeof(struct vec_s))
+#define utl_vec_hdr_free(v)  free(v)
+#endif
+
+vec_t utl_vecNew(size_t esz)
+{
+  vec_t v;
+  v = utl_vec_hdr_alloc();
+  if (v) {
+    v->max = 0;    v->cnt = 0;
+    v->esz = esz;  v->vec = NULL;
+    v->arena = NULL;
+    v->align = 0;  v->flags = 0;
+    v->grow = 0;   v->grow_max = 0;
+    v->inl_max = 0;
+  }
+  return v;
+}
+
+vec_t utl_vecNewAligned(size_t esz, size_t align)
+{
+  vec_t v;
+  if (align & (align - 1)) return NULL;
+  if (align > UINT32_MAX) return NULL;
+  v = utl_vecNew(esz);
+  if (v) v->align = (uint32_t)align;
+  return v;
+}
+
+vec_t utl_vecNewIn(arena_t a, size_t esz)
+{
+  vec_t v;
+  v = arenaAlloc(a, sizeof(struct vec_s));
+  if (v) {
+    v->max = 0;    v->cnt = 0;
+    v->esz = esz;  v->vec = NULL;
+    v->arena = a;
+    v->align = 0;  v->flags = 0;
+    v->grow = 0;   v->grow_max = 0;
+    v->inl_max = 0;
+  }
+  return v;
+}
+
+#define utl_vec_inl(v)    ((v)->flags & UTL_VEC_SMALL ? (char *)(v) + utl_vec_hdr_size : NULL)
+#define utl_vec_inline(v) ((v)->flags & UTL_VEC_SMALL && (v)->vec == utl_vec_inl(v))
+
+vec_t utl_vec_stack(struct vec_s *v, size_t esz, size_t n)
+{
+  v->max = n;    v->cnt = 0;
+  v->esz = esz;  v->vec = (char *)v + utl_vec_hdr_size;
+  v->arena = NULL;
+  v->align = 0;  v->flags = UTL_VEC_STACK | UTL_VEC_SMALL;
+  v->grow = 0;   v->grow_max = 0;
+  v->inl_max = n;
+  return v;
+}
+
+vec_t utl_vecNewSmall(size_t esz, size_t n)
+{
+  vec_t v;
+  v = malloc(utl_vec_hdr_size + n * esz);
+  if (v) {
+    utl_vec_stack(v, esz, n);
+    v->flags = UTL_VEC_SMALL;
+  }
+  return v;
+}
+
+/* Vectors in an arena are freed with the arena */
+vec_t utl_vecFree(vec_t v)
+{
+  if (v && !v->arena) {
+    if (v->vec && !utl_vec_inline(v)) {
+      if (v->align) utlFreeAligned(v->vec);
+      else free(v->vec);
+    }
+    v->max = 0;  v->cnt = 0;
+    v->esz = 0;  v->vec = NULL;
+    if (v->flags & UTL_VEC_STACK) ;
+    else if (v->flags & UTL_VEC_SMALL) free(v);  /* small vector: header and elements in one block */
+    else utl_vec_hdr_free(v);
+  }
+  return NULL;
+}
+
+#undef utl_vec_hdr_alloc
+#undef utl_vec_hdr_free
+
+static size_t utl_vec_huge = 0;
+
+void utl_vec_huge_pages(size_t n)
+{
+  utl_vec_huge = n;
+}
+
+/* Aligned and inline storage can't be realloc()ed: the old one is copied
+** (and freed) */
+static void *utl_vec_realloc(vec_t v, size_t max)
+{
+  size_t n = max * v->esz;
+  size_t align = v->align;
+  char *new_vec;
+  
+  if (v->arena) {
+    new_vec = arenaAlloc(v->arena, n);
+    if (new_vec && v->vec) memcpy(new_vec, v->vec, (max < v->max ? max : v->max) * v->esz);
+    return new_vec;
+  }
+  if (utl_vec_huge > 0 && n >= utl_vec_huge && align < UTL_HUGE_PAGE) align = UTL_HUGE_PAGE;
+  if (!align && !utl_vec_inline(v)) return realloc(v->vec, n);
+  
+  new_vec = align ? utlMallocAligned(n, align) : malloc(n);
+  if (!new_vec) return NULL;
+  if (v->vec) {
+    memcpy(new_vec, v->vec, (max < v->max ? max : v->max) * v->esz);
+    if (utl_vec_inline(v)) ;
+    else if (v->align) utlFreeAligned(v->vec);
+    else free(v->vec);
+  }
+  v->align = (uint32_t)align;
+#if defined(UTL_UNIX) && defined(MADV_HUGEPAGE)
+  if (align >= UTL_HUGE_PAGE && n >= UTL_HUGE_PAGE)
+    madvise(new_vec, n & ~(size_t)(UTL_HUGE_PAGE - 1), MADV_HUGEPAGE);
+#endif
+  return new_vec;
+}
+
+size_t utl_vecCount(vec_t v) { return v? v->cnt : 0; }
+size_t utl_vecMax(vec_t v)   { return v? v->max : 0; }
+void  *utl_vecVec(vec_t v)   { return v? v->vec : NULL; } 
+
+int utl_vecGrowth(vec_t v, size_t pct, size_t max)
+{
+  if (!v) return 0;
+  v->grow = (uint16_t)(pct > UINT16_MAX ? UINT16_MAX : pct);
+  v->grow_max = max;
+  return 1;
+}
+
+int utl_vec_expand(vec_t v, size_t i)
+{
+  size_t new_max;
+  size_t step;
+  char *new_vec = NULL;
+   
+  if (!v) return 0;
+   
+  new_max = v->max;
+  
+  if (new_max <= i && new_max < 8) new_max = 8;
+
+  while (new_max <= i) {
+    if (v->grow == 0) step = new_max; /* double */
+    else step = (new_max / 100) * v->grow + ((new_max % 100) * v->grow) / 100;
+    if (step == 0) step = 1;
+    if (v->grow_max > 0 && step >= v->grow_max) {
+      new_max += ((i - new_max) / v->grow_max + 1) * v->grow_max;
+      break;
+    }
+    new_max += step;
+  }
+   
+  if (new_max > v->max) {
+    new_vec = utl_vec_realloc(v,new_max);
+    if (!new_vec) return 0;
+    v->vec = new_vec;
+    v->max = new_max;
+  }
+  return 1;
+}
+
+int utl_vecSet(vec_t v, size_t  i, void *e)
+{
+  if (!utl_vec_expand(v,i)) return 0;
+  
+  memcpy(((char *)(v->vec)) + (i * v->esz),e,v->esz);
+  if (i >= v->cnt) v->cnt = i+1;
+  return 1;
+}
+
+void *utl_vecGet(vec_t v, size_t i)
+{
+  if (!v) return '\0';
+  if (i >= v->cnt) return NULL;
+  return ((char *)(v->vec)) + (i*v->esz);
+}
+
+int utl_vecAdd(vec_t v, void *e)
+{
+  return utl_vecSet(v,v->cnt,e);
+}
+
+int utl_vecInsertN(vec_t v, size_t i, void *e, size_t n)
+{
+  size_t off = 0;
+  size_t cnt, k;
+  char *p;
+  int inside;
+
+  if (!v) return 0;
+  if (n == 0) return 1;
+  
+  cnt = v->cnt > i ? v->cnt : i;
+  
+  /* 'e' could point to the old storage */
+  inside = (e && v->vec && (char *)e >= (char *)v->vec &&
+                           (char *)e <  (char *)v->vec + v->cnt * v->esz);
+  if (inside) off = (char *)e - (char *)v->vec;
+  
+  if (!utl_vec_expand(v, cnt+n-1)) return 0;
+  
+  p = (char *)(v->vec) + i * v->esz;
+  if (i < v->cnt) memmove(p + n * v->esz, p, (v->cnt - i) * v->esz);
+  else if (i > v->cnt) memset((char *)(v->vec) + v->cnt * v->esz, 0, (i - v->cnt) * v->esz);
+  
+  if (!e) memset(p, 0, n * v->esz);
+  else if (!inside) memcpy(p, e, n * v->esz);
+  else {  /* the part of the source after 'i' has been moved up */
+    e = (char *)(v->vec) + off;
+    if ((char *)e >= p) memcpy(p, (char *)e + n * v->esz, n * v->esz);
+    else {
+      k = p - (char *)e;
+      if (k > n * v->esz) k = n * v->esz;
+      memcpy(p, e, k);
+      memcpy(p + k, p + n * v->esz, n * v->esz - k);
+    }
+  }
+  v->cnt = cnt+n;
+  return 1;
+}
+
+int utl_vecAddN(vec_t v, void *e, size_t n)
+{
+  if (!v) return 0;
+  return utl_vecInsertN(v, v->cnt, e, n);
+}
+
+int utl_vecExtend(vec_t v, vec_t w)
+{
+  if (!v || !w || v->esz != w->esz) return 0;
+  return utl_vecInsertN(v, v->cnt, w->vec, w->cnt);
+}
+
+int utl_vecRemoveRange(vec_t v, size_t i, size_t n)
+{
+  char *p;
+  
+  if (!v) return 0;
+  if (i >= v->cnt) return 1;
+  if (n > v->cnt - i) n = v->cnt - i;
+  
+  p = (char *)(v->vec) + i * v->esz;
+  memmove(p, p + n * v->esz, (v->cnt - i - n) * v->esz);
+  v->cnt -= n;
+  return 1;
+}
+
+int utl_vecResize(vec_t v, size_t n)
+{
+  size_t new_max = 1;
+  char *new_vec = NULL;
+  if (!v) return 0;
+
+  while (new_max <= n) new_max *= 2;
+  
+  if (new_max != v->max) {
+    new_vec = utl_vec_realloc(v,new_max);
+    if (!new_vec) return 0;
+    v->vec = new_vec;
+    v->max = new_max;
+    if (v->cnt > v->max) v->cnt = v->max;
+  }
+  
+  return 1;
+}
+
+int utl_vecReserve(vec_t v, size_t n)
+{
+  char *new_vec = NULL;
+  if (!v) return 0;
+  
+  if (n > v->max) {
+    new_vec = utl_vec_realloc(v,n);
+    if (!new_vec) return 0;
+    v->vec = new_vec;
+    v->max = n;
+  }
+  return 1;
+}
+
+/* Storage in an arena can't be given back. Small vectors move back to their
+** inline storage if they fit into it.
+*/
+int utl_vec_fit(vec_t v, size_t n)
+{
+  char *new_vec = NULL;
+  if (!v) return 0;
+  
+  if (n >= v->max || v->arena || utl_vec_inline(v)) return 1;
+  if (n == 0 || n <= v->inl_max) {
+    char *inl = utl_vec_inl(v);
+    if (inl) memcpy(inl, v->vec, (v->cnt < n ? v->cnt : n) * v->esz);
+    if (v->align) utlFreeAligned(v->vec);
+    else free(v->vec);
+    v->vec = inl;
+    v->max = v->inl_max;
+    if (v->cnt > v->max) v->cnt = v->max;
+    return 1;
+  }
+  new_vec = utl_vec_realloc(v,n);
+  if (!new_vec) return 0;
+  v->vec = new_vec;
+  v->max = n;
+  if (v->cnt > v->max) v->cnt = v->max;
+  return 1;
+}
+
+#undef utl_vec_inline
+#undef utl_vec_inl
+
+seg_t utl_segNew(size_t esz, size_t n)
+{
+  seg_t s;
+  size_t shift = 0;
+  
+  while (((size_t)1 << shift) < n) shift++;
+  s = malloc(sizeof(struct seg_s));
+  if (s) {
+    s->cnt = 0;        s->esz = esz;
+    s->shift = shift;  s->mask = ((size_t)1 << shift) - 1;
+    s->chunks = 0;     s->dir_max = 0;
+    s->dir = NULL;
+  }
+  return s;
+}
+
+seg_t utl_segFree(seg_t s)
+{
+  size_t k;
+  if (s) {
+    for (k = 0; k < s->chunks; k++) free(s->dir[k]);
+    if (s->dir) free(s->dir);
+    free(s);
+  }
+  return NULL;
+}
+
+size_t utl_segCount(seg_t s) { return s? s->cnt : 0; }
+
+/* Adds the chunks up to the one holding the element 'i' */
+static int utl_seg_expand(seg_t s, size_t i)
+{
+  size_t c = i >> s->shift;
+  size_t new_max;
+  char **new_dir;
+  char *chunk;
+  
+  while (s->chunks <= c) {
+    if (s->chunks >= s->dir_max) {
+      new_max = s->dir_max ? s->dir_max * 2 : 8;
+      while (new_max <= c) new_max *= 2;
+      new_dir = realloc(s->dir, new_max * sizeof(char *));
+      if (!new_dir) return 0;
+      s->dir = new_dir;
+      s->dir_max = new_max;
+    }
+    chunk = malloc(s->esz << s->shift);
+    if (!chunk) return 0;
+    s->dir[s->chunks++] = chunk;
+  }
+  return 1;
+}
+
+int utl_segSet(seg_t s, size_t i, void *e)
+{
+  if (!s) return 0;
+  if ((i >> s->shift) >= s->chunks && !utl_seg_expand(s, i)) return 0;
+  
+  memcpy(s->dir[i >> s->shift] + (i & s->mask) * s->esz, e, s->esz);
+  if (i >= s->cnt) s->cnt = i+1;
+  return 1;
+}
+
+int utl_segAdd(seg_t s, void *e)
+{
+  if (!s) return 0;
+  return utl_segSet(s, s->cnt, e);
+}
+
+void *utl_segGet(seg_t s, size_t i)
+{
+  if (!s || i >= s->cnt) return NULL;
+  return s->dir[i >> s->shift] + (i & s->mask) * s->esz;
+}
+
+#define UTL_QUE_DATA 0
+#define UTL_QUE_ROOM 1
+
+que_t utl_queNew(size_t esz, size_t n, int wait)
+{
+  que_t q;
+  size_t max = 1;
+  
+  while (max < n) max *= 2;
+  q = utlMallocAligned(sizeof(struct que_s), UTL_CACHE_LINE);
+  if (!q) return NULL;
+  memset(q, 0, sizeof(struct que_s));
+  q->buf = malloc(max * esz);
+  if (!q->buf) {
+    utlFreeAligned(q);
+    return NULL;
+  }
+  q->mask = max - 1;
+  q->esz = esz;
+  q->wait = wait;
+#if defined(UTL_THREADS) && !defined(UTL_QUE_FUTEX)
+  pthread_mutex_init(&q->mtx, NULL);
+  pthread_cond_init(&q->cond[UTL_QUE_DATA], NULL);
+  pthread_cond_init(&q->cond[UTL_QUE_ROOM], NULL);
+#endif
+  return q;
+}
+
+que_t utl_queFree(que_t q)
+{
+  if (q) {
+#if defined(UTL_THREADS) && !defined(UTL_QUE_FUTEX)
+    pthread_cond_destroy(&q->cond[UTL_QUE_ROOM]);
+    pthread_cond_destroy(&q->cond[UTL_QUE_DATA]);
+    pthread_mutex_destroy(&q->mtx);
+#endif
+    free(q->buf);
+    utlFreeAligned(q);
+  }
+  return NULL;
+}
+
+size_t utl_queCount(que_t q)
+{
+  if (!q) return 0;
+  return utl_atomic_acquire(&q->tail) - utl_atomic_acquire(&q->head);
+}
+
+#ifdef UTL_THREADS
+static int utl_que_ready(que_t q, int d)
+{
+  if (d == UTL_QUE_DATA) return utl_atomic_acquire(&q->tail) != q->head;
+  return q->tail - utl_atomic_acquire(&q->head) <= q->mask;
+}
+#endif
+
+/* The fence pairs with the one in utl_que_wait(): either the waiting
+** thread sees the new index or this one sees it's waiting.
+*/
+static void utl_que_wake(que_t q, int d)
+{
+#ifdef UTL_THREADS
+  if (!q->wait) return;
+  utl_atomic_fence();
+  if (utl_atomic_get(&q->waiting[d]) == 0) return;
+#ifdef UTL_QUE_FUTEX
+  utl_atomic_add(&q->ev[d], 1);
+  syscall(SYS_futex, &q->ev[d], FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#else
+  pthread_mutex_lock(&q->mtx);
+  pthread_cond_signal(&q->cond[d]);
+  pthread_mutex_unlock(&q->mtx);
+#endif
+#endif
+}
+
+/* Returns 0 if it can't wait (no threads) */
+static int utl_que_wait(que_t q, int d)
+{
+#ifdef UTL_THREADS
+  int k;
+#ifdef UTL_QUE_FUTEX
+  unsigned ev;
+#endif
+  
+  if (!q->wait) return 0;
+  for (k = 0; k < UTL_QUE_SPIN; k++)
+    if (utl_que_ready(q, d)) return 1;
+  
+  while (!utl_que_ready(q, d)) {
+#ifdef UTL_QUE_FUTEX
+    ev = utl_atomic_acquire(&q->ev[d]);
+    utl_atomic_add(&q->waiting[d], 1);
+    utl_atomic_fence();
+    if (!utl_que_ready(q, d))
+      syscall(SYS_futex, &q->ev[d], FUTEX_WAIT_PRIVATE, ev, NULL, NULL, 0);
+    utl_atomic_add(&q->waiting[d], -1);
+#else
+    pthread_mutex_lock(&q->mtx);
+    utl_atomic_add(&q->waiting[d], 1);
+    utl_atomic_fence();
+    if (!utl_que_ready(q, d)) pthread_cond_wait(&q->cond[d], &q->mtx);
+    utl_atomic_add(&q->waiting[d], -1);
+    pthread_mutex_unlock(&q->mtx);
+#endif
+  }
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+/* Copies 'n' elements between 'e' and the ring starting at index 'i' */
+static void utl_que_copy(que_t q, size_t i, void *e, size_t n, int put)
+{
+  size_t k = i & q->mask;
+  size_t m = q->mask + 1 - k;
+  char *p = q->buf + k * q->esz;
+  
+  if (m > n) m = n;
+  if (put) {
+    memcpy(p, e, m * q->esz);
+    if (n > m) memcpy(q->buf, (char *)e + m * q->esz, (n - m) * q->esz);
+  }
+  else {
+    memcpy(e, p, m * q->esz);
+    if (n > m) memcpy((char *)e + m * q->esz, q->buf, (n - m) * q->esz);
+  }
+}
+
+size_t utl_quePutN(que_t q, void *e, size_t n)
+{
+  size_t tail, room;
+  
+  if (!q || !e || n == 0) return 0;
+  tail = q->tail;
+  room = q->mask + 1 - (tail - q->head_cache);
+  if (room < n) {
+    q->head_cache = utl_atomic_acquire(&q->head);
+    room = q->mask + 1 - (tail - q->head_cache);
+  }
+  if (n > room) n = room;
+  if (n == 0) return 0;
+  
+  utl_que_copy(q, tail, e, n, 1);
+  utl_atomic_release(&q->tail, tail + n);
+  utl_que_wake(q, UTL_QUE_DATA);
+  return n;
+}
+
+size_t utl_queGetN(que_t q, void *e, size_t n)
+{
+  size_t head, avail;
+  
+  if (!q || !e || n == 0) return 0;
+  head = q->head;
+  avail = q->tail_cache - head;
+  if (avail < n) {
+    q->tail_cache = utl_atomic_acquire(&q->tail);
+    avail = q->tail_cache - head;
+  }
+  if (n > avail) n = avail;
+  if (n == 0) return 0;
+  
+  utl_que_copy(q, head, e, n, 0);
+  utl_atomic_release(&q->head, head + n);
+  utl_que_wake(q, UTL_QUE_ROOM);
+  return n;
+}
+
+size_t utl_quePutNWait(que_t q, void *e, size_t n)
+{
+  size_t k = 0;
+  
+  if (!q || !e) return 0;
+  while (k < n) {
+    k += utl_quePutN(q, (char *)e + k * q->esz, n - k);
+    if (k < n && !utl_que_wait(q, UTL_QUE_ROOM)) break;
+  }
+  return k;
+}
+
+size_t utl_queGetNWait(que_t q, void *e, size_t n)
+{
+  size_t k = 0;
+  
+  if (!q || !e || n == 0) return 0;
+  while ((k = utl_queGetN(q, e, n)) == 0)
+    if (!utl_que_wait(q, UTL_QUE_DATA)) break;
+  return k;
+}
+
+#undef UTL_QUE_DATA
+#undef UTL_QUE_ROOM
+
+int utl_bufSet(buf_t bf, size_t i, char c)
+{
+  char *s;
+
+  if (!utl_vec_expand(bf,i+1)) return 0;
+  s = bf->vec;
+  s[i] = c;
+  if (c == '\0') {
+    bf->cnt = i;
+  }
+  else if (i >= bf->cnt) {
+    s[i+1] = '\0';
+    bf->cnt = i+1;
+  }
+  return 1;
+}
+
+char utl_bufGet(buf_t bf, size_t i)
+{
+  if (!bf) return '\0';
+  if (i >= bf->cnt) return '\0';
+  return ((char*)(bf->vec))[i];
+}
+
+int utl_bufAdd(buf_t bf, char c)
+{  return utl_bufSet(bf,bf->cnt,c); }
+
+int utl_bufAddN(buf_t bf, char *s, size_t n)
+{
+  size_t off = 0;
+  int inside;
+  
+  if (!bf) return 0;
+  if (!s || n == 0) return 1;
+  
+  inside = (bf->vec && s >= (char *)bf->vec && s <= (char *)bf->vec + bf->cnt);
+  if (inside) off = s - (char *)bf->vec;
+  
+  if (!utl_vec_expand(bf, bf->cnt+n)) return 0;
+  if (inside) s = (char *)bf->vec + off;
+  
+  memmove((char *)bf->vec + bf->cnt, s, n);
+  bf->cnt += n;
+  ((char *)bf->vec)[bf->cnt] = '\0';
+  return 1;
+}
+
+int utl_bufAddStr(buf_t bf, char *s)
+{
+  if (!bf) return 0;
+  if (!s || !*s) return 1;
+  
+  return utl_bufAddN(bf, s, strlen(s));
+}
+
+/* A line in the file can be ended by '\r\n', '\n' or '\r'.
+** The NEWLINE characters are discarded.
+** The string in the buffer is terminated with '\n\0'. 
+*/
+int utl_bufAddLine(buf_t bf, FILE *f)
+{
+  int c = 0;
+  int n = 0;
+  do {
+    switch ((c = fgetc(f))) {
+      case '\r' : if ((c = fgetc(f)) != '\n') ungetc(c,f);
+      case '\n' :
+      case EOF  : c = EOF; utl_bufAdd(bf,'\n'); break;
+      default   : utl_bufAdd(bf,(char)c); n++; break;
+    }
+  } while (c != EOF);
+  return n;
+}
+
+int utl_bufAddFile(buf_t bf, FILE *f)
+{
+  int c = 0;
+  int n = 0;
+  do {
+    switch ((c = fgetc(f))) {
+      case EOF  : c = EOF; break;
+      default   : utl_bufAdd(bf,(char)c); n++; break;
+    }
+  } while (c != EOF);
+  return n;
+}
+
+
+/* {{ code from http://stackoverflow.com/questions/2915672 */
+#ifdef UTL_ADD_SNPRINTF
+
+inline int c99_snprintf(char* str, size_t size, const char* format, ...)
+{
+  int count;
+  va_list ap;
+  va_start(ap, format);
+  count = c99_vsnprintf(str, size, format, ap);
+  va_end(ap);
+  return count;
+}
+
+inline int c99_vsnprintf(char* str, size_t size, const char* format, va_list ap)
+{
+  int count = -1;
+  if (size != 0)   count = _vsnprintf_s(str, size, _TRUNCATE, format, ap);
+  if (count == -1) count = _vscprintf(format, ap);
+  return count;
+}
+#endif // UTL_ADD_SNPRINTF
+/* }} */
+
+#ifndef va_copy
+#ifdef __va_copy
+#define va_copy __va_copy
+#else
+#define va_copy(d,s) ((d) = (s))
+#endif
+#endif
+
+int utl_bufFormat(buf_t bf, char *format, ...)
+{
+  int count;
+  va_list ap, aq;
+
+  if (!bf) return -1;
+  
+  va_start(ap, format);
+  va_copy(aq, ap);  /* 'ap' can't be scanned twice */
+  count = vsnprintf(NULL,0,format, aq);
+  va_end(aq);
+  utl_bufSet(bf,count,'\0'); /* ensure there's enough room */
+  count = vsprintf(bufStr(bf),format, ap);
+  va_end(ap);
+  
+  return count;
+}
+
+#endif
+#endif /* UTL_NOADT */
+
+/*#define UTL_NOMATCH*/
+#ifndef UTL_NOMATCH
+
+/*
+  pmx = term
+  term = atom ('|' atom)*
+  atom = op? (class | char | '(' term ')' | '{' term '}')
+  class = '%' classid | '[' '^'? range+ ']' 
+  range = char | char '-' char
+  op = '*' | '?' | '+' | '!'
+  
+  %a alpha-numeric
+  %x hex digit
+  %d digit
+  %s space
+  %n newline
+  %w white space (no nl)
+  %l letter 
+  
+  %f floating point
+  %i integer
+  %b balanced
+  %e escape
+*/
+
+typedef struct {
+  char *orig_str;
+  char *orig_pat;
+  char *cur_str;
+  char *cur_pat;
+  int   cur_lvl;
+  int   nmatches;
+  char *matches[10][2];
+} pmx_t;
+
+#define cur_pat(p)   (p)->cur_pat
+#define adv_pat(p)   ((p)->cur_pat += 1)
+
+#define cur_str(p)   ((p)->cur_str)
+#define adv_str(p)   ((p)->cur_str += 1)
+
+#define cur_start(p) (p)->matches[(p)->cur_lvl][0]
+#define cur_end(p)   (p)->matches[(p)->cur_lvl][0]
+#define cur_level(p) (p)->cur_lvl
+
+int utl_pmxMatch(char *pat, char *str, pmx_t *p);
+#define pmxMatch utl_pmxMatch
+
+#ifdef UTL_LIB
+
+static utl_skipatom(pmx_t *p)
+{
+  char *pat = cur_pat(p);
+  int cnt = 0;
+  
+  if (!*pat) return;
+  if (strchr("*?+!",*pat)) pat++;
+  if (*pat == '%') { if (*++pat) pat++;}
+  else if (*pat == '[' ) {
+    if (*++pat == ']') *pat++;
+    while (*pat && *pat++ != ']') ;
+  } 
+  else if (*pat == '(') {
+    pat++;
+    while (*pat) {
+      if (*pat == '(') cnt++;
+      else if (*pat == ')') if (--cnt == 0) {pat++; break;}
+      pat++;
+    }
+  }
+  else pat++;
+  cur_pat(p) = pat;
+}
+
+static int utl_atom(pmx_t *p)
+{
+  int r = 0;
+  char *str = cur_str(p);
+  char *pat = cur_pat(p);
+  if (*pat == '\0') {r = 1; }
+  else if (*pat == '%') {
+    switch (*++pat) {
+      case 'd' : if (isdigit(*str)) {r = 1; str++;}  break;
+      case 'a' : if (isalpha(*str)) {r = 1; str++;}  break;
+    }
+  }
+  else {
+    if (*pat == *str) {r = 1;  str++;}
+    pat++;
+  }
+  if (r) {
+    if (cur_start(p) == NULL) cur_start(p) = cur_str(p);
+    cur_end(p) = str;
+    cur_str(p) = str;
+  }
+  p->cur_pat = pat;
+  return r;
+}
+
+static int utl_term(pmx_t *p)
+{
+  int r = 0;
+  char *old_pat = p->cur_pat;
+  do {
+    if (cur_pat(p)[0] == '|') p->cur_pat += 1;
+    r = utl_atom(p);
+  } while (r == 0 && cur_pat(p)[0] == '|');
+  while (cur_pat(p)[0] == '|') {
+    p->cur_pat += 1;
+    utl_skipatom(p);
+  }
+  return r;
+}
+
+int utl_pmxMatch(char *pat, char *str, pmx_t *p)
+{
+  int r;
+  p->nmatches = 0;
+  p->orig_str = str; p->cur_str = str;
+  p->orig_pat = pat; p->cur_pat = pat; 
+  cur_level(p) = 0;
+  cur_start(p) = NULL;
+  cur_end(p) = NULL;
+  r =utl_term(p);
+  return r;
+}
+#endif
+#endif /* UTL_NOMATCH */
+
+#endif /* UTL_H */
+
+/**************************************************************************/
+
@@ -0,0 +1,140 @@
+/* 
+**  (C) by Remo Dentato (rdentato@gmail.com)
+** 
+** This sofwtare is distributed under the terms of the BSD license:
+**   http://creativecommons.org/licenses/BSD/
+**   http://opensource.org/licenses/bsd-license.php 
+*/
+
+#define UTL_C
+#define UTL_MEMCHECK
+#define UTL_UNITTEST
+
+#include "utl.h"
+
+typedef struct {
+  int x; int y;
+} point;
+
+/* Live bytes reported for the site at line 'ln' of this file */
+size_t site_live(int ln)
+{
+  FILE *f;
+  char buf[256];
+  unsigned long live = 0, l;
+  int n;
+  
+  f = fopen("arena.log","w+");
+  utlMemReport(f, 0);
+  rewind(f);
+  while (fgets(buf, 256, f)) {
+    if (sscanf(buf, "%lu %*u %*u %*u utl_arena_ut.c:%d", &l, &n) == 2 && n == ln)
+      live = l;
+  }
+  fclose(f);
+  return live;
+}
+
+int main (int argc, char *argv[])
+{
+  arena_t a = NULL;
+  arena_mark_t m;
+  char *s, *t;
+  point *p = NULL, q;
+  vec_t v;
+  buf_t b;
+  int k, ok;
+  size_t used;
+  int ln;
+  
+  TSTPLAN("utl unit test: arena") {
+    logLevel(utlMemLog,"Warn");
+    
+    TSTSECTION("arena alloc") {
+      TSTCODE {
+        a = arenaNew(1024);
+      }
+      TSTNNULL("Arena created", a);
+      TSTEQINT("Nothing used", 0, arenaUsed(a));
+      TSTCODE {
+        s = arenaStrdup(a, "hello");
+        p = arenaAlloc(a, sizeof(point));
+      }
+      TST("Strdup", strcmp("hello", s) == 0);
+      TSTEQINT("Aligned", 0, (uintptr_t)p % UTL_ARENA_ALIGN);
+      TSTCODE {
+        ok = 1;
+        for (k = 0; k < 200; k++) {  /* more than one chunk */
+          p = arenaAlloc(a, sizeof(point));
+          if (!p) { ok = 0; break; }
+          p->x = k;
+        }
+      }
+      TSTEQINT("Many allocations", 1, ok);
+      TSTNEQPTR("New chunks", NULL, a->chunk->next);
+      TSTCODE {
+        t = arenaAlloc(a, 5000);   /* Larger than a chunk */
+        memset(t, 'x', 5000);
+      }
+      TSTNNULL("Large block", t);
+      TST("Old data kept", strcmp("hello", s) == 0);
+    }
+    
+    TSTSECTION("savepoints") {
+      TSTCODE {
+        arenaStrdup(a, "x");
+        used = arenaUsed(a);
+        m = arenaSave(a);
+        t = arenaAlloc(a, 100);
+        for (k = 0; k < 100; k++) arenaAlloc(a, 100);
+        arenaRollback(a, m);
+      }
+      TSTEQINT("Rolled back", used, arenaUsed(a));
+      TSTEQPTR("Memory reused", t, arenaAlloc(a, 100));
+      TSTCODE {
+        arenaReset(a);
+      }
+      TSTEQINT("Reset", 0, arenaUsed(a));
+      TSTEQPTR("One chunk left", NULL, a->chunk->next);
+    }
+    
+    TSTSECTION("memcheck") {
+      TSTCODE {
+        ln = __LINE__ + 1;
+        for (k = 0; k < 10; k++) arenaAlloc(a, 30);
+      }
+      TSTEQINT("Objects accounted at their site", 300, site_live(ln));
+      TSTCODE {
+        arenaReset(a);
+      }
+      TSTEQINT("Released on reset", 0, site_live(ln));
+      TSTCODE {
+        a = arenaFree(a);
+      }
+      TSTEQINT("All freed", 0, utlMemAllocated);
+    }
+    
+    TSTSECTION("vec and buf") {
+      TSTCODE {
+        a = arenaNew(0);
+        v = vecNewIn(a, point);
+        for (k = 0; k < 100; k++) {
+          q.x = k; q.y = -k;
+          vecAdd(v, &q);
+        }
+        p = vecGet(v, 99);
+        b = bufNewIn(a);
+        bufAddStr(b, "abc");
+        bufAddStr(b, "def");
+      }
+      TSTEQINT("Vec count", 100, vecCount(v));
+      TSTEQINT("Vec content", -99, p->y);
+      TST("Buf content", strcmp("abcdef", bufStr(b)) == 0);
+      TSTCODE {
+        v = vecFree(v);   /* no-op, freed with the arena */
+        a = arenaFree(a);
+      }
+      TSTEQINT("All freed", 0, utlMemAllocated);
+    }
+  }
+}
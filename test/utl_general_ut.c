@@ -1,40 +1,74 @@
-/* 
-**  (C) by Remo Dentato (rdentato@gmail.com)
-** 
-** This sofwtare is distributed under the terms of the BSD license:
-**   http://creativecommons.org/licenses/BSD/
-**   http://opensource.org/licenses/bsd-license.php 
-*/
-
-#define UTL_C
-#define UTL_UNITTEST
-
-#include "utl.h"
-
-FILE *f = NULL;
-char buf[512];
-int k=0;
-int c=0;
-
-int main (int argc, char *argv[])
-{
-
-  TSTPLAN("utl unit test: general") {
-  
-    TSTSECTION("General use constants") {
-      TSTGROUP("utlEmptyFun()") {
-        TSTNEQPTR("Is not NULL", NULL, utlEmptyFun );
-        TSTEQINT("Can be called", 0,utlEmptyFun());
-      }
-  
-      TSTGROUP("utlEmptyString") {
-        TSTNEQPTR("Is not NULL", NULL,utlEmptyString);
-        TSTEQINT("Is empty", '\0', utlEmptyString[0]);
-      }
-  
-      TSTGROUP("utlZero") {
-        TSTEQINT("Is zero", 0, utlZero);
-      }
-    }
-  }
-}
+/* 
+**  (C) by Remo Dentato (rdentato@gmail.com)
+** 
+** This sofwtare is distributed under the terms of the BSD license:
+**   http://creativecommons.org/licenses/BSD/
+**   http://opensource.org/licenses/bsd-license.php 
+*/
+
+#define UTL_C
+#define UTL_UNITTEST
+
+#include "utl.h"
+
+FILE *f = NULL;
+char buf[512];
+int k=0;
+int c=0;
+
+int main (int argc, char *argv[])
+{
+
+  TSTPLAN("utl unit test: general") {
+  
+    TSTSECTION("General use constants") {
+      TSTGROUP("utlEmptyFun()") {
+        TSTNEQPTR("Is not NULL", NULL, utlEmptyFun );
+        TSTEQINT("Can be called", 0,utlEmptyFun());
+      }
+  
+      TSTGROUP("utlEmptyString") {
+        TSTNEQPTR("Is not NULL", NULL,utlEmptyString);
+        TSTEQINT("Is empty", '\0', utlEmptyString[0]);
+      }
+  
+      TSTGROUP("utlZero") {
+        TSTEQINT("Is zero", 0, utlZero);
+      }
+    }
+
+    TSTSECTION("Clock") {
+      int64_t t1, t2;
+      
+      TSTGROUP("utlClock()") {
+        TSTCODE { t1 = utlClockUs(); t2 = (int64_t)time(NULL) * 1000000; }
+        TSTLTINT("Within one second of time()", (t1 > t2 ? t1-t2 : t2-t1), 1000001);
+        TSTCODE { t1 = utlElapsed(); t2 = utlElapsed(); }
+        TST("Elapsed is monotonic", t1 <= t2);
+      }
+      
+      TSTGROUP("utlTimestamp()") {
+        TSTCODE { t1 = 1234567890123456LL; k = utlTimestamp(buf, t1, UTL_TS_UTC | UTL_TS_USEC); }
+        TSTEQINT("UTC with usec", 0, strcmp(buf,"2009-02-13T23:31:30.123456Z"));
+        TSTFAILNOTE("Timestamp: [%s]",buf);
+        TSTEQINT("Length", 27, k);
+        TSTCODE { k = utlTimestamp(buf, t1+1, UTL_TS_UTC); }
+        TSTEQINT("Cached UTC", 0, strcmp(buf,"2009-02-13T23:31:30Z"));
+        TSTCODE { k = utlTimestamp(buf, t1, 0); }
+        TSTEQINT("Local time", 19, k);
+        TSTEQINT("Local time format", 0, buf[4] != '-' || buf[10] != ' ');
+      }
+    }
+
+    TSTSECTION("Aligned memory") {
+      TSTGROUP("utlMallocAligned()") {
+        char *p = NULL;
+        TSTCODE { p = utlMallocAligned(100, 64); }
+        TSTNNULL("Allocated", p);
+        TSTEQINT("Aligned to 64", 0, (uintptr_t)p % 64);
+        TSTNULL("Not a power of 2", utlMallocAligned(100, 24));
+        TSTCODE { memset(p, 0, 100); utlFreeAligned(p); }
+      }
+    }
+  }
+}
@@ -1,163 +1,753 @@
-/* 
-**  (C) by Remo Dentato (rdentato@gmail.com)
-** 
-** This sofwtare is distributed under the terms of the BSD license:
-**   http://creativecommons.org/licenses/BSD/
-**   http://opensource.org/licenses/bsd-license.php 
-*/
-
-#define UTL_C
-#define UTL_UNITTEST
-
-#include "utl.h"
-
-FILE *f = NULL;
-char buf[512];
-char *p;
-int k=0;
-int c=0;
-int enabled = 1;
-utlLogger lg = NULL;
-
-int main (int argc, char *argv[])
-{
-  TSTPLAN("utl test: logging") {
-    
-    TSTSECTION("Enabled") {
-        #ifdef UTL_NOLOGGING
-          enabled = 0;
-          TST("Compiled with logging disabled!",1);
-        #endif
-    }
-    
-    TSTSKIP(!enabled,"Logging disabled") {
-      TSTSECTION("NULL logger") {
-        lg = NULL;
-        TSTNULL("logger is NULL",  lg);
-        TSTEQPTR("log file is NULL", NULL,logFile(lg));
-        TSTEQINT("log is disabled", log_X , logLevel(lg,"?") );
-        TSTCODE {
-          logLevel(lg,"MSG");
-        } TSTEQINT("NULL logger level can't be changed", log_X, logLevel(lg,"") );
-      }
-      
-      TSTSECTION("stdout logger") {
-      
-        TSTCODE {
-          lg = logStdout;
-        } 
-        TSTNNULL("logger is not NULL",lg);
-        TSTEQPTR("log file is stdout", stdout,logFile(lg));
-        TSTEQINT("logLevel is Warn", log_W, logLevel(lg,"") );
-      
-        TSTCODE {
-          logLevel(lg,"Msg");
-        } TSTEQINT("Log level changed", log_M, logLevel(lg,"?") );
-        
-        TSTCODE {
-          k = 0;
-          logIf(lg,"Info")  { k+=1; } /* If level is at least INFO  */
-          logIf(lg,"Warn")  { k+=10; } /* If level is at least WARN  */
-          logIf(lg,"Error") { k+=100; } /* If level is at least ERROR */
-        } TSTEQINT("logLevel() and logIf()", 110, k );
-        
-        TSTCODE {
-          lg = logClose(lg);
-        }
-        TSTEQPTR("logger is NULL", NULL,lg);
-      }
-      
-      TSTSECTION("stderr logger") {
-      
-        TSTCODE {
-          lg = logStderr;
-        } 
-        TSTNNULL("logger is not NULL",lg);
-        #ifndef UTL_NOLOGGING
-        TSTFAILNOTE("&log_stderr = %p logStderr = %p",&utl_log_stderr,logStderr);
-        #endif
-        TSTEQPTR("log file is stderr", stderr,logFile(lg));
-        TSTEQINT("logLevel is Warn", log_W, logLevel(lg,"") );
-      
-        TSTCODE {
-          logLevel(lg,"Msg");
-        } TSTEQINT("Log level changed", log_M, logLevel(lg,"?") );
-        
-        TSTCODE {
-          k = 0;
-          logIf(lg,"Info")  { k+=1; } /* If level is at least INFO  */
-          logIf(lg,"Warn")  { k+=10; } /* If level is at least WARN  */
-          logIf(lg,"Error") { k+=100; } /* If level is at least ERROR */
-        } TSTEQINT("logLevel() and logIf()", 110, k );
-        
-        TSTCODE {
-          lg = logClose(lg);
-        }
-        TSTEQPTR("logger is NULL", NULL,lg);
-      }
-      
-      TSTSECTION("test.log") {
-      
-        TSTCODE {
-          lg = logOpen("test.log","w"); 
-        } 
-        TSTNNULL("logger is not NULL", lg);
-        TSTNNULL("log file is not NULL", logFile(lg));
-        TSTEQINT("logLevel is Warn", log_W, logLevel(lg,"") );
-      
-        TSTCODE {
-          logLevel(lg,"Msg");
-        } TSTEQINT("Log level changed", log_M, logLevel(lg,"") );
-        
-        TSTCODE {
-          k = 0;
-          logIf(lg,"Info")  { k+=1; } /* If level is at least INFO  */
-          logIf(lg,"Warn")  { k+=10; } /* If level is at least WARN  */
-          logIf(lg,"Error") { k+=100; } /* If level is at least ERROR */
-        } TSTEQINT("logLevel() and logIf()", 110, k );
-        
-        TSTCODE {
-          lg = logClose(lg);
-        }
-        TSTNULL("logger is NULL",lg);
-        
-        TSTCODE {
-          f = fopen("test.log","r");
-        }
-        TSTNNULL("file created",f);
-        if(f) fclose(f);
-      
-        TSTCODE {
-          lg = logOpen("test.log","a"); 
-          lg = logClose(lg);
-        } 
-        
-        TSTCODE {
-          f = fopen("test.log","r");
-        }
-        TSTNNULL("file still there",f);
-        
-        TSTCODE {
-          buf[0] = '\0';
-          if(f) fgets(buf,120,f);
-          p=buf;
-          while (*p && *p != '\n') p++; *p='\0';
-        }
-        TSTEQINT("Log creating ok",0,strcmp(buf+20,"LOG CREATED \"test.log\""));
-        TSTFAILNOTE("First line: [%s]",buf);
-        
-        TSTCODE {
-          buf[0] = '\0';
-          if(f) fgets(buf,120,f);
-          p=buf;
-          while (*p && *p != '\n') p++;
-          *p='\0';
-        }
-        TSTEQINT("Log appending ok",0,strcmp(buf+20,"LOG ADDEDTO \"test.log\""));
-        TSTFAILNOTE("Second line: [%s]",buf);
-        
-        if(f) fclose(f);
-      }
-    }
-  }
-}
+/* 
+**  (C) by Remo Dentato (rdentato@gmail.com)
+** 
+** This sofwtare is distributed under the terms of the BSD license:
+**   http://creativecommons.org/licenses/BSD/
+**   http://opensource.org/licenses/bsd-license.php 
+*/
+
+#define UTL_C
+#define UTL_UNITTEST
+
+#include "utl.h"
+
+#ifdef UTL_UNIX
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef UTL_LOG_LINEMAX   /* with UTL_NOLOGGING */
+#define UTL_LOG_LINEMAX 256
+#endif
+
+FILE *f = NULL;
+char buf[512];
+char fmtbuf[64];
+char *p;
+int k=0;
+int c=0;
+int enabled = 1;
+#ifdef UTL_THREADS
+int threads = 1;
+#else
+int threads = 0;
+#endif
+#ifdef UTL_UNIX
+int mmapped = 1;
+#else
+int mmapped = 0;
+#endif
+utlLogger lg = NULL;
+
+#define NTHREADS 32
+#define NLINES   500
+
+#ifdef UTL_THREADS
+static void *thread_log(void *arg)
+{
+  int n;
+  for (n=0; n<NLINES; n++)
+    logWarn(lg,"thread %p line %d %s", arg, n, "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx");
+  return NULL;
+}
+
+static void thread_test(utlLogger lg)
+{
+  pthread_t t[NTHREADS];
+  int n;
+  for (n=0; n<NTHREADS; n++) pthread_create(t+n, NULL, thread_log, t+n);
+  for (n=0; n<NTHREADS; n++) pthread_join(t[n], NULL);
+}
+
+/* Logs 1000 lines while the writer thread is stuck on the file lock.
+** Returns the lines written (-1 if out of order) and the reported drops.
+*/
+static int async_full(int policy, int *dropped)
+{
+  utlLogger lg;
+  int n;
+  
+  *dropped = 0;
+  lg = logOpen("async.log","w");
+  logAsync(lg,16,policy);
+  flockfile(logFile(lg));
+  for (n=0; n<1000; n++) logWarn(lg,"line %d",n);
+  funlockfile(logFile(lg));
+  logClose(lg);
+  
+  n = 0;
+  f = fopen("async.log","r");
+  if (f) {
+    while (fgets(buf,512,f)) {
+      if ((p = strstr(buf,"DROPPED ")) != NULL) *dropped += atoi(p+8);
+      else if (strncmp(buf+20,"WRN line ",9) != 0) continue;
+      else if (n >= 0 && atoi(buf+29) == n) n++;
+      else n = -1;
+    }
+    fclose(f);
+  }
+  return n;
+}
+#else
+#define thread_test(lg)
+#define async_full(p,d) 0
+#endif
+
+static int good_line(char *ln)
+{
+  void *t;
+  int n;
+  char x[64];
+  return sscanf(ln+24,"thread %p line %d %63s\n", &t, &n, x) == 3 && 
+         strcmp(x,"xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx") == 0 &&
+         ln[strlen(ln)-1] == '\n';
+}
+
+/* Minimal JSON parser for the flat objects written by logKV(): returns the
+** number of pairs or -1 if 's' is not a valid object.
+*/
+static char *json_ws(char *s) { while (*s == ' ' || *s == '\t') s++; return s; }
+
+static char *json_str(char *s)
+{
+  if (*s++ != '"') return NULL;
+  for (; *s && *s != '"'; s++) {
+    if ((unsigned char)*s < 0x20) return NULL;
+    if (*s == '\\' && !*++s) return NULL;
+  }
+  return *s == '"' ? s+1 : NULL;
+}
+
+static char *json_num(char *s)
+{
+  char *e;
+  if (*s == '-') s++;
+  if (!isdigit((int)*s)) return NULL;
+  strtod(s, &e);
+  return e;
+}
+
+static int json_object(char *s)
+{
+  int n = 0;
+  s = json_ws(s);
+  if (*s++ != '{') return -1;
+  s = json_ws(s);
+  if (*s == '}') return (*json_ws(s+1) == '\0' || *json_ws(s+1) == '\n') ? 0 : -1;
+  for (;;) {
+    if (!(s = json_str(json_ws(s)))) return -1;
+    s = json_ws(s);
+    if (*s++ != ':') return -1;
+    s = json_ws(s);
+    s = (*s == '"') ? json_str(s) : json_num(s);
+    if (!s) return -1;
+    n++;
+    s = json_ws(s);
+    if (*s == '}') break;
+    if (*s++ != ',') return -1;
+  }
+  s = json_ws(s+1);
+  return (*s == '\0' || *s == '\n') ? n : -1;
+}
+
+int main (int argc, char *argv[])
+{
+  TSTPLAN("utl test: logging") {
+    
+    TSTSECTION("Enabled") {
+        #ifdef UTL_NOLOGGING
+          enabled = 0;
+          TST("Compiled with logging disabled!",1);
+        #endif
+    }
+    
+    TSTSKIP(!enabled,"Logging disabled") {
+      TSTSECTION("NULL logger") {
+        lg = NULL;
+        TSTNULL("logger is NULL",  lg);
+        TSTEQPTR("log file is NULL", NULL,logFile(lg));
+        TSTEQINT("log is disabled", log_X , logLevel(lg,"?") );
+        TSTCODE {
+          logLevel(lg,"MSG");
+        } TSTEQINT("NULL logger level can't be changed", log_X, logLevel(lg,"") );
+      }
+      
+      TSTSECTION("stdout logger") {
+      
+        TSTCODE {
+          lg = logStdout;
+        } 
+        TSTNNULL("logger is not NULL",lg);
+        TSTEQPTR("log file is stdout", stdout,logFile(lg));
+        TSTEQINT("logLevel is Warn", log_W, logLevel(lg,"") );
+      
+        TSTCODE {
+          logLevel(lg,"Msg");
+        } TSTEQINT("Log level changed", log_M, logLevel(lg,"?") );
+        
+        TSTCODE {
+          k = 0;
+          logIf(lg,"Info")  { k+=1; } /* If level is at least INFO  */
+          logIf(lg,"Warn")  { k+=10; } /* If level is at least WARN  */
+          logIf(lg,"Error") { k+=100; } /* If level is at least ERROR */
+        } TSTEQINT("logLevel() and logIf()", 110, k );
+        
+        TSTCODE {
+          lg = logClose(lg);
+        }
+        TSTEQPTR("logger is NULL", NULL,lg);
+      }
+      
+      TSTSECTION("stderr logger") {
+      
+        TSTCODE {
+          lg = logStderr;
+        } 
+        TSTNNULL("logger is not NULL",lg);
+        #ifndef UTL_NOLOGGING
+        TSTFAILNOTE("&log_stderr = %p logStderr = %p",&utl_log_stderr,logStderr);
+        #endif
+        TSTEQPTR("log file is stderr", stderr,logFile(lg));
+        TSTEQINT("logLevel is Warn", log_W, logLevel(lg,"") );
+      
+        TSTCODE {
+          logLevel(lg,"Msg");
+        } TSTEQINT("Log level changed", log_M, logLevel(lg,"?") );
+        
+        TSTCODE {
+          k = 0;
+          logIf(lg,"Info")  { k+=1; } /* If level is at least INFO  */
+          logIf(lg,"Warn")  { k+=10; } /* If level is at least WARN  */
+          logIf(lg,"Error") { k+=100; } /* If level is at least ERROR */
+        } TSTEQINT("logLevel() and logIf()", 110, k );
+        
+        TSTCODE {
+          lg = logClose(lg);
+        }
+        TSTEQPTR("logger is NULL", NULL,lg);
+      }
+      
+      TSTSECTION("test.log") {
+      
+        TSTCODE {
+          lg = logOpen("test.log","w"); 
+        } 
+        TSTNNULL("logger is not NULL", lg);
+        TSTNNULL("log file is not NULL", logFile(lg));
+        TSTEQINT("logLevel is Warn", log_W, logLevel(lg,"") );
+      
+        TSTCODE {
+          logLevel(lg,"Msg");
+        } TSTEQINT("Log level changed", log_M, logLevel(lg,"") );
+        
+        TSTCODE {
+          k = 0;
+          logIf(lg,"Info")  { k+=1; } /* If level is at least INFO  */
+          logIf(lg,"Warn")  { k+=10; } /* If level is at least WARN  */
+          logIf(lg,"Error") { k+=100; } /* If level is at least ERROR */
+        } TSTEQINT("logLevel() and logIf()", 110, k );
+        
+        TSTCODE {
+          lg = logClose(lg);
+        }
+        TSTNULL("logger is NULL",lg);
+        
+        TSTCODE {
+          f = fopen("test.log","r");
+        }
+        TSTNNULL("file created",f);
+        if(f) fclose(f);
+      
+        TSTCODE {
+          lg = logOpen("test.log","a"); 
+          lg = logClose(lg);
+        } 
+        
+        TSTCODE {
+          f = fopen("test.log","r");
+        }
+        TSTNNULL("file still there",f);
+        
+        TSTCODE {
+          buf[0] = '\0';
+          if(f) fgets(buf,120,f);
+          p=buf;
+          while (*p && *p != '\n') p++; *p='\0';
+        }
+        TSTEQINT("Log creating ok",0,strcmp(buf+20,"LOG CREATED \"test.log\""));
+        TSTFAILNOTE("First line: [%s]",buf);
+        
+        TSTCODE {
+          buf[0] = '\0';
+          if(f) fgets(buf,120,f);
+          p=buf;
+          while (*p && *p != '\n') p++;
+          *p='\0';
+        }
+        TSTEQINT("Log appending ok",0,strcmp(buf+20,"LOG ADDEDTO \"test.log\""));
+        TSTFAILNOTE("Second line: [%s]",buf);
+        
+        if(f) fclose(f);
+      }
+
+      TSTSECTION("binary log") {
+        TSTCODE {
+          lg = logOpen("binlog.tmp","wb");
+        }
+        TSTNNULL("logger is not NULL", lg);
+        TSTCODE {
+          logPre(lg,"bin");
+          logWarn(lg,"int %d str %s dbl %.2f",12,"abc",3.14159);
+          logWarn(lg,"%5s|%-4ld|%*d|%%|%c",  "xy", 123456789L, 3, 7, 'z');
+          logInfo(lg,"not logged");
+          logWContinue(lg,"%zu", (size_t)42);
+          strcpy(fmtbuf, "first %d");
+          logWarn(lg, fmtbuf, 1);
+          strcpy(fmtbuf, "second %s");
+          logWarn(lg, fmtbuf, "x");
+          logWarn(lg, "wide %ls %lc|%3lc", L"string", (wint_t)L'w', (wint_t)L'c');
+          lg = logClose(lg);
+        }
+        TSTNULL("logger is NULL",lg);
+
+        TSTCODE {
+          f = fopen("binlog.tmp","rb");
+          c = -1;
+          if (f) {
+            FILE *o = fopen("binlog.log","w");
+            if (o) { c = logDecode(f,o); fclose(o); }
+            fclose(f);
+          }
+        }
+        TSTEQINT("Messages decoded", 7, c);
+
+        TSTCODE {
+          f = fopen("binlog.log","r");
+          buf[0] = '\0';
+          if (f) {
+            fgets(buf,512,f);  /* CREATED */
+            fgets(buf,512,f);
+          }
+        }
+        TSTEQINT("Prefix and level", 0, strncmp(buf,"bin ",4) || strncmp(buf+24,"WRN ",4));
+        TSTEQINT("Message decoded", 0, strcmp(buf+28,"int 12 str abc dbl 3.14\n"));
+        TSTFAILNOTE("Line: [%s]",buf);
+        TSTCODE {
+          buf[0] = '\0';
+          if (f) fgets(buf,512,f);
+        }
+        TSTEQINT("Width and precision", 0, strcmp(buf+28,"   xy|123456789|  7|%|z\n"));
+        TSTFAILNOTE("Line: [%s]",buf);
+        TSTCODE {
+          buf[0] = '\0';
+          if (f) fgets(buf,512,f);
+        }
+        TSTEQINT("Continuation", 0, strcmp(buf,"bin                     WRN 42\n"));
+        TSTCODE {
+          buf[0] = '\0';
+          if (f) fgets(buf,512,f);
+        }
+        TSTEQINT("Format in a buffer", 0, strcmp(buf+28,"first 1\n"));
+        TSTFAILNOTE("Line: [%s]",buf);
+        TSTCODE {
+          buf[0] = '\0';
+          if (f) fgets(buf,512,f);
+        }
+        TSTEQINT("Buffer reused", 0, strcmp(buf+28,"second x\n"));
+        TSTFAILNOTE("Line: [%s]",buf);
+        TSTCODE {
+          buf[0] = '\0';
+          if (f) fgets(buf,512,f);
+        }
+        TSTEQINT("Wide strings", 0, strcmp(buf+28,"wide string w|  c\n"));
+        TSTFAILNOTE("Line: [%s]",buf);
+        if (f) fclose(f);
+        TSTCODE {
+          uint32_t id = 0xFFFFFFF0;
+          uint16_t len = 2;
+          FILE *o;
+          c = 0;
+          f = fopen("binlog.tmp","rb");
+          o = fopen("badlog.tmp","wb");
+          if (f && o && fread(buf,1,12,f) == 12) {  /* signature and BOM */
+            fwrite(buf,1,12,o);
+            fputc('F',o);  fwrite(&id,4,1,o);  fwrite(&len,2,1,o);  fwrite("ab",1,2,o);
+            fclose(o);  o = NULL;
+            f = freopen("badlog.tmp","rb",f);
+            if (f) c = logDecode(f,stdout);
+          }
+          if (o) fclose(o);
+          if (f) fclose(f);
+        }
+        TSTEQINT("Corrupted format id", -1, c);
+      }
+
+      TSTSECTION("timestamps") {
+        TSTCODE {
+          lg = logOpen("tstamp.log","w");
+          logTimestamp(lg, UTL_LOG_USEC | UTL_LOG_UTC);
+          logWarn(lg,"utc");
+          logWContinue(lg,"more");
+          lg = logClose(lg);
+          f = fopen("tstamp.log","r");
+          buf[0] = '\0';
+          if (f) {
+            fgets(buf,512,f);  /* CREATED */
+            fgets(buf,512,f);
+          }
+        }
+        TSTEQINT("ISO-8601 UTC", 0, buf[10] != 'T' || buf[19] != '.' || buf[26] != 'Z');
+        TSTEQINT("Message", 0, strcmp(buf+28,"WRN utc\n"));
+        TSTFAILNOTE("Line: [%s]",buf);
+        TSTCODE {
+          buf[0] = '\0';
+          if (f) fgets(buf,512,f);
+        }
+        TSTEQINT("Blank timestamp", 0, strcmp(buf,"                            WRN more\n"));
+        TSTFAILNOTE("Line: [%s]",buf);
+        if (f) fclose(f);
+      }
+
+      TSTSECTION("rotate") {
+        TSTCODE {
+          remove("rotate_001.log"); remove("rotate_002.log"); remove("rotate_003.log");
+          lg = logOpen("rotate.log","w");
+        }
+        TSTEQINT("Can't rotate stderr", 0, logRotate(logStderr,100,0,2));
+        TSTEQINT("Rotation on", 1, logRotate(lg,100,0,2));
+        TSTCODE {
+          for (k=0; k<20; k++) logWarn(lg,"line %d",k);
+          lg = logClose(lg);
+        }
+        TSTCODE {
+          f = fopen("rotate_002.log","r");
+          k = (f != NULL);
+          if (f) fclose(f);
+        }
+        TSTEQINT("Second rotated file exists", 1, k);
+        TSTCODE {
+          f = fopen("rotate_003.log","r");
+          k = (f != NULL);
+          if (f) fclose(f);
+        }
+        TSTEQINT("Only two files kept", 0, k);
+        TSTCODE {
+          f = fopen("rotate.log","r");
+          c = 0;
+          buf[0] = '\0';
+          if (f) {
+            while (fgets(buf,512,f)) c++;
+            fclose(f);
+          }
+        }
+        TSTGTINT("Current log is small", 4, c);
+        TSTEQINT("Last line in current log", 0, strcmp(buf+29,"19\n"));
+        TSTFAILNOTE("Last line: [%s]",buf);
+      }
+
+      TSTSECTION("rate limiting") {
+        TSTCODE {
+          lg = logOpen("rate.log","w");
+          for (k=0; k<100; k++) {
+            logEvery(lg, 10, log_W, "every %d", k);
+            logEveryMs(lg, 3600000, log_W, "everyms %d", k);
+            logSample(lg, 0.0, log_W, "never %d", k);
+            logSample(lg, 1.0, log_W, "always %d", k);
+            logEvery(lg, 10, log_D, "debug %d", k);
+            logEvery(lg, 0, log_W, "zero %d", k);
+          }
+          lg = logClose(lg);
+        }
+        TSTCODE {
+          int every = 0, everyms = 0, never = 0, always = 0, supp = 0, debug = 0, zero = 0;
+          f = fopen("rate.log","r");
+          if (f) {
+            while (fgets(buf,512,f)) {
+              if (strncmp(buf+24, "every ", 6) == 0) every++;
+              else if (strncmp(buf+24, "everyms ", 8) == 0) everyms++;
+              else if (strncmp(buf+24, "never ", 6) == 0) never++;
+              else if (strncmp(buf+24, "always ", 7) == 0) always++;
+              else if (strncmp(buf+24, "debug ", 6) == 0) debug++;
+              else if (strncmp(buf+24, "zero ", 5) == 0) zero++;
+              else if (strcmp(buf+24, "(suppressed 9 similar messages)\n") == 0) supp++;
+            }
+            fclose(f);
+          }
+          c = every * 1000000 + everyms * 10000 + never * 1000 + debug * 100 + supp;
+          c += zero * 100000000;
+          k = always;
+        }
+        TSTEQINT("One in ten, once per hour, never (also every 0)", 10010009, c);
+        TSTEQINT("Sampling always", 100, k);
+      }
+
+      TSTSECTION("key/value") {
+        TSTCODE {
+          k = 0;
+          lg = logOpen("kv.log","w");
+          logPre(lg,"kv");
+          logKV(lg, log_W, "login", "user", "%s", "John \"Doe\"", "ms", "%d", 12,
+                                    "ratio", "%.2f", 0.5, "id", "%s", "a=b");
+          logKV(lg, log_D, "hidden", "n", "%d", k++);
+          logKVFormat(lg, UTL_LOG_JSON);
+          logKV(lg, log_W, "login", "user", "%s", "Jo\tDoe", "ms", "%5d", 12, "hex", "%x", 255);
+          lg = logClose(lg);
+        }
+        TSTCODE {
+          f = fopen("kv.log","r");
+          buf[0] = '\0';
+          if (f) { fgets(buf,512,f); fgets(buf,512,f); }
+        }
+        TSTEQINT("logfmt", 0, strcmp(buf+27,
+                 "event=login user=\"John \\\"Doe\\\"\" ms=12 ratio=0.50 id=\"a=b\"\n"));
+        TSTFAILNOTE("Line: [%s]",buf);
+        TSTCODE {
+          buf[0] = '\0';
+          if (f) { fgets(buf,512,f); fclose(f); }
+        }
+        TSTEQINT("JSON", 0, strcmp(buf+27,
+                 "{\"event\":\"login\",\"user\":\"Jo\\tDoe\",\"ms\":   12,\"hex\":\"ff\"}\n"));
+        TSTFAILNOTE("Line: [%s]",buf);
+        TSTEQINT("Disabled level not evaluated", 0, k);
+        TSTCODE {
+          char big[2*UTL_LOG_LINEMAX];
+          memset(big, 'x', sizeof(big)-1);
+          big[sizeof(big)-1] = '\0';
+          lg = logOpen("kv.log","w");
+          logKVFormat(lg, UTL_LOG_JSON);
+          logKV(lg, log_W, "big", "key1", "%s", "short", "key2", "%s", big, "key3", "%d", 3);
+          logKV(lg, log_W, "big", "key1", "%s", big + UTL_LOG_LINEMAX + 30, "key2", "%s", "hello");
+          logKV(lg, log_W, big, "key1", "%d", 1);
+          lg = logClose(lg);
+          f = fopen("kv.log","r");
+          buf[0] = '\0';
+          if (f) { fgets(buf,512,f); fgets(buf,512,f); }
+        }
+        TSTEQINT("Value too long, valid JSON", 2, json_object(strchr(buf,'{') ? strchr(buf,'{') : buf));
+        TSTFAILNOTE("Line: [%s]",buf);
+        TST("Following pairs dropped", strstr(buf, "key2") == NULL && strstr(buf, "key3") == NULL);
+        TSTCODE {
+          buf[0] = '\0';
+          if (f) fgets(buf,512,f);
+        }
+        TSTEQINT("Value almost too long, valid JSON", 2, json_object(strchr(buf,'{') ? strchr(buf,'{') : buf));
+        TSTFAILNOTE("Line: [%s]",buf);
+        TST("Pair not fitting dropped", strstr(buf, "key2") == NULL);
+        TSTCODE {
+          buf[0] = '\0';
+          if (f) { fgets(buf,512,f); fclose(f); }
+        }
+        TSTEQINT("Event too long, valid JSON", 2, json_object(strchr(buf,'{') ? strchr(buf,'{') : buf));
+        TSTFAILNOTE("Line: [%s]",buf);
+      }
+
+      TSTSECTION("named loggers") {
+        utlLogger parser = NULL, http = NULL, sink = NULL;
+        static char env[] = "UTL_LOGCFG=error,db=info,db.sql=debug";
+        TSTCODE {
+          parser = logGet("net.http.parser");
+          http = logGet("net.http");
+        }
+        TSTNNULL("Logger created", parser);
+        TSTEQPTR("Same name, same logger", http, logGet("net.http"));
+        TSTEQINT("Default level", log_W, logLevel(parser,"?"));
+        TSTCODE {
+          logConfig("net", "Debug");
+        }
+        TSTEQINT("Inherited level", log_D, logLevel(parser,"?"));
+        TSTCODE {
+          logConfig("net.http", "Error");
+        }
+        TSTEQINT("Closest parent", log_E, logLevel(parser,"?"));
+        TSTEQINT("Parent unchanged", log_D, logLevel(logGet("net"),"?"));
+        TSTCODE {
+          logConfig("net.http", NULL);
+        }
+        TSTEQINT("Inherit again", log_D, logLevel(parser,"?"));
+        TSTCODE {
+          putenv(env);
+          k = logConfigEnv("UTL_LOGCFG", "warn");
+        }
+        TSTEQINT("Config from env", 3, k);
+        TSTEQINT("Root level", log_E, logLevel(logGet(""),"?"));
+        TSTEQINT("Env level", log_D, logLevel(logGet("db.sql.query"),"?"));
+        TSTCODE {
+          sink = logOpen("named.log","w");
+          logSink("net", sink);
+          logConfig("net", "Info");
+          logDebug(parser, "not logged");
+          logInfo(parser, "logged %d", 1);
+          logError(logGet("db"), "not here");
+          logSink("net", NULL);
+          sink = logClose(sink);
+          TSTEQPTR("Close does nothing", NULL, logClose(parser));
+        }
+        TSTCODE {
+          f = fopen("named.log","r");
+          c = 0;
+          if (f) {
+            fgets(buf,512,f);  /* CREATED */
+            while (fgets(buf,512,f)) c++;
+            fclose(f);
+          }
+        }
+        TSTEQINT("One line written", 1, c);
+        TSTEQINT("Name as prefix", 0, strncmp(buf,"net.http.parser ",16) || strcmp(buf+36,"INF logged 1\n"));
+        TSTFAILNOTE("Line: [%s]",buf);
+      }
+
+      TSTSECTION("threads") {
+        TSTSKIP(!enabled || !threads,"Compiled without threads") {
+          TSTCODE {
+            for (k=1; k<=9; k++) { sprintf(buf,"threads_%03d.log",k); remove(buf); }
+            lg = logOpen("threads.log","w");
+            logRotate(lg,500000,0,9);   /* ~1.5MB of lines: all rotated files kept */
+            thread_test(lg);
+            lg = logClose(lg);
+          }
+          TSTCODE {
+            int n;
+            char fname[32];
+            c = 0; k = 0;
+            for (n=9; n>=0; n--) {
+              if (n > 0) sprintf(fname,"threads_%03d.log",n);
+              else strcpy(fname,"threads.log");
+              f = fopen(fname,"r");
+              if (!f) continue;
+              while (fgets(buf,512,f)) {
+                if (strncmp(buf+20,"LOG ",4) == 0) continue;  /* CREATED */
+                if (!good_line(buf)) k++;
+                c++;
+              }
+              fclose(f);
+            }
+            f = fopen("threads_002.log","r");
+            if (f) fclose(f);
+          }
+          TSTNNULL("Rotated more than once", f);
+          TSTEQINT("All lines written (across rotation)", NTHREADS * NLINES, c);
+          TSTEQINT("No mixed lines", 0, k);
+        }
+      }
+
+      TSTSECTION("async") {
+        #ifndef UTL_THREADS
+        TSTCODE {
+          lg = logStderr;
+        }
+        TSTEQINT("Async needs threads", 0, logAsync(lg,16,UTL_LOG_BLOCK));
+        #endif
+        TSTSKIP(!enabled || !threads,"Compiled without threads") {
+          TSTCODE {
+            lg = logOpen("async.log","w");
+          }
+          TSTNNULL("logger is not NULL", lg);
+          TSTEQINT("Async mode on", 1, logAsync(lg,16,UTL_LOG_BLOCK));
+          TSTEQINT("Async mode only once", 0, logAsync(lg,16,UTL_LOG_BLOCK));
+
+          TSTCODE {
+            for (k=0; k<1000; k++) logWarn(lg,"line %d",k);
+            lg = logClose(lg);
+          }
+          TSTNULL("logger is NULL",lg);
+
+          TSTCODE {
+            c = 0; k = 0;
+            f = fopen("async.log","r");
+            if (f) {
+              while (fgets(buf,512,f)) {
+                if (c > 0 && strtol(buf+29,NULL,10) != c-1) k++;
+                c++;
+              }
+              fclose(f);
+            }
+          }
+          TSTEQINT("All lines drained", 1001, c);
+          TSTEQINT("Lines are in order", 0, k);
+
+          TSTGROUP("UTL_LOG_DROP") {
+            TSTCODE {
+              c = async_full(UTL_LOG_DROP, &k);
+            }
+            TSTGTINT("Lines in order", c, 0);
+            TSTLEINT("Ring full, lines dropped", c, 16);
+            TSTEQINT("Drops not reported", 0, k);
+          }
+          TSTGROUP("UTL_LOG_COUNT") {
+            TSTCODE {
+              c = async_full(UTL_LOG_COUNT, &k);
+            }
+            TSTGTINT("Lines in order", c, 0);
+            TSTLEINT("Ring full, lines dropped", c, 16);
+            TSTEQINT("Drops counted", 1000 - c, k);
+          }
+        }
+      }
+
+      TSTSECTION("ring log") {
+        TSTSKIP(!enabled || !mmapped,"No memory mapped files") {
+          TSTCODE {
+            remove("ring.tmp");
+            lg = logOpenRing("ring.tmp", 4096);
+          }
+          TSTEQINT("Ring logger opened", 1, lg != NULL && lg != logStderr);
+          TSTCODE {
+            for (k=0; k<100; k++) logWarn(lg,"ring line %03d",k);
+            lg = logClose(lg);
+            lg = logOpenRing("ring.tmp", 4096);  /* goes on where it stopped */
+            for (k=100; k<200; k++) logWarn(lg,"ring line %03d",k);
+            lg = logClose(lg);
+          }
+          TSTCODE {
+            f = fopen("ring.tmp","rb");
+            c = -1;
+            if (f) {
+              FILE *o = fopen("ring.log","w");
+              if (o) { c = logDecode(f,o); fclose(o); }
+              fclose(f);
+            }
+          }
+          TSTGTINT("Oldest lines overwritten", 200, c);
+          TSTCODE {
+            int prev = -1;
+            k = 0;
+            f = fopen("ring.log","r");
+            if (f) {
+              while (fgets(buf,512,f)) {
+                if (strncmp(buf+20,"WRN ring line ",14) != 0) continue;
+                if (prev >= 0 && atoi(buf+34) != prev+1) k++;
+                prev = atoi(buf+34);
+              }
+              fclose(f);
+            }
+          }
+          TSTEQINT("Lines in order", 0, k);
+          TSTEQINT("Last line", 199, c > 0 ? atoi(buf+34) : -1);
+          TSTFAILNOTE("Line: [%s]",buf);
+        }
+      }
+
+      TSTSECTION("rotate failure") {
+        TSTSKIP(!enabled || !mmapped,"Needs a unix file system") {
+          TSTCODE {
+#ifdef UTL_UNIX
+            mkdir("rotdir", 0755);
+            lg = logOpen("rotdir/rotate.log","w");
+            k = logRotate(lg,100,0,1);
+            remove("rotdir/rotate.log");
+            rmdir("rotdir");      /* nowhere to open the new file */
+            for (c=0; c<5; c++) logWarn(lg,"rotate failure line %d (expected on stderr)",c);
+#endif
+          }
+          TSTEQINT("Rotation on", 1, k);
+          TSTEQINT("Falls back to stderr", 1, logFile(lg) == stderr);
+          TSTEQINT("Rotation off", 0, logRotate(lg,100,0,1));
+          TSTCODE {
+            logWarn(lg,"still alive");
+            lg = logClose(lg);
+          }
+        }
+      }
+    }
+  }
+}
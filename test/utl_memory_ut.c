@@ -1,67 +1,513 @@
-/* 
-**  (C) by Remo Dentato (rdentato@gmail.com)
-** 
-** This sofwtare is distributed under the terms of the BSD license:
-**   http://creativecommons.org/licenses/BSD/
-**   http://opensource.org/licenses/bsd-license.php 
-*/
-
-#define UTL_C
-#define UTL_MEMCHECK
-#define UTL_UNITTEST
-
-#include "utl.h"
-
-int main (int argc, char *argv[])
-{
-  char *ptr_a;
-  char *ptr_b;
-  int valid;
-  int k;
-  
-  TSTPLAN("utl unit test: memory check") {
-    utlMemLog = logOpen("memory.log","w");
-    logLevel(utlMemLog,"Info");
-
-    TSTSECTION("malloc") {
-      TSTGROUP("malloc") {
-        TSTCODE { ptr_a = malloc(32); }
-        TSTEQINT("Check Valid after malloc()",utlMemValid,utlMemCheck(ptr_a) );
-        TSTEQINT("Allocated memory is 32",32, utlMemAllocated);
-        
-        TSTCODE { free(ptr_a); }
-        TSTNEQINT("Check invalid after free", utlMemValid, utlMemCheck(ptr_a));
-        TSTEQINT("Allocated memory is 0",0,utlMemAllocated);
-        
-        TSTCODE { free(ptr_a); }
-        TSTNEQINT("Check invalid again",utlMemValid,utlMemCheck(ptr_a));
-        
-        TSTCODE { ptr_a = malloc(0); }
-        TSTEQINT("Check Valid after malloc(0)",utlMemValid,utlMemCheck(ptr_a) );
-        TSTCODE { free(ptr_a); }
-      }
-      
-      TSTGROUP("calloc") {
-        TSTCODE { ptr_a = calloc(8,4); }
-        TSTEQINT("Allocated 8x4 ", utlMemValid,utlMemCheck(ptr_a) );
-        TSTCODE {for (k=0,valid=0; k<32; k++) valid += ptr_a[k];} 
-        TSTEQINT("Memory is clear",0, valid);
-        TSTCODE { free(ptr_a); }
-      }
-      
-      TSTGROUP("overrun memory") {
-        TSTCODE { ptr_a = malloc(16);  }
-        TSTEQINT("Check Valid after malloc()",utlMemValid,utlMemCheck(ptr_a));
-        TSTEQINT("Allocated memory is 16",16,utlMemAllocated);
-        
-        TSTCODE { ptr_a[16] = '\0'; }
-        TSTEQINT("Check invalid after overrun",utlMemOverflow ,utlMemCheck(ptr_a) );
-        TSTCODE { free(ptr_a); }
-      
-      }
-    }
-    TSTNOTE("Check the file 'memory.log' to see the log of traced allocations");
-  }
-  
-  logClose(utlMemLog);
+/* 
+**  (C) by Remo Dentato (rdentato@gmail.com)
+** 
+** This sofwtare is distributed under the terms of the BSD license:
+**   http://creativecommons.org/licenses/BSD/
+**   http://opensource.org/licenses/bsd-license.php 
+*/
+
+#define UTL_C
+#define UTL_MEMCHECK
+#define UTL_UNITTEST
+
+#include "utl.h"
+
+#ifdef UTL_UNIX
+#include <sys/wait.h>
+int paged = 1;
+#else
+int paged = 0;
+#endif
+
+#ifdef UTL_THREADS
+int threads = 1;
+#else
+int threads = 0;
+#endif
+
+#define NTHREADS 4
+
+void *churn(void *arg)
+{
+  char **blk = arg;
+  int k, j;
+  
+  for (k = 0; k < 1000; k++) {
+    for (j = 0; j < 10; j++) blk[j] = malloc(j+1);
+    for (j = 0; j < 10; j++) blk[j] = realloc(blk[j], 2*(j+1));
+    if (k < 999) for (j = 0; j < 10; j++) free(blk[j]);
+  }
+  return NULL;
+}
+
+#define NBLOCKS 600
+
+void *release(void *arg)
+{
+  char **blk = arg;
+  int k;
+  
+  for (k = 0; k < NBLOCKS; k++) free(blk[k]);
+  return NULL;
+}
+
+/* Runs memtrace on 'fname' and gets the last point of the heap timeline.
+** Returns -1 if memtrace reports an error.
+*/
+int memtrace(char *fname, double *ms, long *live, long *blocks)
+{
+  int ret = 0;
+#ifdef UTL_UNIX
+  FILE *p;
+  char cmd[256];
+  char line[512];
+  double t;
+  long l, b;
+  
+  sprintf(cmd, "../src/memtrace.exe %s 2>/dev/null", fname);
+  p = popen(cmd, "r");
+  if (!p) return 0;
+  while (fgets(line, 512, p)) {
+    if (strncmp(line, "# Peak", 6) == 0) break;
+    if (line[0] != '#' && sscanf(line, "%lf %ld %ld", &t, &l, &b) == 3) {
+      *ms = t;  *live = l;  *blocks = b;
+      ret = 1;
+    }
+  }
+  while (fgets(line, 512, p)) ;
+  if (pclose(p) != 0) ret = -1;
+#endif
+  return ret;
+}
+
+int main (int argc, char *argv[])
+{
+  char *ptr_a;
+  char *ptr_b;
+  int valid;
+  int k;
+  
+  TSTPLAN("utl unit test: memory check") {
+    utlMemLog = logOpen("memory.log","w");
+    logLevel(utlMemLog,"Info");
+
+    TSTSECTION("malloc") {
+      TSTGROUP("malloc") {
+        TSTCODE { ptr_a = malloc(32); }
+        TSTEQINT("Check Valid after malloc()",utlMemValid,utlMemCheck(ptr_a) );
+        TSTEQINT("Allocated memory is 32",32, utlMemAllocated);
+        
+        TSTCODE { free(ptr_a); }
+        TSTNEQINT("Check invalid after free", utlMemValid, utlMemCheck(ptr_a));
+        TSTEQINT("Allocated memory is 0",0,utlMemAllocated);
+        
+        TSTCODE { free(ptr_a); }
+        TSTNEQINT("Check invalid again",utlMemValid,utlMemCheck(ptr_a));
+        
+        TSTCODE { ptr_a = malloc(0); }
+        TSTEQINT("Check Valid after malloc(0)",utlMemValid,utlMemCheck(ptr_a) );
+        TSTCODE { free(ptr_a); }
+      }
+      
+      TSTGROUP("calloc") {
+        TSTCODE { ptr_a = calloc(8,4); }
+        TSTEQINT("Allocated 8x4 ", utlMemValid,utlMemCheck(ptr_a) );
+        TSTCODE {for (k=0,valid=0; k<32; k++) valid += ptr_a[k];} 
+        TSTEQINT("Memory is clear",0, valid);
+        TSTCODE { free(ptr_a); }
+      }
+      
+      TSTGROUP("overrun memory") {
+        TSTCODE { ptr_a = malloc(16);  }
+        TSTEQINT("Check Valid after malloc()",utlMemValid,utlMemCheck(ptr_a));
+        TSTEQINT("Allocated memory is 16",16,utlMemAllocated);
+        
+        TSTCODE { ptr_a[16] = '\0'; }
+        TSTEQINT("Check invalid after overrun",utlMemOverflow ,utlMemCheck(ptr_a) );
+        TSTCODE { free(ptr_a); }
+      
+      }
+    }
+    TSTSECTION("allocation sites") {
+      char *blk[4];
+      FILE *f;
+      char ln[256];
+      unsigned long live[2] = {0,0}, blocks[2] = {0,0};
+      TSTCODE {
+        for (k=0; k<3; k++) blk[k] = malloc(100);
+        blk[3] = malloc(1000);
+        free(blk[0]);
+        f = fopen("memsites.log","w+");
+        utlMemReport(f, 2);
+        rewind(f);
+        fgets(ln, 256, f);  /* header */
+        for (k=0; k<2 && fgets(ln, 256, f); k++)
+          sscanf(ln, "%lu %lu", live+k, blocks+k);
+        fclose(f);
+        for (k=1; k<4; k++) free(blk[k]);
+      }
+      TSTEQINT("Biggest site first", 1000, live[0]);
+      TSTEQINT("Live blocks",        2,    blocks[1]);
+      TSTEQINT("Freed blocks removed", 200, live[1]);
+      TSTEQINT("Data is aligned", 0, (int)((uintptr_t)blk[3] & 15));
+    }
+    TSTSECTION("leaks") {
+      FILE *f;
+      char ln[256];
+      TSTCODE {
+        utlMemTrack(1);
+        ptr_a = malloc(10);
+        ptr_b = malloc(20);
+        ptr_a = realloc(ptr_a, 1000);
+      }
+      TSTEQINT("Two live blocks", 2, utlMemLeaks(NULL));
+      TSTCODE {
+        free(ptr_a);
+        f = fopen("memleaks.log","w+");
+        k = utlMemLeaks(f);
+        rewind(f);
+        ln[0] = '\0';
+        fgets(ln, 256, f);
+        fclose(f);
+      }
+      TSTEQINT("One leak", 1, k);
+      TSTEQINT("Leak report", 0, strncmp(ln, "# 1 block (20 bytes) not freed, allocated at ", 45));
+      TSTFAILNOTE("Line: [%s]", ln);
+      TSTEQINT("No corruption", 0, utlMemCheckAll());
+      TSTCODE { ptr_b[20] = 'x'; }
+      TSTEQINT("Overflow found", 1, utlMemCheckAll());
+      TSTCODE {
+        free(ptr_b);
+        utlMemTrack(0);
+      }
+      TSTEQINT("No more leaks", 0, utlMemLeaks(NULL));
+    }
+
+    TSTSECTION("sampling") {
+      char *blk[1000];
+      unsigned long sampled = 0;
+      FILE *f;
+      char ln[256];
+      TSTCODE {
+        logLevel(utlMemLog,"Warn");
+        utlMemSample(4);
+        for (k=0; k<1000; k++) blk[k] = malloc(8);
+        for (k=0; k<1000; k+=2) blk[k] = realloc(blk[k], 16);
+        f = fopen("memsample.log","w+");
+        utlMemReport(f, 1);
+        rewind(f);
+        fgets(ln, 256, f);  /* header */
+        if (fgets(ln, 256, f)) sscanf(ln, "%*u %lu", &sampled);
+        fclose(f);
+      }
+      TSTEQINT("All the bytes accounted", 12000, utlMemAllocated);
+      TSTGTINT("Some blocks sampled", sampled, 100);
+      TSTGTINT("Not all blocks sampled", 400, sampled);
+      TSTFAILNOTE("Sampled %lu blocks", sampled);
+      TSTEQINT("Plain blocks are valid", utlMemValid, utlMemCheck(blk[1]));
+      TSTCODE {
+        for (k=0; k<1000; k++) free(blk[k]);
+        utlMemSample(1);
+        logLevel(utlMemLog,"Info");
+      }
+      TSTEQINT("All freed", 0, utlMemAllocated);
+    }
+
+    TSTSECTION("quarantine") {
+      char *a, *b, *c;
+      int bad;
+      TSTCODE {
+        logLevel(utlMemLog,"Warn");
+        utlMemQuarantine(100);
+        a = malloc(40);
+        b = malloc(40);
+        free(a);
+        a[3] = 'x';          /* write after free */
+        free(b);
+        bad = utlMemCheckAll();
+      }
+      TSTEQINT("Use after free detected", 1, bad);
+      TSTEQINT("Freed blocks not counted", 0, utlMemAllocated);
+      TSTCODE {
+        free(b);             /* double free */
+        c = malloc(40);
+        free(c);             /* pushes 'a' out of the quarantine */
+        bad = utlMemCheckAll();
+      }
+      TSTEQINT("Reported once", 0, bad);
+      TSTCODE {
+        b[0] = 'y';
+      }
+      TSTEQINT("Checked on release", 1, utlMemQuarantine(0));
+      TSTEQINT("Nothing left", 0, utlMemCheckAll());
+      TSTCODE {
+        logLevel(utlMemLog,"Info");
+      }
+    }
+
+    TSTSECTION("statistics") {
+      utl_mem_stats_t st0, st;
+      TSTCODE {
+        logLevel(utlMemLog,"Warn");
+        utlMemStats(&st0);
+        ptr_a = malloc(100000);
+        ptr_b = malloc(500);
+        free(ptr_a);
+        utlMemStats(&st);
+      }
+      TSTEQINT("Current", 500, st.current);
+      TSTEQINT("Same as utlMemAllocated", utlMemAllocated, st.current);
+      TSTGEINT("Peak", st.peak, 100000);
+      TSTEQINT("Cumulative", st0.total + 100500, st.total);
+      TSTEQINT("Allocations", st0.allocs + 2, st.allocs);
+      TSTEQINT("Deallocations", st0.frees + 1, st.frees);
+      TSTCODE {
+        free(ptr_b);
+        logLevel(utlMemLog,"Info");
+      }
+    }
+
+    TSTSECTION("pool") {
+      size_t mem0;
+      char *a;
+      TSTCODE {
+        mem0 = utlMemAllocated;
+        a = poolAlloc(20);
+      }
+      TSTEQINT("Traced", mem0 + 20, utlMemAllocated);
+      TSTEQINT("Counted", 1, poolStats(NULL));
+      TSTEQINT("Guarded", utlMemValid, utlMemCheck(a));
+      TSTCODE {
+        poolFree(a, 20);
+      }
+      TSTEQINT("Released", mem0, utlMemAllocated);
+      TSTEQINT("Not counted", 0, poolStats(NULL));
+    }
+
+    TSTSECTION("aligned") {
+      TSTCODE {
+        logLevel(utlMemLog,"Warn");
+        ptr_a = utlMallocAligned(100, 64);
+      }
+      TSTEQINT("Aligned", 0, (uintptr_t)ptr_a % 64);
+      TSTEQINT("Valid", utlMemValid, utlMemCheck(ptr_a));
+      TSTEQINT("Accounted", 100, utlMemAllocated);
+      TSTCODE {
+        ptr_a[100] = 'x';
+      }
+      TSTEQINT("Overflow detected", utlMemOverflow, utlMemCheck(ptr_a));
+      TSTCODE {
+        ptr_a[100] = '\xDE';
+        memset(ptr_a, 'a', 100);
+        ptr_a = realloc(ptr_a, 5000);
+      }
+      TSTEQINT("Still aligned", 0, (uintptr_t)ptr_a % 64);
+      TSTEQINT("Content kept", 'a', ptr_a[99]);
+      TSTCODE {
+        utlFreeAligned(ptr_a);
+        logLevel(utlMemLog,"Info");
+      }
+      TSTEQINT("All freed", 0, utlMemAllocated);
+    }
+
+    TSTSECTION("trace") {
+      FILE *f;
+      utl_mem_rec_t r;
+      char sig[8];
+      int allocs = 0, frees = 0, sites = 0, ok = 1;
+      TSTCODE {
+        logLevel(utlMemLog,"Warn");
+      }
+      TSTEQINT("Trace opened", 1, utlMemTrace("memtrace.tmp"));
+      TSTCODE {
+        for (k = 0; k < 3000; k++) {
+          ptr_a = malloc(k+1);
+          ptr_a = realloc(ptr_a, k+10);
+          free(ptr_a);
+        }
+        utlMemTrace(NULL);
+        logLevel(utlMemLog,"Info");
+        f = fopen("memtrace.tmp","rb");
+        if (!f || fread(sig, 1, 8, f) != 8 || memcmp(sig, UTL_MEM_TRACE_SIG, 8)) ok = 0;
+        else {
+          fseek(f, 8, SEEK_CUR);
+          while (fread(&r, sizeof(r), 1, f) == 1) {
+            switch (r.op) {
+              case UTL_MEM_OP_ALLOC: allocs++; break;
+              case UTL_MEM_OP_FREE : frees++; break;
+              case UTL_MEM_OP_SITE : sites++; fseek(f, (long)r.time, SEEK_CUR); break;
+              default: ok = 0;
+            }
+          }
+        }
+        if (f) fclose(f);
+      }
+      TSTEQINT("Valid trace", 1, ok);
+      TSTEQINT("Allocations", 6000, allocs);
+      TSTEQINT("Frees", 6000, frees);
+      TSTEQINT("Sites", 2, sites);
+    }
+
+    TSTSECTION("trace threads") {
+      char *blk[NBLOCKS];
+      double ms = -1;
+      long live = -1, blocks = -1;
+      int found = 0;
+      TSTCODE {
+#ifdef UTL_THREADS
+        pthread_t th;
+        logLevel(utlMemLog,"Warn");
+        utlMemTrace("memtrace.tmp");
+        for (k = 0; k < NBLOCKS; k++) blk[k] = malloc(100);
+        pthread_create(&th, NULL, release, blk);
+        pthread_join(th, NULL);
+        utlMemTrace(NULL);
+        logLevel(utlMemLog,"Info");
+        found = memtrace("memtrace.tmp", &ms, &live, &blocks);
+#endif
+      }
+      TSTSKIP(!threads || !found, "No threads or no memtrace") {
+        TSTEQINT("No live bytes", 0, live);
+        TSTEQINT("No live blocks", 0, blocks);
+        TST("Valid timeline", ms >= 0 && ms < 60000);
+      }
+    }
+
+    TSTSECTION("corrupted trace") {
+      double ms;
+      long live, blocks;
+      int found = 0;
+      TSTCODE {
+        found = (memtrace("memtrace.tmp", &ms, &live, &blocks) == 1);
+      }
+      TSTSKIP(!found, "No memtrace") {
+        TSTCODE {
+          FILE *f, *o;
+          utl_mem_rec_t r;
+          f = fopen("memtrace.tmp","rb");
+          o = fopen("badtrace.tmp","wb");
+          if (f && o && fread(&r, 1, 16, f) == 16) {  /* signature and header */
+            fwrite(&r, 1, 16, o);
+            memset(&r, 0, sizeof(r));
+            r.op = UTL_MEM_OP_ALLOC;
+            r.site = 0xFFFFFFF0;
+            fwrite(&r, sizeof(r), 1, o);
+          }
+          if (o) fclose(o);
+          if (f) fclose(f);
+        }
+        TSTEQINT("Bad site id", -1, memtrace("badtrace.tmp", &ms, &live, &blocks));
+        TSTCODE {
+          FILE *f, *o;
+          char buf[256];
+          size_t n;
+          long len = 0;
+          f = fopen("memtrace.tmp","rb");
+          o = fopen("badtrace.tmp","wb");
+          if (f && o) {
+            fseek(f, 0, SEEK_END);
+            len = ftell(f) - 5;          /* the last record is cut short */
+            rewind(f);
+            while (len > 0 && (n = fread(buf, 1, len < 256 ? (size_t)len : 256, f)) > 0) {
+              fwrite(buf, 1, n, o);
+              len -= (long)n;
+            }
+          }
+          if (o) fclose(o);
+          if (f) fclose(f);
+        }
+        TSTEQINT("Truncated", -1, memtrace("badtrace.tmp", &ms, &live, &blocks));
+      }
+    }
+
+    TSTSECTION("threads") {
+      utl_mem_stats_t st0, st;
+      char *blk[NTHREADS][10];
+      TSTSKIP(!threads, "No threads") {
+        TSTCODE {
+          logLevel(utlMemLog,"Warn");
+          utlMemSample(3);
+          utlMemStats(&st0);
+#ifdef UTL_THREADS
+          {
+            pthread_t th[NTHREADS];
+            for (k = 0; k < NTHREADS; k++) pthread_create(&th[k], NULL, churn, blk[k]);
+            for (k = 0; k < NTHREADS; k++) pthread_join(th[k], NULL);
+          }
+#endif
+          utlMemStats(&st);
+          utlMemSample(1);
+          logLevel(utlMemLog,"Info");
+        }
+        TSTEQINT("Allocated by threads", NTHREADS * 110, utlMemAllocated);
+        TSTEQINT("Allocations", st0.allocs + NTHREADS * 20000, st.allocs);
+        TSTEQINT("Deallocations", st0.frees + NTHREADS * 19990, st.frees);
+        TSTCODE {
+          for (k = 0; k < NTHREADS * 10; k++) free(blk[k / 10][k % 10]);
+        }
+        TSTEQINT("All freed", 0, utlMemAllocated);
+      }
+    }
+
+    TSTSECTION("page guard") {
+      char *a, *b;
+      size_t pg = 1;
+      int sig = 0;
+      TSTSKIP(!paged, "No page guards") {
+        TSTCODE {
+#ifdef UTL_UNIX
+          pg = (size_t)sysconf(_SC_PAGESIZE);
+#endif
+          logLevel(utlMemLog,"Warn");
+        }
+        TSTEQINT("Guard by size", 2, utlMemGuard("96, 200-300"));
+        TSTCODE {
+          a = malloc(96);
+          b = malloc(104);
+        }
+        TSTEQINT("Block at the end of the page", 0, ((uintptr_t)(a+96)) % pg);
+        TSTNEQINT("Not guarded", 0, ((uintptr_t)(b+104)) % pg);
+        TSTEQINT("Guarded block valid", utlMemValid, utlMemCheck(a));
+        TSTCODE {
+          memset(a, 'a', 96);
+          a = realloc(a, 256);
+        }
+        TSTEQINT("Realloc in guarded range", 0, ((uintptr_t)(a+256)) % pg);
+        TSTEQINT("Content kept", 'a', a[95]);
+        TSTEQINT("Allocated", 360, utlMemAllocated);
+#ifdef UTL_UNIX
+        TSTCODE {
+          pid_t pid;
+          int st = 0;
+          fflush(NULL);
+          if ((pid = fork()) == 0) { a[256] = 'x'; _exit(0); }
+          waitpid(pid, &st, 0);
+          if (WIFSIGNALED(st)) sig = WTERMSIG(st);
+        }
+#endif
+        TSTNEQINT("Overflow faults", 0, sig);
+        TSTEQINT("Guard by site", 1, utlMemGuard("utl_memory_ut.c"));
+        TSTCODE {
+          free(b);
+          b = malloc(3);
+        }
+        TSTEQINT("Site guarded (aligned)", 0, ((uintptr_t)(b+8)) % pg);
+        TSTCODE {
+          b[4] = 'x';        /* in the alignment padding */
+        }
+        TSTEQINT("Padding checked", utlMemOverflow, utlMemCheck(b));
+        TSTCODE {
+          free(a);
+          free(b);
+          utlMemGuard(NULL);
+          logLevel(utlMemLog,"Info");
+        }
+        TSTEQINT("All freed", 0, utlMemAllocated);
+      }
+    }
+
+    TSTNOTE("Check the file 'memory.log' to see the log of traced allocations");
+  }
+  
+  logClose(utlMemLog);
 }
\ No newline at end of file
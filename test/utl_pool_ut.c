@@ -0,0 +1,130 @@
+/* 
+**  (C) by Remo Dentato (rdentato@gmail.com)
+** 
+** This sofwtare is distributed under the terms of the BSD license:
+**   http://creativecommons.org/licenses/BSD/
+**   http://opensource.org/licenses/bsd-license.php 
+*/
+
+#define UTL_C
+#define UTL_POOL
+#define UTL_UNITTEST
+
+#include "utl.h"
+
+#ifdef UTL_THREADS
+int threads = 1;
+#else
+int threads = 0;
+#endif
+
+#define NTHREADS 4
+#define NOBJS    10000
+
+int errors = 0;
+
+void *churn(void *arg)
+{
+  void *obj[100];
+  int k, j, bad = 0;
+  
+  for (k = 0; k < NOBJS / 100; k++) {
+    for (j = 0; j < 100; j++) {
+      obj[j] = poolAlloc(40);
+      if (!obj[j]) bad++;
+      else memset(obj[j], j, 40);
+    }
+    for (j = 0; j < 100; j++) {
+      if (((unsigned char *)obj[j])[39] != j) bad++;
+      poolFree(obj[j], 40);
+    }
+  }
+  if (bad) errors = bad;
+  return NULL;
+}
+
+int main (int argc, char *argv[])
+{
+  char *a, *b, *c;
+  vec_t v;
+  buf_t bf;
+  size_t used;
+  FILE *f;
+  char ln[256];
+  unsigned long sz = 0, slabs = 0, inuse = 0;
+  int k;
+  
+  TSTPLAN("utl unit test: pool") {
+  
+    TSTSECTION("pool alloc") {
+      TSTCODE {
+        a = poolAlloc(20);
+        b = poolAlloc(20);
+        c = poolAlloc(100);
+      }
+      TSTNNULL("Allocated", a);
+      TSTEQINT("Same slab", 32, b - a);
+      TSTEQINT("Aligned", 0, (uintptr_t)c % 16);
+      TSTEQINT("In use", 3, poolStats(NULL));
+      TSTCODE {
+        poolFree(b, 20);
+        b = poolAlloc(30);  /* same class */
+      }
+      TSTEQINT("Reused", 32, b - a);
+      TSTCODE {
+        f = fopen("pool.log","w+");
+        poolStats(f);
+        rewind(f);
+        fgets(ln, 256, f);  /* header */
+        if (fgets(ln, 256, f)) sscanf(ln, "%lu %lu %lu", &sz, &slabs, &inuse);
+        fclose(f);
+      }
+      TSTEQINT("Stats size", 32, sz);
+      TSTEQINT("Stats slabs", 1, slabs);
+      TSTEQINT("Stats used", 2, inuse);
+      TSTCODE {
+        poolFree(a, 20);
+        poolFree(b, 30);
+        poolFree(c, 100);
+        a = poolAlloc(UTL_POOL_MAX + 1);  /* plain malloc() */
+      }
+      TSTNNULL("Large object", a);
+      TSTEQINT("Not in the pool", 0, poolStats(NULL));
+      TSTCODE {
+        poolFree(a, UTL_POOL_MAX + 1);
+      }
+    }
+    
+    TSTSECTION("vec headers") {
+      TSTCODE {
+        used = poolStats(NULL);
+        v = vecNew(int);
+        bf = bufNew();
+        for (k = 0; k < 100; k++) vecAdd(v, &k);
+        bufAddStr(bf, "pooled");
+      }
+      TSTEQINT("Headers from the pool", used + 2, poolStats(NULL));
+      TSTEQINT("Vec works", 99, *(int *)vecGet(v, 99));
+      TST("Buf works", strcmp("pooled", bufStr(bf)) == 0);
+      TSTCODE {
+        v = vecFree(v);
+        bf = bufFree(bf);
+      }
+      TSTEQINT("Headers back in the pool", used, poolStats(NULL));
+    }
+    
+    TSTSECTION("threads") {
+      TSTSKIP(!threads, "No threads") {
+#ifdef UTL_THREADS
+        TSTCODE {
+          pthread_t th[NTHREADS];
+          for (k = 0; k < NTHREADS; k++) pthread_create(&th[k], NULL, churn, NULL);
+          for (k = 0; k < NTHREADS; k++) pthread_join(th[k], NULL);
+        }
+#endif
+        TSTEQINT("No corruption", 0, errors);
+        TSTEQINT("All returned", 0, poolStats(NULL));
+      }
+    }
+  }
+}
@@ -0,0 +1,131 @@
+/* 
+**  (C) by Remo Dentato (rdentato@gmail.com)
+** 
+** This sofwtare is distributed under the terms of the BSD license:
+**   http://creativecommons.org/licenses/BSD/
+**   http://opensource.org/licenses/bsd-license.php 
+*/
+
+#define UTL_C
+#define UTL_MEMCHECK
+#define UTL_UNITTEST
+
+#include "utl.h"
+
+#ifdef UTL_THREADS
+int threads = 1;
+#else
+int threads = 0;
+#endif
+#ifdef UTL_QUE_FUTEX
+char *waitby = "futex";
+#else
+char *waitby = "condition variable";
+#endif
+
+#define NITEMS 1000000
+#define BATCH  100
+
+que_t pq = NULL;
+
+/* Producer: puts 0..NITEMS-1 in batches of different sizes */
+void *produce(void *arg)
+{
+  int item[BATCH];
+  int k = 0, j, n;
+  
+  while (k < NITEMS) {
+    n = 1 + k % BATCH;
+    if (n > NITEMS - k) n = NITEMS - k;
+    for (j = 0; j < n; j++) item[j] = k + j;
+    k += (int)quePutNWait(pq, item, n);
+  }
+  return NULL;
+}
+
+int main (int argc, char *argv[])
+{
+  que_t q = NULL;
+  int a[10] = {0,1,2,3,4,5,6,7,8,9};
+  int b[10];
+  int k, x, ok;
+  
+  TSTPLAN("utl unit test: queues") {
+  
+    TSTSECTION("que create") {
+      TSTGROUP("queNew()") {
+        q = queNew(int, 6);
+        TSTNNULL("Created", q);
+        TSTEQINT("Size rounded to power of 2", 8, queMax(q));
+        TSTEQINT("Empty", 0, queCount(q));
+        TSTEQINT("Indices on different lines", 0, (offsetof(struct que_s, head) -
+                                                    offsetof(struct que_s, tail)) % UTL_CACHE_LINE);
+        TSTEQINT("Aligned to a cache line", 0, (uintptr_t)q % UTL_CACHE_LINE);
+      }
+    }
+    
+    TSTSECTION("que put/get") {
+      TSTGROUP("quePut()/queGet()") {
+        x = 42;
+        TST("Put", quePut(q, &x));
+        TSTEQINT("Count", 1, queCount(q));
+        x = 0;
+        TST("Get", queGet(q, &x));
+        TSTEQINT("Value", 42, x);
+        TST("Get empty", !queGet(q, &x));
+        TSTEQINT("Can't wait (not created with queNewWait)", 0, queGetNWait(q, &x, 1));
+      }
+      TSTGROUP("quePutN()/queGetN()") {
+        TSTEQINT("Put only what fits", 8, quePutN(q, a, 10));
+        TST("Put full", !quePut(q, a));
+        TSTEQINT("Get some", 5, queGetN(q, b, 5));
+        TSTEQINT("Values", 4, b[4]);
+        TSTEQINT("Put wrapping around", 5, quePutN(q, a, 10));
+        TSTEQINT("Get all", 8, queGetN(q, b, 10));
+        TSTCODE {
+          ok = (b[0] == 5 && b[2] == 7 && b[3] == 0 && b[7] == 4);
+        }
+        TST("Values in order", ok);
+        TSTEQINT("Empty", 0, queCount(q));
+      }
+      TSTGROUP("queFree()") {
+        TSTEQINT("Mem Valid", utlMemValid, utlMemCheck(q->buf));
+        TSTCODE { q = queFree(q); }
+        TSTNULL("Freed", q);
+      }
+    }
+    
+    TSTSECTION("que threads") {
+      TSTNOTE("Waiting on a %s", waitby);
+      TSTSKIP(!threads, "No threads") {
+#ifdef UTL_THREADS
+        TSTCODE {
+          pthread_t th;
+          int item[BATCH];
+          int n, j;
+          
+          pq = queNewWait(int, 64);
+          pthread_create(&th, NULL, produce, NULL);
+          ok = 1;  k = 0;
+          while (k < NITEMS) {
+            n = (int)queGetNWait(pq, item, BATCH);
+            for (j = 0; j < n; j++) if (item[j] != k + j) ok = 0;
+            k += n;
+          }
+          pthread_join(th, NULL);
+        }
+#endif
+        TSTEQINT("All received", NITEMS, k);
+        TST("In order", ok);
+        TSTEQINT("Empty", 0, queCount(pq));
+        TSTCODE { pq = queFree(pq); }
+      }
+    }
+    
+    TSTSECTION("que cleanup") {
+      TSTGROUP("Memory") {
+        TSTEQINT("All freed", 0, utlMemAllocated);
+      }
+    }
+  }
+}
@@ -0,0 +1,81 @@
+/* 
+**  (C) by Remo Dentato (rdentato@gmail.com)
+** 
+** This sofwtare is distributed under the terms of the BSD license:
+**   http://creativecommons.org/licenses/BSD/
+**   http://opensource.org/licenses/bsd-license.php 
+*/
+
+#define UTL_C
+#define UTL_MEMCHECK
+#define UTL_UNITTEST
+
+#include "utl.h"
+
+typedef struct {
+  int x; int y;
+} point;
+
+int main (int argc, char *argv[])
+{
+  seg_t s = NULL;
+  point q, *p, *first, *last;
+  int k, ok;
+  
+  TSTPLAN("utl unit test: segmented vectors") {
+  
+    TSTSECTION("seg create") {
+      TSTGROUP("segNew()") {
+        s = segNewChunk(point, 100);
+        TSTNNULL("Created", s);
+        TSTEQINT("Chunk rounded to power of 2", 127, s->mask);
+        TSTEQINT("Empty", 0, segCount(s));
+        TSTNULL("No element", segGet(s, 0));
+      }
+    }
+    
+    TSTSECTION("seg add") {
+      TSTGROUP("segAdd()") {
+        TSTCODE {
+          q.x = 0; q.y = 0;
+          segAdd(s, &q);
+          first = segGet(s, 0);
+          for (k = 1; k < 1000; k++) { q.x = k; q.y = -k; segAdd(s, &q); }
+        }
+        TSTEQINT("Count", 1000, segCount(s));
+        TSTEQINT("Chunks", 8, s->chunks);
+        TSTEQPTR("First element not moved", first, segGet(s, 0));
+        TSTCODE {
+          ok = 1;
+          for (k = 0; k < 1000 && ok; k++) {
+            p = segGet(s, k);
+            ok = (p->x == k && p->y == -k);
+          }
+        }
+        TST("Content", ok);
+        TSTNULL("Out of range", segGet(s, 1000));
+      }
+      TSTGROUP("segSet()") {
+        TSTCODE {
+          last = segGet(s, 999);
+          q.x = 5000;
+          segSet(s, 5000, &q);
+          p = segGet(s, 5000);
+        }
+        TSTEQINT("Count", 5001, segCount(s));
+        TSTEQINT("Set", 5000, p->x);
+        TSTEQPTR("Last element not moved", last, segGet(s, 999));
+        TSTEQINT("Contiguous in the chunk", 1, (point *)segGet(s, 129) - (point *)segGet(s, 128));
+        TSTEQINT("Mem Valid", utlMemValid, utlMemCheck(s->dir[0]));
+      }
+    }
+    
+    TSTSECTION("seg cleanup") {
+      TSTGROUP("segFree()") {
+        s = segFree(s);
+        TSTNULL("Is NULL", s);
+        TSTEQINT("All freed", 0, utlMemAllocated);
+      }
+    }
+  }
+}
@@ -1,96 +1,327 @@
-/* 
-**  (CC) by Remo Dentato (rdentato@gmail.com)
-** 
-** This software is distributed under the terms of the BSD license:
-**   http://creativecommons.org/licenses/BSD/
-**   http://opensource.org/licenses/bsd-license.php 
-*/
-
-#define UTL_C
-#define UTL_UNITTEST
-#define UTL_MEMCHECK
-#include "utl.h"
-
-FILE *f = NULL;
-char vec[512];
-int k=0;
-int c=0;
-vec_t vv=NULL;
-
-typedef struct {
-  int x; int y;
-} point;
-
-point p1;
-point p2;
-point *p;
-
-int main (int argc, char *argv[])
-{
-  logLevel(logStderr,"DBG");
-  logPre(logStderr,"#");
-
-  p1.x =  1; p1.y =  2;
-  p2.x = -1; p2.y = -2;
-
-  TSTPLAN("utl unit test: vec") {
-  
-    TSTSECTION("vec creation") {
-      TSTGROUP("vecNew()") {
-        TSTCODE {
-          vv = vecNew(point);
-        }
-        TSTNNULL("Is not NULL", vv );
-        TSTEQINT("Mem Valid", utlMemValid, utlMemCheck(vv));
-        TSTEQINT("Len 0", 0, vecCount(vv) );
-      }
-    }
-    TSTSECTION("vec add") {
-      TSTGROUP("vec set() 1") {
-        vecSet(vv,0,&p1);
-        TSTNNULL("Is not NULL", vv->vec );
-        p = vecGet(vv,0);
-        TSTEQINT("Set properly direct access", 1, p->x );
-        TSTEQINT("Len 1", 1, vecCount(vv) );
-     }
-     TSTGROUP("vec set() 2") {
-        vecSet(vv,1,&p2);
-        TSTNNULL("Is not NULL", vv->vec );
-        p = vecGet(vv,1);
-        TSTEQINT("Set properly direct access", -1, p->x );
-        TSTEQINT("Len 1", 2, vecCount(vv) );
-      }
-    }
-    TSTSECTION("vec get") {
-      TSTGROUP("vec get outbound") {
-        p = vecGet(vv,vecCount(vv)+1);
-        TSTNULL("Is Null",p);
-      }
-      TSTGROUP("vec as array") {
-        p = vec(vv,point);
-        TSTNNULL("Is not Null",p);
-        TSTSKIP(p==NULL,"Vec array is NULL") {
-          TSTEQINT("v[0]",2, p[0].y);
-          TSTEQINT("v[1]",-2, p[1].y);
-        }
-      }
-    }
-    TSTSECTION("vec Resize") {
-      TSTGROUP("vec grow") {
-        vecResize(vv,30);
-        TSTLEINT("Grown up", 30, vv->max);
-      }
-      TSTGROUP("vec shrink") {
-        vecResize(vv,10);
-        TSTLEINT("Shrink", 10, vv->max);
-        TSTNOTE("Cur max: %d", vv->max);
-      }
-    }
-    TSTSECTION("vec cleanup") {
-      TSTGROUP("vec free") {
-        vv = vecFree(vv);
-        TSTNULL("Is NULL", vv );
-      }
-    }
-  }
-}
+/* 
+**  (CC) by Remo Dentato (rdentato@gmail.com)
+** 
+** This software is distributed under the terms of the BSD license:
+**   http://creativecommons.org/licenses/BSD/
+**   http://opensource.org/licenses/bsd-license.php 
+*/
+
+#define UTL_C
+#define UTL_UNITTEST
+#define UTL_MEMCHECK
+#include "utl.h"
+
+FILE *f = NULL;
+char vec[512];
+int k=0;
+int c=0;
+vec_t vv=NULL;
+
+typedef struct {
+  int x; int y;
+} point;
+
+point p1;
+point p2;
+point *p;
+
+vecDeclare(int, ivec);
+vecDeclare(point, pvec);
+
+int main (int argc, char *argv[])
+{
+  logLevel(logStderr,"DBG");
+  logPre(logStderr,"#");
+
+  p1.x =  1; p1.y =  2;
+  p2.x = -1; p2.y = -2;
+
+  TSTPLAN("utl unit test: vec") {
+  
+    TSTSECTION("vec creation") {
+      TSTGROUP("vecNew()") {
+        TSTCODE {
+          vv = vecNew(point);
+        }
+        TSTNNULL("Is not NULL", vv );
+        TSTEQINT("Mem Valid", utlMemValid, utlMemCheck(vv));
+        TSTEQINT("Len 0", 0, vecCount(vv) );
+      }
+    }
+    TSTSECTION("vec add") {
+      TSTGROUP("vec set() 1") {
+        vecSet(vv,0,&p1);
+        TSTNNULL("Is not NULL", vv->vec );
+        p = vecGet(vv,0);
+        TSTEQINT("Set properly direct access", 1, p->x );
+        TSTEQINT("Len 1", 1, vecCount(vv) );
+     }
+     TSTGROUP("vec set() 2") {
+        vecSet(vv,1,&p2);
+        TSTNNULL("Is not NULL", vv->vec );
+        p = vecGet(vv,1);
+        TSTEQINT("Set properly direct access", -1, p->x );
+        TSTEQINT("Len 1", 2, vecCount(vv) );
+      }
+    }
+    TSTSECTION("vec get") {
+      TSTGROUP("vec get outbound") {
+        p = vecGet(vv,vecCount(vv)+1);
+        TSTNULL("Is Null",p);
+      }
+      TSTGROUP("vec as array") {
+        p = vec(vv,point);
+        TSTNNULL("Is not Null",p);
+        TSTSKIP(p==NULL,"Vec array is NULL") {
+          TSTEQINT("v[0]",2, p[0].y);
+          TSTEQINT("v[1]",-2, p[1].y);
+        }
+      }
+    }
+    TSTSECTION("vec Resize") {
+      TSTGROUP("vec grow") {
+        vecResize(vv,30);
+        TSTLEINT("Grown up", 30, vv->max);
+      }
+      TSTGROUP("vec shrink") {
+        vecResize(vv,10);
+        TSTLEINT("Shrink", 10, vv->max);
+        TSTNOTE("Cur max: %d", vv->max);
+      }
+    }
+    TSTSECTION("vec cleanup") {
+      TSTGROUP("vec free") {
+        vv = vecFree(vv);
+        TSTNULL("Is NULL", vv );
+      }
+    }
+    TSTSECTION("typed vec") {
+      TSTGROUP("vecDeclare(int)") {
+        int *iv;
+        long sum = 0;
+        TSTCODE {
+          vv = ivecNew();
+          for (k = 0; k < 1000; k++) ivecAdd(vv, k);
+          iv = ivecVec(vv);
+          for (k = 0; k < (int)vecCount(vv); k++) sum += iv[k];
+        }
+        TSTEQINT("Count", 1000, vecCount(vv));
+        TSTEQINT("Sum", 499500, sum);
+        TSTEQINT("Get", 123, ivecGet(vv, 123));
+        TSTEQINT("Get out of range", 0, ivecGet(vv, 1000));
+        TSTEQINT("Same as vecGet", 7, *(int *)vecGet(vv, 7));
+        TSTEQINT("Pop", 999, ivecPop(vv));
+        TSTEQINT("Count after pop", 999, vecCount(vv));
+        TSTCODE { ivecSet(vv, 1500, -1); }
+        TSTEQINT("Set extends", 1501, vecCount(vv));
+        TSTEQINT("Set value", -1, ivecGet(vv, 1500));
+        TSTEQINT("Mem Valid", utlMemValid, utlMemCheck(vv->vec));
+        TSTCODE { vv = vecFree(vv); }
+        TSTEQINT("Set on NULL", 0, ivecSet(NULL, 0, 1));
+        TSTEQINT("Add on NULL", 0, ivecAdd(NULL, 1));
+        TSTEQINT("Get on NULL", 0, ivecGet(NULL, 0));
+        TSTEQINT("Pop on NULL", 0, ivecPop(NULL));
+        TSTNULL("Vec on NULL", ivecVec(NULL));
+      }
+      TSTGROUP("vecDeclare(point)") {
+        TSTCODE {
+          vv = pvecNew();
+          pvecPush(vv, p1);
+          pvecPush(vv, p2);
+          p2 = pvecGet(vv, 0);
+        }
+        TSTEQINT("Struct element", 2, p2.y);
+        TSTEQINT("Popped", -2, pvecPop(vv).y);
+        TSTCODE { vv = vecFree(vv); }
+      }
+    }
+    TSTSECTION("vec bulk") {
+      int a[10] = {0,1,2,3,4,5,6,7,8,9};
+      int *iv;
+      vec_t w = NULL;
+      TSTGROUP("vecAddN()") {
+        TSTCODE {
+          vv = vecNew(int);
+          vecAddN(vv, a, 10);
+          iv = vec(vv, int);
+        }
+        TSTEQINT("Count", 10, vecCount(vv));
+        TSTEQINT("Grown once", 16, vecMax(vv));
+        TSTEQINT("Last", 9, iv[9]);
+        TSTCODE { vecAddN(vv, NULL, 2); iv = vec(vv, int); }
+        TSTEQINT("Zeroed", 0, iv[10] + iv[11]);
+      }
+      TSTGROUP("vecInsertN()") {
+        TSTCODE {
+          vecInsertN(vv, 2, a+7, 3);   /* 0 1 7 8 9 2 3 ... */
+          iv = vec(vv, int);
+        }
+        TSTEQINT("Count", 15, vecCount(vv));
+        TSTEQINT("Inserted", 789, iv[2]*100 + iv[3]*10 + iv[4]);
+        TSTEQINT("Moved", 23, iv[5]*10 + iv[6]);
+        TSTCODE {
+          vecInsertN(vv, 1, vec(vv, int), 3);  /* 0 0 1 7 1 7 8 9 2 ... */
+          iv = vec(vv, int);
+        }
+        TSTEQINT("Insert from itself", 1717, iv[2]*1000 + iv[3]*100 + iv[4]*10 + iv[5]);
+        TSTEQINT("First unchanged", 0, iv[0] + iv[1]);
+        TSTCODE { vecInsertN(vv, 20, a+1, 1); iv = vec(vv, int); }
+        TSTEQINT("Past the end", 21, vecCount(vv));
+        TSTEQINT("Gap zeroed", 0, iv[18] + iv[19]);
+        TSTEQINT("Value", 1, iv[20]);
+      }
+      TSTGROUP("vecRemoveRange()") {
+        TSTCODE { vecRemoveRange(vv, 0, 2); iv = vec(vv, int); }
+        TSTEQINT("Count", 19, vecCount(vv));
+        TSTEQINT("Removed", 17, iv[0]*10 + iv[1]);
+        TSTCODE { vecRemoveRange(vv, 5, 100); }
+        TSTEQINT("Clipped", 5, vecCount(vv));
+        TSTCODE { vecRemoveRange(vv, 5, 1); }
+        TSTEQINT("Out of range", 5, vecCount(vv));
+      }
+      TSTGROUP("vecExtend()") {
+        TSTCODE {
+          w = vecNew(int);
+          vecAddN(w, a, 10);
+          vecExtend(vv, w);
+          vecExtend(vv, vv);
+          iv = vec(vv, int);
+        }
+        TSTEQINT("Count", 30, vecCount(vv));
+        TSTEQINT("Extended", 9, iv[14]);
+        TSTEQINT("Self extended", 9, iv[29]);
+        TSTCODE { w = vecFree(w); w = vecNew(char); }
+        TSTEQINT("Different types", 0, vecExtend(vv, w));
+        TSTEQINT("Mem Valid", utlMemValid, utlMemCheck(vv->vec));
+        TSTCODE { vv = vecFree(vv); w = vecFree(w); }
+      }
+    }
+    TSTSECTION("vec capacity") {
+      TSTGROUP("vecReserve()") {
+        TSTCODE {
+          vv = vecNew(int);
+          vecReserve(vv, 1000);
+        }
+        TSTEQINT("Exact capacity", 1000, vecMax(vv));
+        TSTEQINT("Still empty", 0, vecCount(vv));
+        TSTCODE { vecReserve(vv, 10); }
+        TSTEQINT("Not shrunk", 1000, vecMax(vv));
+        TSTCODE { for (k = 0; k < 1000; k++) vecAdd(vv, &k); }
+        TSTEQINT("No growth", 1000, vecMax(vv));
+      }
+      TSTGROUP("vecShrinkToFit()") {
+        TSTCODE {
+          vecAdd(vv, &k);
+          vecShrinkToFit(vv);
+        }
+        TSTEQINT("Fit", 1001, vecMax(vv));
+        TSTEQINT("Content kept", 999, *(int *)vecGet(vv, 999));
+        TSTEQINT("Mem Valid", utlMemValid, utlMemCheck(vv->vec));
+        TSTCODE { vecRemoveRange(vv, 0, 1001); vecShrinkToFit(vv); }
+        TSTEQINT("Empty fit", 0, vecMax(vv));
+        TSTNULL("Storage freed", vv->vec);
+      }
+      TSTGROUP("vecGrowth()") {
+        TSTCODE {
+          vecGrowth(vv, 50, 0);
+          vecReserve(vv, 100);
+          vecSet(vv, 100, &k);
+        }
+        TSTEQINT("Grown by 1.5x", 150, vecMax(vv));
+        TSTCODE {
+          vecGrowth(vv, 100, 64);
+          vecSet(vv, 150, &k);
+        }
+        TSTEQINT("Capped step", 214, vecMax(vv));
+        TSTCODE { vecSet(vv, 1000, &k); }
+        TSTEQINT("Capped jump", 1046, vecMax(vv));
+        TSTCODE { vv = vecFree(vv); }
+      }
+      TSTGROUP("bufShrinkToFit()") {
+        TSTCODE {
+          vv = bufNew();
+          bufReserve(vv, 100);
+          bufAddStr(vv, "abc");
+          bufShrinkToFit(vv);
+        }
+        TSTEQINT("Room for '\\0'", 4, vecMax(vv));
+        TSTEQINT("Terminated", 0, strcmp("abc", bufStr(vv)));
+        TSTCODE { vv = vecFree(vv); }
+      }
+    }
+    TSTSECTION("vec small") {
+      TSTGROUP("vecNewSmall()") {
+        int *inl;
+        TSTCODE {
+          vv = vecNewSmall(int, 16);
+          inl = vec(vv, int);
+          for (k = 0; k < 16; k++) vecAdd(vv, &k);
+        }
+        TSTEQINT("Inline capacity", 16, vecMax(vv));
+        TSTEQPTR("Inline storage", inl, vec(vv, int));
+        TSTEQPTR("Next to the header", (char *)vv + ((sizeof(struct vec_s) + 15) & ~15), (char *)inl);
+        TSTLEINT("Header in a cache line", sizeof(struct vec_s), 64);
+        TSTCODE { vecAdd(vv, &k); }
+        TSTNEQPTR("Spilled to the heap", inl, vec(vv, int));
+        TSTEQINT("Count", 17, vecCount(vv));
+        TSTEQINT("Content kept", 15, *(int *)vecGet(vv, 15));
+        TSTEQINT("Mem Valid", utlMemValid, utlMemCheck(vec(vv, int)));
+        TSTCODE { vecRemoveRange(vv, 10, 7); vecShrinkToFit(vv); }
+        TSTEQPTR("Back inline", inl, vec(vv, int));
+        TSTEQINT("Inline capacity again", 16, vecMax(vv));
+        TSTEQINT("Content kept", 9, *(int *)vecGet(vv, 9));
+        TSTCODE { vv = vecFree(vv); }
+        TSTEQINT("All freed", 0, utlMemAllocated);
+      }
+      TSTGROUP("vecStack()") {
+        size_t mem = utlMemAllocated;
+        vecStack(sv, point, 4);
+        bufStack(sb, 16);
+        TSTCODE {
+          for (k = 0; k < 4; k++) { p1.x = k; vecAdd(sv, &p1); }
+          bufAddStr(sb, "GET /index.html");
+        }
+        TSTEQINT("No allocation", mem, utlMemAllocated);
+        TSTEQINT("Content", 3, ((point *)vecGet(sv, 3))->x);
+        TSTEQINT("Buffer content", 0, strcmp("GET /index.html", bufStr(sb)));
+        TSTCODE { bufAddStr(sb, " HTTP/1.1"); }
+        TSTNEQINT("Buffer spilled", mem, utlMemAllocated);
+        TSTEQINT("Buffer grown", 0, strcmp("GET /index.html HTTP/1.1", bufStr(sb)));
+        TSTCODE { vecFree(sv); vecFree(sb); }
+        TSTEQINT("Spilled storage freed", mem, utlMemAllocated);
+      }
+    }
+    TSTSECTION("vec aligned") {
+      TSTGROUP("vecNewAligned()") {
+        double d, *dp;
+        TSTCODE {
+          vv = vecNewAligned(double, 64);
+          for (k = 0; k < 1000; k++) { d = k; vecAdd(vv, &d); }
+          dp = vec(vv, double);
+        }
+        TSTEQINT("Aligned to 64", 0, (uintptr_t)dp % 64);
+        TSTEQINT("Content kept", 999, (int)dp[999]);
+        TSTEQINT("Mem Valid", utlMemValid, utlMemCheck(dp));
+        TSTCODE {
+          vv = vecFree(vv);
+        }
+      }
+      TSTGROUP("vecHugePages()") {
+        TSTCODE {
+          vecHugePages(1024*1024);
+          vv = vecNew(int);
+          vecResize(vv, 100);
+          c = (int)((uintptr_t)vec(vv, int) % UTL_HUGE_PAGE);
+          vecResize(vv, 512*1024);   /* 2MB of int */
+        }
+        TSTNEQINT("Small vector not aligned", 0, c);
+        TSTEQINT("Large vector on a huge page", 0, (uintptr_t)vec(vv, int) % UTL_HUGE_PAGE);
+        TSTCODE {
+          vv = vecFree(vv);
+          vecHugePages(0);
+        }
+        TSTEQINT("All freed", 0, utlMemAllocated);
+      }
+    }
+  }
+}